@@ -0,0 +1,1040 @@
+// This file is part of patsolve. It is subject to the license terms in
+// the LICENSE file found in the top-level directory of this distribution
+// and at https://github.com/shlomif/patsolve/blob/master/LICENSE . No
+// part of patsolve, including this file, may be copied, modified, propagated,
+// or distributed except according to the terms contained in the COPYING file.
+//
+// Checkpoints.  Save the whole search state to a file and restore it later.
+
+/* The file holds the solver's scalars, the current position, the pile
+table, the roots of the cluster trees, the queues, the solve() stack and
+the beam layers, followed by the position blocks.  The blocks are stored
+verbatim, each one starting on a page boundary, so they can be read (or
+mapped) in big chunks.  The positions and tree nodes inside them still
+point to the addresses of the saving process, so we also store where those
+pointers are, and relocate them after loading.  A checkpoint can only be
+loaded by the same build of the solver. */
+
+#include <stdio.h>
+#include "instance.h"
+#include "pat.h"
+#include "checkpoint.h"
+
+#define CHECKPOINT_VERSION 1
+#define CHECKPOINT_PAGE_SIZE 4096
+// All the allocations from the blocks are multiples of this.
+#define CHECKPOINT_ALIGN 8
+
+typedef struct
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t pointer_size, block_size, position_size, bytes_per_tree_node;
+    uint32_t move_size;
+    int32_t stacks_num, freecells_num, game_flags;
+} checkpoint_header;
+
+typedef struct
+{
+    uint64_t num_checked_states, num_states_in_collection;
+    uint64_t beam_seq, num_beam_discarded, num_moves_to_win;
+    int64_t dequeue__minpos, dequeue__qpos;
+    int32_t max_queue_idx, next_pile_idx, num_solutions, num_moves_to_cut_off;
+    int32_t solution_len_bound, initial_solution_len_bound;
+    int32_t beam_width, max_beam_width, beam_depth, num_beam_layers;
+    int32_t curr_solve_depth, curr_solve_dir, num_solve_levels;
+    int32_t num_tree_lists;
+    uint32_t num_blocks;
+    uint8_t to_stack, dont_exit_on_sol;
+    fcs_pats_xy_params pats_solve_params;
+} checkpoint_scalars;
+
+// A block of the saving process, for looking up addresses.
+typedef struct
+{
+    uint64_t base;
+    uint32_t idx;
+} checkpoint_block_ref;
+
+static int compare_block_refs(const void *const a, const void *const b)
+{
+    const uint64_t x = ((const checkpoint_block_ref *)a)->base;
+    const uint64_t y = ((const checkpoint_block_ref *)b)->base;
+    return ((x > y) - (x < y));
+}
+
+// Return the index of the block containing addr, or -1.
+static inline int64_t find_block(const checkpoint_block_ref *const refs,
+    const size_t num_refs, const uint64_t addr)
+{
+    size_t low = 0, high = num_refs;
+    while (low < high)
+    {
+        const size_t mid = (low + high) / 2;
+        if (refs[mid].base <= addr)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    if (low == 0 || addr - refs[low - 1].base >= FC_SOLVE__PATS__BLOCKSIZE)
+    {
+        return -1;
+    }
+    return refs[low - 1].idx;
+}
+
+static inline uint64_t ptr_to_u64(const void *const ptr)
+{
+    return (uint64_t)(uintptr_t)ptr;
+}
+
+static inline void fill_header(
+    fcs_pats_thread *const soft_thread, checkpoint_header *const header)
+{
+#if !defined(HARD_CODED_NUM_STACKS) || !defined(HARD_CODED_NUM_FREECELLS)
+    const fcs_instance *const instance = soft_thread->instance;
+#endif
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, "PATSCKPT", sizeof(header->magic));
+    header->version = CHECKPOINT_VERSION;
+    header->pointer_size = sizeof(void *);
+    header->block_size = FC_SOLVE__PATS__BLOCKSIZE;
+    header->position_size = (uint32_t)soft_thread->position_size;
+    header->bytes_per_tree_node = (uint32_t)soft_thread->bytes_per_tree_node;
+    header->move_size = sizeof(fcs_pats__move);
+    header->stacks_num = INSTANCE_STACKS_NUM;
+    header->freecells_num = INSTANCE_FREECELLS_NUM;
+#ifndef FCS_FREECELL_ONLY
+    header->game_flags = (int32_t)instance->game_params.game_flags;
+#endif
+}
+
+/* Saving. */
+
+typedef struct
+{
+    FILE *f;
+    bool ok;
+    fcs_pats__block **blocks; /* in the order of the my_block list */
+    checkpoint_block_ref *refs;
+    size_t num_blocks;
+    unsigned char *visited; /* a bit for every aligned offset in a block */
+    uint64_t *slots;        /* (block index << 32) | offset of a pointer */
+    size_t num_slots, max_num_slots;
+    void **todo;
+    size_t todo_len, max_todo_len;
+} checkpoint_saver;
+
+static inline void put(
+    checkpoint_saver *const saver, const void *const data, const size_t len)
+{
+    if (saver->ok && fwrite(data, 1, len, saver->f) != len)
+    {
+        saver->ok = false;
+    }
+}
+#define PUT(saver, x) put((saver), &(x), sizeof(x))
+
+static inline void put_ptr(checkpoint_saver *const saver, const void *const ptr)
+{
+    const uint64_t addr = ptr_to_u64(ptr);
+    PUT(saver, addr);
+}
+
+static inline void push_todo(checkpoint_saver *const saver, void *const ptr)
+{
+    if (!ptr)
+    {
+        return;
+    }
+    if (saver->todo_len == saver->max_todo_len)
+    {
+        const size_t new_max = saver->max_todo_len * 2 + 1024;
+        void **const new_todo = SREALLOC(saver->todo, new_max);
+        if (!new_todo)
+        {
+            saver->ok = false;
+            return;
+        }
+        saver->todo = new_todo;
+        saver->max_todo_len = new_max;
+    }
+    saver->todo[saver->todo_len++] = ptr;
+}
+
+// Record the location of a pointer that is stored inside a block.
+static inline void add_slot(checkpoint_saver *const saver, void *const slot)
+{
+    const int64_t idx =
+        find_block(saver->refs, saver->num_blocks, ptr_to_u64(slot));
+    if (idx < 0)
+    {
+        saver->ok = false;
+        return;
+    }
+    if (saver->num_slots == saver->max_num_slots)
+    {
+        const size_t new_max = saver->max_num_slots * 2 + 4096;
+        uint64_t *const new_slots = SREALLOC(saver->slots, new_max);
+        if (!new_slots)
+        {
+            saver->ok = false;
+            return;
+        }
+        saver->slots = new_slots;
+        saver->max_num_slots = new_max;
+    }
+    saver->slots[saver->num_slots++] =
+        (((uint64_t)idx) << 32) |
+        (ptr_to_u64(slot) - ptr_to_u64(saver->blocks[idx]->block));
+}
+
+/* Record the pointers of a position and of everything reachable from it
+through the queue and parent links.  Positions can be reached more than
+once, so we mark them as visited. */
+static void visit_positions(
+    checkpoint_saver *const saver, fcs_pats_position *const start)
+{
+    push_todo(saver, start);
+    while (saver->ok && saver->todo_len)
+    {
+        fcs_pats_position *const pos = saver->todo[--saver->todo_len];
+        const int64_t idx =
+            find_block(saver->refs, saver->num_blocks, ptr_to_u64(pos));
+        if (idx < 0)
+        {
+            saver->ok = false;
+            return;
+        }
+        const size_t bit =
+            (size_t)idx * (FC_SOLVE__PATS__BLOCKSIZE / CHECKPOINT_ALIGN) +
+            (size_t)(ptr_to_u64(pos) - ptr_to_u64(saver->blocks[idx]->block)) /
+                CHECKPOINT_ALIGN;
+        if (saver->visited[bit >> 3] & (1 << (bit & 0x7)))
+        {
+            continue;
+        }
+        saver->visited[bit >> 3] |= (unsigned char)(1 << (bit & 0x7));
+        add_slot(saver, &pos->queue);
+        add_slot(saver, &pos->parent);
+        add_slot(saver, &pos->node);
+        push_todo(saver, pos->queue);
+        push_todo(saver, pos->parent);
+    }
+}
+
+static void visit_tree(
+    checkpoint_saver *const saver, fcs_pats__tree *const root)
+{
+    push_todo(saver, root);
+    while (saver->ok && saver->todo_len)
+    {
+        fcs_pats__tree *const node = saver->todo[--saver->todo_len];
+        add_slot(saver, &node->left);
+        add_slot(saver, &node->right);
+        push_todo(saver, node->left);
+        push_todo(saver, node->right);
+    }
+}
+
+// The number of solve() levels that have to be saved.
+static inline int num_solve_levels(const fcs_pats_thread *const soft_thread)
+{
+    if (!soft_thread->curr_solve_pos)
+    {
+        return 0;
+    }
+    return min(soft_thread->curr_solve_depth + 2, soft_thread->max_solve_depth);
+}
+
+/* Collect the locations of all the pointers inside the blocks, starting
+from everything outside them that points in. */
+static inline void collect_slots(
+    checkpoint_saver *const saver, fcs_pats_thread *const soft_thread)
+{
+    for (int i = 0; i < FCS_PATS__TREE_LIST_NUM_BUCKETS; i++)
+    {
+        for (var_AUTO(tl, soft_thread->tree_list[i]); tl; tl = tl->next)
+        {
+            visit_tree(saver, tl->tree);
+        }
+    }
+    for (int i = 0; i < FC_SOLVE_PATS__NUM_QUEUES; i++)
+    {
+        visit_positions(saver, soft_thread->queue_head[i]);
+    }
+    visit_positions(saver, soft_thread->freed_positions);
+    visit_positions(saver, soft_thread->curr_solve_pos);
+    const_AUTO(depth, soft_thread->curr_solve_depth);
+    const int num_levels = num_solve_levels(soft_thread);
+    for (int i = 0; i < num_levels; i++)
+    {
+        // Only these levels have a valid pos.
+        if (i < depth || (i == depth && soft_thread->curr_solve_dir ==
+                                            FC_SOLVE_PATS__DOWN))
+        {
+            visit_positions(saver, soft_thread->solve_stack[i].parent);
+            visit_positions(saver, soft_thread->solve_stack[i].pos);
+        }
+        else if (i == depth)
+        {
+            visit_positions(saver, soft_thread->solve_stack[i].parent);
+        }
+    }
+    for (int i = 0; i < soft_thread->num_beam_layers; i++)
+    {
+        const_AUTO(layer, &soft_thread->beam_layers[i]);
+        for (int j = layer->next; j < layer->count; j++)
+        {
+            visit_positions(saver, layer->items[j].pos);
+        }
+    }
+}
+
+static inline void put_current_pos(
+    checkpoint_saver *const saver, fcs_pats_thread *const soft_thread)
+{
+    DECLARE_STACKS();
+    for (int w = 0; w < LOCAL_STACKS_NUM; w++)
+    {
+        const_AUTO(col, fcs_state_get_col(soft_thread->current_pos.s, w));
+        const fcs_card len = (fcs_card)fcs_col_len(col);
+        PUT(saver, len);
+        for (int i = 0; i < len; i++)
+        {
+            const fcs_card card = fcs_col_get_card(col, i);
+            PUT(saver, card);
+        }
+        const int32_t ids[3] = {
+            (int32_t)soft_thread->current_pos.stack_hashes[w],
+            soft_thread->current_pos.stack_ids[w],
+            soft_thread->current_pos.column_idxs[w]};
+        PUT(saver, ids);
+    }
+#if MAX_NUM_FREECELLS > 0
+    for (int i = 0; i < LOCAL_FREECELLS_NUM; i++)
+    {
+        const fcs_card card = fcs_freecell_card(soft_thread->current_pos.s, i);
+        PUT(saver, card);
+    }
+#endif
+    for (int o = 0; o < 4; o++)
+    {
+        const fcs_card value =
+            (fcs_card)fcs_foundation_value(soft_thread->current_pos.s, o);
+        PUT(saver, value);
+    }
+}
+
+static inline void put_state(
+    checkpoint_saver *const saver, fcs_pats_thread *const soft_thread)
+{
+    checkpoint_header header;
+    fill_header(soft_thread, &header);
+    PUT(saver, header);
+
+    checkpoint_scalars scalars;
+    memset(&scalars, 0, sizeof(scalars));
+    scalars.num_checked_states = soft_thread->num_checked_states;
+    scalars.num_states_in_collection = soft_thread->num_states_in_collection;
+    scalars.beam_seq = soft_thread->beam_seq;
+    scalars.num_beam_discarded = soft_thread->num_beam_discarded;
+    scalars.num_moves_to_win = soft_thread->num_moves_to_win;
+    scalars.dequeue__minpos = soft_thread->dequeue__minpos;
+    scalars.dequeue__qpos = soft_thread->dequeue__qpos;
+    scalars.max_queue_idx = soft_thread->max_queue_idx;
+    scalars.next_pile_idx = soft_thread->next_pile_idx;
+    scalars.num_solutions = soft_thread->num_solutions;
+    scalars.num_moves_to_cut_off = soft_thread->num_moves_to_cut_off;
+    scalars.solution_len_bound = soft_thread->solution_len_bound;
+    scalars.initial_solution_len_bound =
+        soft_thread->initial_solution_len_bound;
+    scalars.beam_width = soft_thread->beam_width;
+    scalars.max_beam_width = soft_thread->max_beam_width;
+    scalars.beam_depth = soft_thread->beam_depth;
+    scalars.num_beam_layers = soft_thread->num_beam_layers;
+    scalars.curr_solve_depth = soft_thread->curr_solve_depth;
+    scalars.curr_solve_dir = soft_thread->curr_solve_dir;
+    scalars.num_solve_levels = num_solve_levels(soft_thread);
+    for (int i = 0; i < FCS_PATS__TREE_LIST_NUM_BUCKETS; i++)
+    {
+        for (var_AUTO(tl, soft_thread->tree_list[i]); tl; tl = tl->next)
+        {
+            ++scalars.num_tree_lists;
+        }
+    }
+    scalars.num_blocks = (uint32_t)saver->num_blocks;
+    scalars.to_stack = soft_thread->to_stack;
+    scalars.dont_exit_on_sol = soft_thread->dont_exit_on_sol;
+    scalars.pats_solve_params = soft_thread->pats_solve_params;
+    PUT(saver, scalars);
+
+    put_current_pos(saver, soft_thread);
+
+    // The pile table, in pile number order.
+    for (int i = 0; i < soft_thread->next_pile_idx; i++)
+    {
+        const_AUTO(l, soft_thread->bucket_from_pile_lookup[i]);
+        const uint32_t hash_and_len[2] = {
+            l->hash, (uint32_t)strlen((const char *)l->pile)};
+        PUT(saver, hash_and_len);
+        put(saver, l->pile, hash_and_len[1]);
+    }
+
+    for (int32_t i = 0; i < FCS_PATS__TREE_LIST_NUM_BUCKETS; i++)
+    {
+        for (var_AUTO(tl, soft_thread->tree_list[i]); tl; tl = tl->next)
+        {
+            const int32_t bucket_and_cluster[2] = {i, tl->cluster};
+            PUT(saver, bucket_and_cluster);
+            put_ptr(saver, tl->tree);
+        }
+    }
+
+    for (int i = 0; i < FC_SOLVE_PATS__NUM_QUEUES; i++)
+    {
+        put_ptr(saver, soft_thread->queue_head[i]);
+        put_ptr(saver,
+            soft_thread->queue_head[i] ? soft_thread->queue_tail[i] : NULL);
+    }
+    put_ptr(saver, soft_thread->freed_positions);
+    put_ptr(saver, soft_thread->curr_solve_pos);
+
+    for (int i = 0; i < scalars.num_solve_levels; i++)
+    {
+        const_AUTO(level, &soft_thread->solve_stack[i]);
+        put_ptr(saver, level->parent);
+        put_ptr(saver, level->pos);
+        // Above the current depth, the moves are stale.
+        const bool has_moves =
+            (level->moves_start && i <= soft_thread->curr_solve_depth);
+        const int32_t moves[4] = {level->num_moves, level->q,
+            (has_moves ? (int32_t)(level->moves_end - level->moves_start)
+                       : -1),
+            (has_moves ? (int32_t)(level->move_ptr - level->moves_start)
+                       : 0)};
+        PUT(saver, moves);
+        if (has_moves)
+        {
+            put(saver, level->moves_start,
+                sizeof(level->moves_start[0]) * (size_t)moves[2]);
+        }
+    }
+
+    for (int i = 0; i < soft_thread->num_beam_layers; i++)
+    {
+        const_AUTO(layer, &soft_thread->beam_layers[i]);
+        const int32_t counts[4] = {
+            layer->capacity, layer->count, layer->next, layer->is_sorted};
+        PUT(saver, counts);
+        for (int j = 0; j < layer->count; j++)
+        {
+            put_ptr(saver, layer->items[j].pos);
+            const uint64_t seq = layer->items[j].seq;
+            const int32_t pri = layer->items[j].pri;
+            PUT(saver, seq);
+            PUT(saver, pri);
+        }
+    }
+
+    if (soft_thread->moves_to_win)
+    {
+        put(saver, soft_thread->moves_to_win,
+            sizeof(soft_thread->moves_to_win[0]) *
+                soft_thread->num_moves_to_win);
+    }
+
+    for (size_t i = 0; i < saver->num_blocks; i++)
+    {
+        put_ptr(saver, saver->blocks[i]->block);
+        const uint64_t remaining = saver->blocks[i]->remaining;
+        PUT(saver, remaining);
+    }
+    const uint64_t num_slots = saver->num_slots;
+    PUT(saver, num_slots);
+    put(saver, saver->slots, sizeof(saver->slots[0]) * saver->num_slots);
+
+    // The blocks themselves, page aligned.
+    const long pos = ftell(saver->f);
+    if (pos < 0)
+    {
+        saver->ok = false;
+        return;
+    }
+    static const unsigned char zeros[CHECKPOINT_PAGE_SIZE] = {0};
+    put(saver, zeros,
+        (size_t)((CHECKPOINT_PAGE_SIZE - pos % CHECKPOINT_PAGE_SIZE) %
+                 CHECKPOINT_PAGE_SIZE));
+    for (size_t i = 0; i < saver->num_blocks; i++)
+    {
+        put(saver, saver->blocks[i]->block, FC_SOLVE__PATS__BLOCKSIZE);
+    }
+}
+
+bool fc_solve_pats__save_checkpoint(
+    fcs_pats_thread *const soft_thread, const char *const filename)
+{
+    checkpoint_saver saver = {.ok = true};
+    for (var_AUTO(b, soft_thread->my_block); b; b = b->next)
+    {
+        ++saver.num_blocks;
+    }
+    saver.blocks = SMALLOC(saver.blocks, saver.num_blocks);
+    saver.refs = SMALLOC(saver.refs, saver.num_blocks);
+    saver.visited = calloc(saver.num_blocks,
+        FC_SOLVE__PATS__BLOCKSIZE / CHECKPOINT_ALIGN / 8);
+    if (!saver.blocks || !saver.refs || !saver.visited)
+    {
+        saver.ok = false;
+    }
+    else
+    {
+        size_t i = 0;
+        for (var_AUTO(b, soft_thread->my_block); b; b = b->next, i++)
+        {
+            saver.blocks[i] = b;
+            saver.refs[i].base = ptr_to_u64(b->block);
+            saver.refs[i].idx = (uint32_t)i;
+        }
+        qsort(saver.refs, saver.num_blocks, sizeof(saver.refs[0]),
+            compare_block_refs);
+        collect_slots(&saver, soft_thread);
+    }
+
+    const size_t filename_len = strlen(filename);
+    char *const temp_filename = malloc(filename_len + 5);
+    if (!temp_filename)
+    {
+        saver.ok = false;
+    }
+    else if (saver.ok)
+    {
+        memcpy(temp_filename, filename, filename_len);
+        memcpy(temp_filename + filename_len, ".tmp", 5);
+        if (!(saver.f = fopen(temp_filename, "wb")))
+        {
+            saver.ok = false;
+        }
+        else
+        {
+            put_state(&saver, soft_thread);
+            if (fclose(saver.f) != 0)
+            {
+                saver.ok = false;
+            }
+            if (saver.ok && rename(temp_filename, filename) != 0)
+            {
+                saver.ok = false;
+            }
+            if (!saver.ok)
+            {
+                remove(temp_filename);
+            }
+        }
+    }
+
+    free(temp_filename);
+    free(saver.blocks);
+    free(saver.refs);
+    free(saver.visited);
+    free(saver.slots);
+    free(saver.todo);
+    return saver.ok;
+}
+
+/* Loading. */
+
+typedef struct
+{
+    FILE *f;
+    bool ok;
+    fcs_pats__block **blocks; /* the new blocks, in the saved order */
+    checkpoint_block_ref *refs; /* the old addresses, sorted */
+    uint64_t *old_bases;        /* the old addresses, in the saved order */
+    size_t num_blocks;
+} checkpoint_loader;
+
+static inline void get(
+    checkpoint_loader *const loader, void *const data, const size_t len)
+{
+    if (!loader->ok || fread(data, 1, len, loader->f) != len)
+    {
+        loader->ok = false;
+        memset(data, 0, len);
+    }
+}
+#define GET(loader, x) get((loader), &(x), sizeof(x))
+
+// Translate an address of the saving process.
+static inline void *relocate(
+    const checkpoint_loader *const loader, const uint64_t addr)
+{
+    const int64_t idx = find_block(loader->refs, loader->num_blocks, addr);
+    if (idx < 0)
+    {
+        return NULL;
+    }
+    return loader->blocks[idx]->block + (addr - loader->old_bases[idx]);
+}
+
+static inline void *get_ptr(checkpoint_loader *const loader)
+{
+    uint64_t addr;
+    GET(loader, addr);
+    return relocate(loader, addr);
+}
+
+static inline void get_current_pos(
+    checkpoint_loader *const loader, fcs_pats_thread *const soft_thread)
+{
+    DECLARE_STACKS();
+    for (int w = 0; w < LOCAL_STACKS_NUM; w++)
+    {
+        var_AUTO(col, fcs_state_get_col(soft_thread->current_pos.s, w));
+        fcs_card len;
+        GET(loader, len);
+        if (len > MAX_NUM_CARDS_IN_A_STACK)
+        {
+            loader->ok = false;
+            return;
+        }
+        fcs_col_len(col) = len;
+        for (int i = 0; i < len; i++)
+        {
+            GET(loader, fcs_col_get_card(col, i));
+        }
+        fcs_col_get_card(col, (int)len) = '\0';
+        int32_t ids[3];
+        GET(loader, ids);
+        soft_thread->current_pos.stack_hashes[w] = (uint32_t)ids[0];
+        soft_thread->current_pos.stack_ids[w] = ids[1];
+        soft_thread->current_pos.column_idxs[w] = ids[2];
+    }
+#if MAX_NUM_FREECELLS > 0
+    for (int i = 0; i < LOCAL_FREECELLS_NUM; i++)
+    {
+        GET(loader, fcs_freecell_card(soft_thread->current_pos.s, i));
+    }
+#endif
+    for (int o = 0; o < 4; o++)
+    {
+        fcs_card value;
+        GET(loader, value);
+        fcs_set_foundation(soft_thread->current_pos.s, o, value);
+    }
+}
+
+static inline bool get_piles(checkpoint_loader *const loader,
+    fcs_pats_thread *const soft_thread, const int num_piles)
+{
+    if (num_piles < 0 || num_piles > FC_SOLVE__MAX_NUM_PILES)
+    {
+        return false;
+    }
+    for (int i = 0; i < num_piles; i++)
+    {
+        uint32_t hash_and_len[2];
+        GET(loader, hash_and_len);
+        if (!loader->ok)
+        {
+            return false;
+        }
+        var_AUTO(l, fc_solve_pats__new(soft_thread, fcs_pats__bucket_list));
+        if (!l)
+        {
+            return false;
+        }
+        l->pile = fc_solve_pats__new_array(
+            soft_thread, unsigned char, hash_and_len[1] + 1);
+        if (!l->pile)
+        {
+            fc_solve_pats__free_ptr(soft_thread, l, fcs_pats__bucket_list);
+            return false;
+        }
+        get(loader, l->pile, hash_and_len[1]);
+        l->pile[hash_and_len[1]] = '\0';
+        l->hash = hash_and_len[0];
+        l->pilenum = i;
+        l->next = NULL;
+
+        // Keep the order of the hash chains.
+        const_AUTO(bucket, l->hash % FC_SOLVE_BUCKETLIST_NBUCKETS);
+        var_PTR(tail, &soft_thread->buckets_list[bucket]);
+        while (*tail)
+        {
+            tail = &(*tail)->next;
+        }
+        *tail = l;
+        soft_thread->bucket_from_pile_lookup[i] = l;
+        soft_thread->next_pile_idx = i + 1;
+    }
+    return loader->ok;
+}
+
+static inline bool get_blocks(
+    checkpoint_loader *const loader, fcs_pats_thread *const soft_thread)
+{
+    loader->blocks = SMALLOC(loader->blocks, loader->num_blocks);
+    loader->refs = SMALLOC(loader->refs, loader->num_blocks);
+    loader->old_bases = SMALLOC(loader->old_bases, loader->num_blocks);
+    if (!loader->blocks || !loader->refs || !loader->old_bases)
+    {
+        return false;
+    }
+    fcs_pats__block **next_ptr = &soft_thread->my_block;
+    for (size_t i = 0; i < loader->num_blocks; i++)
+    {
+        uint64_t remaining;
+        GET(loader, loader->refs[i].base);
+        GET(loader, remaining);
+        loader->refs[i].idx = (uint32_t)i;
+        loader->old_bases[i] = loader->refs[i].base;
+        if (!loader->ok || remaining > FC_SOLVE__PATS__BLOCKSIZE)
+        {
+            return false;
+        }
+        var_AUTO(b, fc_solve_pats__new_block(soft_thread));
+        if (!b)
+        {
+            return false;
+        }
+        b->remaining = (size_t)remaining;
+        b->ptr = b->block + (FC_SOLVE__PATS__BLOCKSIZE - b->remaining);
+        loader->blocks[i] = b;
+        *next_ptr = b;
+        next_ptr = &b->next;
+    }
+    qsort(loader->refs, loader->num_blocks, sizeof(loader->refs[0]),
+        compare_block_refs);
+    return true;
+}
+
+static inline bool get_state(
+    checkpoint_loader *const loader, fcs_pats_thread *const soft_thread)
+{
+    checkpoint_header header, expected;
+    GET(loader, header);
+    fill_header(soft_thread, &expected);
+    if (!loader->ok || memcmp(&header, &expected, sizeof(header)))
+    {
+        return false;
+    }
+
+    checkpoint_scalars scalars;
+    GET(loader, scalars);
+    if (!loader->ok)
+    {
+        return false;
+    }
+    soft_thread->num_checked_states = scalars.num_checked_states;
+    soft_thread->num_states_in_collection = scalars.num_states_in_collection;
+    soft_thread->beam_seq = scalars.beam_seq;
+    soft_thread->num_beam_discarded = scalars.num_beam_discarded;
+    soft_thread->dequeue__minpos = scalars.dequeue__minpos;
+    soft_thread->dequeue__qpos = scalars.dequeue__qpos;
+    soft_thread->max_queue_idx = scalars.max_queue_idx;
+    soft_thread->num_solutions = scalars.num_solutions;
+    soft_thread->num_moves_to_cut_off = scalars.num_moves_to_cut_off;
+    soft_thread->solution_len_bound = scalars.solution_len_bound;
+    soft_thread->initial_solution_len_bound =
+        scalars.initial_solution_len_bound;
+    soft_thread->beam_width = scalars.beam_width;
+    soft_thread->max_beam_width = scalars.max_beam_width;
+    soft_thread->beam_depth = scalars.beam_depth;
+    soft_thread->curr_solve_depth = scalars.curr_solve_depth;
+    // The -H history is rebuilt from the solve stack.
+    soft_thread->history_depth = -1;
+    soft_thread->curr_solve_dir = scalars.curr_solve_dir;
+    soft_thread->to_stack = scalars.to_stack;
+    soft_thread->dont_exit_on_sol = scalars.dont_exit_on_sol;
+    soft_thread->pats_solve_params = scalars.pats_solve_params;
+    loader->num_blocks = scalars.num_blocks;
+
+    get_current_pos(loader, soft_thread);
+    fc_solve_pats__index_cards(soft_thread);
+    if (!get_piles(loader, soft_thread, scalars.next_pile_idx))
+    {
+        return false;
+    }
+
+    /* The pointers outside the blocks can only be relocated once we know
+    where the old blocks were, which comes later.  Keep them for now. */
+    const size_t num_levels = (size_t)max(scalars.num_solve_levels, 0);
+    const size_t num_ptrs = (size_t)scalars.num_tree_lists +
+                            2 * FC_SOLVE_PATS__NUM_QUEUES + 2 + 2 * num_levels;
+    uint64_t *const ptrs = SMALLOC(ptrs, num_ptrs + 1);
+    if (!ptrs)
+    {
+        return false;
+    }
+    size_t ptr_idx = 0;
+
+    for (int32_t i = 0; i < scalars.num_tree_lists; i++)
+    {
+        int32_t bucket_and_cluster[2];
+        GET(loader, bucket_and_cluster);
+        GET(loader, ptrs[ptr_idx++]);
+        if (!loader->ok || bucket_and_cluster[0] < 0 ||
+            bucket_and_cluster[0] >= FCS_PATS__TREE_LIST_NUM_BUCKETS)
+        {
+            free(ptrs);
+            return false;
+        }
+        var_AUTO(tl, fc_solve_pats__new(soft_thread, fcs_pats__treelist));
+        if (!tl)
+        {
+            free(ptrs);
+            return false;
+        }
+        tl->tree = NULL;
+        tl->cluster = bucket_and_cluster[1];
+        tl->next = NULL;
+        var_PTR(tail, &soft_thread->tree_list[bucket_and_cluster[0]]);
+        while (*tail)
+        {
+            tail = &(*tail)->next;
+        }
+        *tail = tl;
+    }
+    for (int i = 0; i < 2 * FC_SOLVE_PATS__NUM_QUEUES + 2; i++)
+    {
+        GET(loader, ptrs[ptr_idx++]);
+    }
+
+    if ((int)num_levels > soft_thread->max_solve_depth)
+    {
+        var_AUTO(new_stack, SREALLOC(soft_thread->solve_stack, num_levels));
+        if (!new_stack)
+        {
+            free(ptrs);
+            return false;
+        }
+        soft_thread->solve_stack = new_stack;
+        soft_thread->max_solve_depth = (int)num_levels;
+    }
+    for (size_t i = 0; i < num_levels; i++)
+    {
+        var_AUTO(level, &soft_thread->solve_stack[i]);
+        GET(loader, ptrs[ptr_idx++]);
+        GET(loader, ptrs[ptr_idx++]);
+        int32_t moves[4];
+        GET(loader, moves);
+        level->num_moves = moves[0];
+        level->q = moves[1];
+        level->moves_start = NULL;
+        if (!loader->ok || moves[2] > FCS_PATS__MAX_NUM_MOVES ||
+            moves[3] < 0 || moves[3] > max(moves[2], 0))
+        {
+            free(ptrs);
+            return false;
+        }
+        if (moves[2] >= 0)
+        {
+            level->moves_start = fc_solve_pats__new_array(
+                soft_thread, fcs_pats__move, (size_t)moves[2]);
+            if (!level->moves_start)
+            {
+                free(ptrs);
+                return false;
+            }
+            get(loader, level->moves_start,
+                sizeof(level->moves_start[0]) * (size_t)moves[2]);
+            level->moves_end = level->moves_start + moves[2];
+            level->move_ptr = level->moves_start + moves[3];
+        }
+    }
+
+    // The beam layers.
+    uint64_t *beam_ptrs = NULL;
+    size_t num_beam_ptrs = 0;
+    if (scalars.num_beam_layers > 0)
+    {
+        soft_thread->beam_layers = calloc(
+            (size_t)scalars.num_beam_layers, sizeof(fcs_pats__beam_layer));
+        if (!soft_thread->beam_layers)
+        {
+            free(ptrs);
+            return false;
+        }
+        soft_thread->num_beam_layers = scalars.num_beam_layers;
+    }
+    for (int i = 0; i < scalars.num_beam_layers; i++)
+    {
+        var_AUTO(layer, &soft_thread->beam_layers[i]);
+        int32_t counts[4];
+        GET(loader, counts);
+        if (!loader->ok || counts[0] < 0 || counts[1] < 0 ||
+            counts[1] > counts[0] || counts[2] < 0 || counts[2] > counts[1])
+        {
+            free(ptrs);
+            free(beam_ptrs);
+            return false;
+        }
+        if (counts[0])
+        {
+            layer->items = fc_solve_pats__new_array(
+                soft_thread, fcs_pats__beam_item, (size_t)counts[0]);
+            var_AUTO(new_beam_ptrs, SREALLOC(beam_ptrs,
+                                        num_beam_ptrs + (size_t)counts[1] + 1));
+            if (!layer->items || !new_beam_ptrs)
+            {
+                free(ptrs);
+                free(new_beam_ptrs ? new_beam_ptrs : beam_ptrs);
+                return false;
+            }
+            beam_ptrs = new_beam_ptrs;
+        }
+        layer->capacity = counts[0];
+        layer->count = counts[1];
+        layer->next = counts[2];
+        layer->is_sorted = counts[3];
+        for (int j = 0; j < layer->count; j++)
+        {
+            uint64_t seq;
+            int32_t pri;
+            GET(loader, beam_ptrs[num_beam_ptrs++]);
+            GET(loader, seq);
+            GET(loader, pri);
+            layer->items[j].seq = seq;
+            layer->items[j].pri = pri;
+        }
+    }
+
+    if (scalars.num_moves_to_win)
+    {
+        soft_thread->moves_to_win = SMALLOC(
+            soft_thread->moves_to_win, (size_t)scalars.num_moves_to_win);
+        if (!soft_thread->moves_to_win)
+        {
+            free(ptrs);
+            free(beam_ptrs);
+            return false;
+        }
+        soft_thread->num_moves_to_win = (size_t)scalars.num_moves_to_win;
+        get(loader, soft_thread->moves_to_win,
+            sizeof(soft_thread->moves_to_win[0]) *
+                soft_thread->num_moves_to_win);
+    }
+
+    // Now the blocks, and the pointers in them.
+    bool ok = get_blocks(loader, soft_thread);
+    uint64_t num_slots = 0;
+    GET(loader, num_slots);
+    if (ok && loader->ok)
+    {
+        const long pos = ftell(loader->f);
+        const size_t data_len =
+            loader->num_blocks * (size_t)FC_SOLVE__PATS__BLOCKSIZE;
+        uint64_t *const slots = SMALLOC(slots, (size_t)num_slots + 1);
+        get(loader, slots, sizeof(slots[0]) * (size_t)num_slots);
+        if (!slots || pos < 0 ||
+            fseek(loader->f,
+                (long)((uint64_t)pos + sizeof(slots[0]) * num_slots +
+                       (CHECKPOINT_PAGE_SIZE -
+                           ((uint64_t)pos + sizeof(slots[0]) * num_slots) %
+                               CHECKPOINT_PAGE_SIZE) %
+                           CHECKPOINT_PAGE_SIZE),
+                SEEK_SET) != 0)
+        {
+            ok = false;
+        }
+        for (size_t i = 0; ok && i < loader->num_blocks; i++)
+        {
+            get(loader, loader->blocks[i]->block, FC_SOLVE__PATS__BLOCKSIZE);
+        }
+        ok = ok && loader->ok && data_len > 0;
+        for (uint64_t i = 0; ok && i < num_slots; i++)
+        {
+            const uint64_t idx = slots[i] >> 32;
+            const uint64_t offset = slots[i] & 0xFFFFFFFF;
+            if (idx >= loader->num_blocks ||
+                offset + sizeof(void *) > FC_SOLVE__PATS__BLOCKSIZE)
+            {
+                ok = false;
+                break;
+            }
+            unsigned char *const slot = loader->blocks[idx]->block + offset;
+            void *old;
+            memcpy(&old, slot, sizeof(old));
+            void *const new_ptr = relocate(loader, ptr_to_u64(old));
+            memcpy(slot, &new_ptr, sizeof(new_ptr));
+        }
+        free(slots);
+    }
+    else
+    {
+        ok = false;
+    }
+
+    if (ok)
+    {
+        ptr_idx = 0;
+        for (int i = 0; i < FCS_PATS__TREE_LIST_NUM_BUCKETS; i++)
+        {
+            for (var_AUTO(tl, soft_thread->tree_list[i]); tl; tl = tl->next)
+            {
+                tl->tree = relocate(loader, ptrs[ptr_idx++]);
+            }
+        }
+        for (int i = 0; i < FC_SOLVE_PATS__NUM_QUEUES; i++)
+        {
+            soft_thread->queue_head[i] = relocate(loader, ptrs[ptr_idx++]);
+            soft_thread->queue_tail[i] = relocate(loader, ptrs[ptr_idx++]);
+        }
+        soft_thread->freed_positions = relocate(loader, ptrs[ptr_idx++]);
+        soft_thread->curr_solve_pos = relocate(loader, ptrs[ptr_idx++]);
+        for (size_t i = 0; i < num_levels; i++)
+        {
+            soft_thread->solve_stack[i].parent =
+                relocate(loader, ptrs[ptr_idx++]);
+            soft_thread->solve_stack[i].pos = relocate(loader, ptrs[ptr_idx++]);
+        }
+        size_t beam_idx = 0;
+        for (int i = 0; i < soft_thread->num_beam_layers; i++)
+        {
+            const_AUTO(layer, &soft_thread->beam_layers[i]);
+            for (int j = 0; j < layer->count; j++)
+            {
+                layer->items[j].pos = relocate(loader, beam_ptrs[beam_idx++]);
+            }
+        }
+    }
+
+    free(ptrs);
+    free(beam_ptrs);
+    return ok;
+}
+
+bool fc_solve_pats__load_checkpoint(
+    fcs_pats_thread *const soft_thread, const char *const filename)
+{
+    // Start from an empty search, as fc_solve_pats__before_play() does.
+    fc_solve_pats__init_buckets(soft_thread);
+    memset(soft_thread->tree_list, 0, sizeof(soft_thread->tree_list));
+    soft_thread->my_block = NULL;
+    fc_solve_pats__soft_thread_reset_helper(soft_thread);
+    for (int i = 0; i < FC_SOLVE_PATS__NUM_QUEUES; i++)
+    {
+        soft_thread->queue_head[i] = NULL;
+    }
+
+    checkpoint_loader loader = {.ok = true};
+    if (!(loader.f = fopen(filename, "rb")))
+    {
+        return false;
+    }
+    const bool ok = get_state(&loader, soft_thread);
+    fclose(loader.f);
+    free(loader.blocks);
+    free(loader.refs);
+    free(loader.old_bases);
+    if (ok)
+    {
+        fc_solve_pats__start_clocks(soft_thread);
+    }
+    return ok;
+}
@@ -0,0 +1,25 @@
+// This file is part of patsolve. It is subject to the license terms in
+// the LICENSE file found in the top-level directory of this distribution
+// and at https://github.com/shlomif/patsolve/blob/master/LICENSE . No
+// part of patsolve, including this file, may be copied, modified, propagated,
+// or distributed except according to the terms contained in the COPYING file.
+//
+// checkpoint.h : saving and restoring an in-progress search.
+#pragma once
+
+#include "pat.h"
+
+/* Save the whole search state of soft_thread (which must be between calls
+to fc_solve_pats__do_it()) to filename.  The file is written under a
+temporary name and renamed, so an existing checkpoint is only replaced by a
+complete one.  Returns false on I/O errors. */
+extern bool fc_solve_pats__save_checkpoint(
+    fcs_pats_thread *soft_thread, const char *filename);
+
+/* Restore a search saved by fc_solve_pats__save_checkpoint() by the same
+build, instead of calling fc_solve_pats__before_play().  soft_thread must
+be configured for the same variant and have a layout read into it (which
+only provides the storage for the current position).  Returns false if the
+file can't be read or doesn't match. */
+extern bool fc_solve_pats__load_checkpoint(
+    fcs_pats_thread *soft_thread, const char *filename);
@@ -0,0 +1,601 @@
+// This file is part of patsolve. It is subject to the license terms in
+// the LICENSE file found in the top-level directory of this distribution
+// and at https://github.com/shlomif/patsolve/blob/master/LICENSE . No
+// part of patsolve, including this file, may be copied, modified, propagated,
+// or distributed except according to the terms contained in the COPYING file.
+//
+// pats-coordinator : hand out ranges of boards to threaded-pats workers
+// (threaded-pats --coordinator=<address>), on this host or on others, and
+// print their results in board order, the same as patsolve would.
+//
+// The protocol is line based.  A worker sends "HELLO <len>\n" and <len>
+// bytes of the banner that patsolve prints before the boards, and then
+// "GET\n".  The coordinator replies "RANGE <start> <end>\n" (end excluded)
+// or "DONE\n".  The worker replies "RESULT <start> <end> <len>\n" and <len>
+// bytes of output, and then sends "GET\n" again.
+//
+// A range is leased to one worker.  If the worker disconnects, or the lease
+// expires (--lease), the range is handed out again.  The first result for a
+// range wins, and a worker that sends the result of a range that it wasn't
+// handed is disconnected.  Once every range is written, the coordinator
+// answers the other workers' GETs with DONE, closes the connections of the
+// workers that are still solving (ranges that were handed out again) and
+// stops the workers that it started.
+//
+// With no deals to solve, it waits for the banner of a worker that it
+// started (--spawn), but without --spawn it prints nothing.
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "pats__print_msg.h"
+#include "pats_clock.h"
+#include "pats_socket.h"
+
+static const char Usage[] =
+    "usage: %s --listen=<address> [--chunk=<n>] [--lease=<secs>]\n"
+    "    [--spawn=<n>] [--worker=<path>] [threaded-pats options]\n"
+    "Solve the deals from PATSOLVE_START up to but not including\n"
+    "PATSOLVE_END with threaded-pats workers, and print what patsolve would.\n"
+    "--listen=<address> listen at unix:<path> or <host>:<port>\n"
+    "--chunk=<n> hand out <n> deals at a time (default 1000)\n"
+    "--lease=<secs> hand a range out again if a worker hasn't finished it\n"
+    "    after <secs> seconds (default 0, only when the worker is gone)\n"
+    "--spawn=<n> start <n> workers on this host\n"
+    "--worker=<path> the threaded-pats to start (default: the one next to\n"
+    "    pats-coordinator)\n"
+    "The other options are passed to the workers that it starts.\n";
+
+typedef struct
+{
+    long long start, end;
+} board_range;
+
+typedef struct pending_result
+{
+    board_range range;
+    struct pending_result *next;
+    size_t len;
+    char text[];
+} pending_result;
+
+typedef enum
+{
+    READING_COMMAND,
+    READING_BANNER,
+    READING_RESULT,
+} client_state;
+
+typedef struct
+{
+    int fd;
+    client_state state;
+    char *buf;
+    size_t buf_len, buf_size;
+    // The payload that is being read, and its length.
+    board_range result_range;
+    size_t payload_len;
+    // Waiting for a range, after a GET that couldn't be answered yet.
+    bool is_waiting;
+    // Solving a range that it hasn't sent the result of.
+    bool is_busy;
+    bool has_lease;
+    board_range lease;
+    long long lease_deadline;
+} client;
+
+static long long start_board_num, end_board_num, next_unassigned,
+    next_to_write;
+static long long chunk_size = 1000, lease_usecs = 0;
+static bool is_banner_printed = false;
+// Ranges that must be handed out again, and results that wait for them.
+static board_range *requeued;
+static size_t num_requeued, max_requeued;
+static pending_result *pending_results;
+static client *clients;
+static size_t num_clients;
+
+static inline bool is_done(void) { return next_to_write >= end_board_num; }
+
+static inline bool is_written_or_pending(const board_range range)
+{
+    if (range.start < next_to_write)
+    {
+        return true;
+    }
+    for (const pending_result *p = pending_results; p; p = p->next)
+    {
+        if (p->range.start == range.start)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Whether the range is one that serve() handed out: they are the chunks of
+the deals from start_board_num, up to next_unassigned. */
+static inline bool was_handed_out(const board_range range)
+{
+    if (range.start < start_board_num || range.start >= next_unassigned ||
+        (range.start - start_board_num) % chunk_size != 0)
+    {
+        return false;
+    }
+    const long long end = range.start + chunk_size;
+    return (range.end == (end < end_board_num ? end : end_board_num));
+}
+
+/* Whether the client may send the result of the range: the last one that it
+was handed, or one that was handed out and isn't written yet. */
+static inline bool is_result_expected(
+    const client *const c, const board_range range)
+{
+    if (c->is_busy && range.start == c->lease.start &&
+        range.end == c->lease.end)
+    {
+        return true;
+    }
+    return (was_handed_out(range) && !is_written_or_pending(range));
+}
+
+static void requeue(const board_range range)
+{
+    if (is_written_or_pending(range))
+    {
+        return;
+    }
+    if (num_requeued == max_requeued)
+    {
+        max_requeued = (max_requeued ? max_requeued * 2 : 16);
+        requeued = realloc(requeued, max_requeued * sizeof(requeued[0]));
+        if (!requeued)
+        {
+            fatalerr("Out of memory.");
+        }
+    }
+    requeued[num_requeued++] = range;
+}
+
+static void unrequeue(const board_range range)
+{
+    for (size_t i = 0; i < num_requeued; ++i)
+    {
+        if (requeued[i].start == range.start)
+        {
+            requeued[i] = requeued[--num_requeued];
+            return;
+        }
+    }
+}
+
+static void send_line(client *const c, const char *const line)
+{
+    // A failed write shows up as a read error or EOF in the poll loop.
+    fc_solve_pats__write_all(c->fd, line, strlen(line));
+}
+
+// Answer a GET: lease the next range to the client, if there is one.
+static void serve(client *const c)
+{
+    char line[100];
+    board_range range;
+    if (num_requeued > 0)
+    {
+        range = requeued[--num_requeued];
+    }
+    else if (next_unassigned < end_board_num)
+    {
+        range.start = next_unassigned;
+        range.end = next_unassigned +
+                    ((end_board_num - next_unassigned < chunk_size)
+                            ? (end_board_num - next_unassigned)
+                            : chunk_size);
+        next_unassigned = range.end;
+    }
+    else if (is_done())
+    {
+        c->is_waiting = false;
+        send_line(c, "DONE\n");
+        return;
+    }
+    else
+    {
+        // Everything is leased; wait until a range is done or requeued.
+        c->is_waiting = true;
+        return;
+    }
+    c->is_waiting = false;
+    c->is_busy = true;
+    c->has_lease = true;
+    c->lease = range;
+    c->lease_deadline =
+        (lease_usecs ? fc_solve_pats__wall_usecs() + lease_usecs : 0);
+    snprintf(line, sizeof(line), "RANGE %lld %lld\n", range.start, range.end);
+    send_line(c, line);
+}
+
+static void add_result(
+    const board_range range, const char *const text, const size_t len)
+{
+    unrequeue(range);
+    if (is_written_or_pending(range))
+    {
+        return;
+    }
+    pending_result *const result = malloc(sizeof(*result) + len);
+    if (!result)
+    {
+        fatalerr("Out of memory.");
+    }
+    result->range = range;
+    result->len = len;
+    memcpy(result->text, text, len);
+    pending_result **prev = &pending_results;
+    while (*prev && (*prev)->range.start < range.start)
+    {
+        prev = &(*prev)->next;
+    }
+    result->next = *prev;
+    *prev = result;
+
+    while (pending_results && pending_results->range.start == next_to_write)
+    {
+        pending_result *const next = pending_results;
+        pending_results = next->next;
+        fwrite(next->text, 1, next->len, stdout);
+        next_to_write = next->range.end;
+        free(next);
+    }
+    fflush(stdout);
+}
+
+// Handle the complete commands and payloads in the client's buffer.
+static bool process_input(client *const c)
+{
+    size_t pos = 0;
+    while (true)
+    {
+        char *const input = c->buf + pos;
+        const size_t input_len = c->buf_len - pos;
+        if (c->state != READING_COMMAND)
+        {
+            if (input_len < c->payload_len)
+            {
+                break;
+            }
+            if (c->state == READING_BANNER)
+            {
+                if (!is_banner_printed)
+                {
+                    fwrite(input, 1, c->payload_len, stdout);
+                    is_banner_printed = true;
+                }
+            }
+            else
+            {
+                add_result(c->result_range, input, c->payload_len);
+                c->is_busy = false;
+                if (c->has_lease && c->lease.start == c->result_range.start)
+                {
+                    c->has_lease = false;
+                }
+            }
+            pos += c->payload_len;
+            c->state = READING_COMMAND;
+            continue;
+        }
+        char *const newline = memchr(input, '\n', input_len);
+        if (!newline)
+        {
+            break;
+        }
+        *newline = '\0';
+        pos += (size_t)(newline + 1 - input);
+        if (!strcmp(input, "GET"))
+        {
+            serve(c);
+        }
+        else if (sscanf(input, "HELLO %zu", &c->payload_len) == 1)
+        {
+            c->state = READING_BANNER;
+        }
+        else if (sscanf(input, "RESULT %lld %lld %zu", &c->result_range.start,
+                     &c->result_range.end, &c->payload_len) == 3)
+        {
+            // Merging any other range would skip or repeat deals.
+            if (!is_result_expected(c, c->result_range))
+            {
+                return false;
+            }
+            c->state = READING_RESULT;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    memmove(c->buf, c->buf + pos, c->buf_len - pos);
+    c->buf_len -= pos;
+    return true;
+}
+
+static bool read_from_client(client *const c)
+{
+    if (c->buf_size - c->buf_len < 4096)
+    {
+        c->buf_size = c->buf_size * 2 + 4096;
+        c->buf = realloc(c->buf, c->buf_size);
+        if (!c->buf)
+        {
+            fatalerr("Out of memory.");
+        }
+    }
+    const ssize_t num_read =
+        read(c->fd, c->buf + c->buf_len, c->buf_size - c->buf_len);
+    if (num_read <= 0)
+    {
+        return false;
+    }
+    c->buf_len += (size_t)num_read;
+    return process_input(c);
+}
+
+static void drop_client(const size_t idx)
+{
+    client *const c = &clients[idx];
+    if (c->has_lease)
+    {
+        requeue(c->lease);
+    }
+    close(c->fd);
+    free(c->buf);
+    clients[idx] = clients[--num_clients];
+}
+
+static void add_client(const int fd)
+{
+    clients = realloc(clients, (num_clients + 1) * sizeof(clients[0]));
+    if (!clients)
+    {
+        fatalerr("Out of memory.");
+    }
+    clients[num_clients++] = (client){.fd = fd, .state = READING_COMMAND};
+}
+
+// Hand out the ranges of expired leases again, to the waiting workers.
+static void expire_leases(void)
+{
+    const long long now = fc_solve_pats__wall_usecs();
+    for (size_t i = 0; i < num_clients; ++i)
+    {
+        client *const c = &clients[i];
+        if (c->has_lease && c->lease_deadline && now >= c->lease_deadline)
+        {
+            // Its result is still taken if it comes first.
+            c->has_lease = false;
+            requeue(c->lease);
+        }
+    }
+}
+
+static void serve_waiting_clients(void)
+{
+    for (size_t i = 0; i < num_clients; ++i)
+    {
+        if (clients[i].is_waiting)
+        {
+            serve(&clients[i]);
+        }
+    }
+}
+
+/* Whether a client is about to ask for a range: it is connected, and isn't
+solving one. */
+static bool has_idle_clients(void)
+{
+    for (size_t i = 0; i < num_clients; ++i)
+    {
+        if (!clients[i].is_busy)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static pid_t spawn_worker(const char *const worker_path,
+    const char *const address, const int argc, char **const argv)
+{
+    const pid_t pid = fork();
+    if (pid < 0)
+    {
+        fatalerr("Cannot start a worker.");
+    }
+    if (pid > 0)
+    {
+        return pid;
+    }
+    const size_t address_len = strlen(address);
+    // An empty host is this host.
+    char coordinator_arg[address_len + 30];
+    snprintf(coordinator_arg, sizeof(coordinator_arg), "--coordinator=%s%s",
+        (address[0] == ':' ? "localhost" : ""), address);
+    const char *worker_argv[argc + 3];
+    worker_argv[0] = worker_path;
+    worker_argv[1] = coordinator_arg;
+    for (int i = 0; i < argc; ++i)
+    {
+        worker_argv[i + 2] = argv[i];
+    }
+    worker_argv[argc + 2] = NULL;
+    execvp(worker_path, (char *const *)worker_argv);
+    fprintf(stderr, "Cannot run '%s': %s\n", worker_path, strerror(errno));
+    _exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    program_name = argv[0];
+    const char *address = NULL;
+    const char *worker_path = NULL;
+    int num_spawned = 0;
+    int num_worker_args = 0;
+    char **worker_args = argv + 1;
+    for (int arg_idx = 1; arg_idx < argc; ++arg_idx)
+    {
+        const char *const arg = argv[arg_idx];
+        if (!strcmp(arg, "-h") || !strcmp(arg, "--help"))
+        {
+            USAGE();
+            exit(0);
+        }
+        else if (!strncmp(arg, "--listen=", 9))
+        {
+            address = arg + 9;
+        }
+        else if (!strncmp(arg, "--chunk=", 8))
+        {
+            chunk_size = atoll(arg + 8);
+        }
+        else if (!strncmp(arg, "--lease=", 8))
+        {
+            lease_usecs = atoll(arg + 8) * 1000000LL;
+        }
+        else if (!strncmp(arg, "--spawn=", 8))
+        {
+            num_spawned = atoi(arg + 8);
+        }
+        else if (!strncmp(arg, "--worker=", 9))
+        {
+            worker_path = arg + 9;
+        }
+        else
+        {
+            worker_args[num_worker_args++] = argv[arg_idx];
+        }
+    }
+    if (!address)
+    {
+        USAGE();
+        exit(1);
+    }
+    if (chunk_size < 1 || lease_usecs < 0 || num_spawned < 0)
+    {
+        fatalerr("--chunk must be positive, and --lease and --spawn must "
+                 "not be negative.");
+    }
+    const char *const start_env = getenv("PATSOLVE_START");
+    const char *const end_env = getenv("PATSOLVE_END");
+    if (!start_env || !end_env)
+    {
+        fatalerr("Set PATSOLVE_START and PATSOLVE_END to the deals to solve.");
+    }
+    start_board_num = next_unassigned = next_to_write = atoll(start_env);
+    end_board_num = atoll(end_env);
+
+    // By default, run the threaded-pats that was built with us.
+    char default_worker_path[strlen(argv[0]) + sizeof("threaded-pats")];
+    if (!worker_path)
+    {
+        const char *const slash = strrchr(argv[0], '/');
+        const size_t dir_len = (slash ? (size_t)(slash + 1 - argv[0]) : 0);
+        memcpy(default_worker_path, argv[0], dir_len);
+        strcpy(default_worker_path + dir_len, "threaded-pats");
+        worker_path = default_worker_path;
+    }
+
+    const int listen_fd = fc_solve_pats__open_socket(address, true);
+    if (listen_fd < 0)
+    {
+        fatalerr("Cannot listen at '%s'.", address);
+    }
+    signal(SIGPIPE, SIG_IGN);
+    pid_t spawned[num_spawned + 1];
+    int num_alive = 0;
+    for (int i = 0; i < num_spawned; ++i)
+    {
+        spawned[i] =
+            spawn_worker(worker_path, address, num_worker_args, worker_args);
+        ++num_alive;
+    }
+
+    /* With no deals, still wait for a worker that it started to send the
+    banner, which patsolve prints even then. */
+    while (!is_done() || has_idle_clients() ||
+           (num_alive > 0 && !is_banner_printed))
+    {
+        struct pollfd fds[num_clients + 1];
+        fds[0] = (struct pollfd){.fd = listen_fd, .events = POLLIN};
+        for (size_t i = 0; i < num_clients; ++i)
+        {
+            fds[i + 1] = (struct pollfd){.fd = clients[i].fd, .events = POLLIN};
+        }
+        const size_t num_polled = num_clients;
+        if (poll(fds, num_polled + 1, 1000) < 0 && errno != EINTR)
+        {
+            fatalerr("poll() failed.");
+        }
+        // Drop the clients from the last one, so the indices stay valid.
+        for (size_t i = num_polled; i > 0; --i)
+        {
+            if (fds[i].revents && !read_from_client(&clients[i - 1]))
+            {
+                drop_client(i - 1);
+            }
+        }
+        if (fds[0].revents & POLLIN)
+        {
+            const int fd = accept(listen_fd, NULL, NULL);
+            if (fd >= 0)
+            {
+                add_client(fd);
+            }
+        }
+        expire_leases();
+        serve_waiting_clients();
+
+        pid_t pid;
+        while (num_alive > 0 && (pid = waitpid(-1, NULL, WNOHANG)) > 0)
+        {
+            for (int i = 0; i < num_spawned; ++i)
+            {
+                if (spawned[i] == pid)
+                {
+                    spawned[i] = 0;
+                    --num_alive;
+                }
+            }
+        }
+        if (num_spawned > 0 && num_alive == 0 && num_clients == 0 &&
+            !is_done())
+        {
+            fatalerr("All the workers exited before the deals were done.");
+        }
+    }
+    serve_waiting_clients();
+    while (num_clients > 0)
+    {
+        drop_client(num_clients - 1);
+    }
+    for (int i = 0; i < num_spawned; ++i)
+    {
+        if (spawned[i] && waitpid(spawned[i], NULL, WNOHANG) == 0)
+        {
+            kill(spawned[i], SIGTERM);
+            waitpid(spawned[i], NULL, 0);
+        }
+    }
+    close(listen_fd);
+    if (!strncmp(address, "unix:", 5))
+    {
+        unlink(address + 5);
+    }
+
+    return 0;
+}
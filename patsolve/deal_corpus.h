@@ -0,0 +1,115 @@
+// This file is part of patsolve. It is subject to the license terms in
+// the LICENSE file found in the top-level directory of this distribution
+// and at https://github.com/shlomif/patsolve/blob/master/LICENSE . No
+// part of patsolve, including this file, may be copied, modified, propagated,
+// or distributed except according to the terms contained in the COPYING file.
+//
+// deal_corpus.h : a corpus of deals, as written by pats-msdeal --corpus and
+// read by patsolve and threaded-pats --corpus.  It is a header and then the
+// deals from start_deal_num on, each one the 52 cards in the order that
+// fc_solve_pats__msdeal_shuffle() deals them (one byte each).
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "msdeal.h"
+
+#define FCS_PATS__CORPUS_MAGIC "PATSDEAL"
+
+typedef struct
+{
+    char magic[8];
+    uint32_t header_size, deal_size;
+    uint64_t start_deal_num, num_deals;
+    char reserved[32];
+} fcs_pats__corpus_header;
+
+typedef struct
+{
+    const uint8_t *map;
+    size_t map_len;
+    long long start_deal_num, end_deal_num;
+} fcs_pats__corpus;
+
+static inline void fc_solve_pats__corpus_init_header(
+    fcs_pats__corpus_header *const header, const long long start_deal_num,
+    const long long num_deals)
+{
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, FCS_PATS__CORPUS_MAGIC, sizeof(header->magic));
+    header->header_size = sizeof(*header);
+    header->deal_size = FCS_PATS__MSDEAL_NUM_CARDS;
+    header->start_deal_num = (uint64_t)start_deal_num;
+    header->num_deals = (uint64_t)num_deals;
+}
+
+/* Map the corpus at the path.  Returns false if it cannot, or if the file is
+not a whole corpus. */
+static inline bool fc_solve_pats__corpus_open(
+    fcs_pats__corpus *const corpus, const char *const path)
+{
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat st;
+    fcs_pats__corpus_header header;
+    bool is_ok = (fstat(fd, &st) == 0) &&
+                 (pread(fd, &header, sizeof(header), 0) ==
+                     (ssize_t)sizeof(header)) &&
+                 !memcmp(header.magic, FCS_PATS__CORPUS_MAGIC,
+                     sizeof(header.magic)) &&
+                 header.header_size == sizeof(header) &&
+                 header.deal_size == FCS_PATS__MSDEAL_NUM_CARDS &&
+                 header.start_deal_num <= (uint64_t)INT64_MAX / 2 &&
+                 header.num_deals <= (uint64_t)(st.st_size - sizeof(header)) /
+                                         FCS_PATS__MSDEAL_NUM_CARDS;
+    if (is_ok)
+    {
+        corpus->map_len = sizeof(header) + (size_t)header.num_deals *
+                                               FCS_PATS__MSDEAL_NUM_CARDS;
+        corpus->map = mmap(NULL, corpus->map_len, PROT_READ, MAP_SHARED, fd, 0);
+        is_ok = (corpus->map != MAP_FAILED);
+        corpus->start_deal_num = (long long)header.start_deal_num;
+        corpus->end_deal_num =
+            corpus->start_deal_num + (long long)header.num_deals;
+    }
+    // The map stays valid after the file is closed.
+    close(fd);
+    return is_ok;
+}
+
+/* The cards of a deal, or NULL if the deal is not in the corpus, or it is
+not a deal. */
+static inline const uint8_t *fc_solve_pats__corpus_deal(
+    const fcs_pats__corpus *const corpus, const long long deal_num)
+{
+    if (deal_num < corpus->start_deal_num || deal_num >= corpus->end_deal_num)
+    {
+        return NULL;
+    }
+    const uint8_t *const cards =
+        corpus->map + sizeof(fcs_pats__corpus_header) +
+        (size_t)(deal_num - corpus->start_deal_num) *
+            FCS_PATS__MSDEAL_NUM_CARDS;
+    for (int i = 0; i < FCS_PATS__MSDEAL_NUM_CARDS; i++)
+    {
+        if (cards[i] >= FCS_PATS__MSDEAL_NUM_CARDS)
+        {
+            return NULL;
+        }
+    }
+    return cards;
+}
+
+static inline void fc_solve_pats__corpus_close(fcs_pats__corpus *const corpus)
+{
+    munmap((void *)corpus->map, corpus->map_len);
+}
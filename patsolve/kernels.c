@@ -0,0 +1,50 @@
+// This file is part of patsolve. It is subject to the license terms in
+// the LICENSE file found in the top-level directory of this distribution
+// and at https://github.com/shlomif/patsolve/blob/master/LICENSE . No
+// part of patsolve, including this file, may be copied, modified, propagated,
+// or distributed except according to the terms contained in the COPYING file.
+//
+// The table of solver kernels, and picking the one for a variant.
+
+#include "instance.h"
+#include "pat.h"
+/* FCS_PATS__KERNELS(X) calls X(name, piles, free cells, sequences built by,
+empty piles filled by) for every kernel that CMake generated from
+FCS_PATS_KERNELS. */
+#include "pats_kernels.h"
+
+#define FCS_PATS__DECLARE_KERNEL(name, stacks_num, freecells_num, built_by,    \
+    filled_by)                                                                 \
+    extern void fc_solve_pats__do_it__##name(fcs_pats_thread *);
+FCS_PATS__KERNELS(FCS_PATS__DECLARE_KERNEL)
+
+#define FCS_PATS__KERNEL_ENTRY(name, stacks_num, freecells_num, built_by,      \
+    filled_by)                                                                 \
+    {#name, stacks_num, freecells_num, built_by, filled_by,                    \
+        fc_solve_pats__do_it__##name},
+static const fcs_pats__kernel kernels[] = {
+    FCS_PATS__KERNELS(FCS_PATS__KERNEL_ENTRY){NULL, 0, 0, 0, 0, NULL}};
+
+// Returns NULL if there is no kernel for the variant, or with -G.
+const fcs_pats__kernel *fc_solve_pats__find_kernel(
+    const fcs_pats_thread *const soft_thread)
+{
+    if (soft_thread->use_generic_kernel)
+    {
+        return NULL;
+    }
+    const fcs_instance *const instance = soft_thread->instance;
+    DECLARE_STACKS();
+    for (const fcs_pats__kernel *kernel = kernels; kernel->name; kernel++)
+    {
+        if (kernel->stacks_num == LOCAL_STACKS_NUM &&
+            kernel->freecells_num == LOCAL_FREECELLS_NUM &&
+            kernel->sequences_are_built_by ==
+                (int)GET_INSTANCE_SEQUENCES_ARE_BUILT_BY(instance) &&
+            kernel->empty_stacks_filled_by == (int)INSTANCE_EMPTY_STACKS_FILL)
+        {
+            return kernel;
+        }
+    }
+    return NULL;
+}
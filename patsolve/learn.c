@@ -0,0 +1,508 @@
+// This file is part of patsolve. It is subject to the license terms in
+// the LICENSE file found in the top-level directory of this distribution
+// and at https://github.com/shlomif/patsolve/blob/master/LICENSE . No
+// part of patsolve, including this file, may be copied, modified, propagated,
+// or distributed except according to the terms contained in the COPYING file.
+//
+// pats-learn : learn the weights of --move-weights (see move_model.h) from
+// the solutions that patsolve or threaded-pats wrote with --solutions.  At
+// every position on the way of a solution, the move of the solution should
+// score higher than the other moves that the solver would queue there, so the
+// weights are those of a softmax (multinomial logistic) regression that
+// picks it, fitted by Newton's method.
+#include <math.h>
+
+#include "pat.h"
+#include "read_layout.h"
+#include "pats__play.h"
+#include "pats__print_msg.h"
+#include "deal_corpus.h"
+#include "verify.h"
+
+static const char Usage[] =
+    "usage: %s [-s|f] [-k|a] [-w<n>] [-t<n>] [-P<n>] [-X<n> ...]\n"
+    "    [--corpus=<file>] [--l2=<x>] [--scale=<x>] <file>\n"
+    "Learn the weights of the features of a move (for --move-weights) from\n"
+    "the solutions in <file> (written with --solutions, without -m), so\n"
+    "that the move of the solution scores the highest at each position on\n"
+    "its way.  The deals are dealt, or read from the corpus of pats-msdeal\n"
+    "--corpus.  The weights are printed as a --move-weights file.\n"
+    "--l2=<x> the weight of the L2 penalty on the weights (1 by default)\n"
+    "--scale=<x> multiply the learned weights by <x>, rather than by the\n"
+    "    factor that gives them the spread of the -X priorities of the\n"
+    "    variant (-P and -X choose those)\n";
+
+#define NUM_FEATURES FCS_PATS__NUM_MOVE_FEATURES
+
+// The moves of the positions, and which move of each the solution took.
+static double (*features)[NUM_FEATURES];
+static size_t num_rows, max_num_rows;
+static size_t *group_starts, num_groups, max_num_groups;
+static size_t *chosen;
+
+static void add_group(fcs_pats_thread *const soft_thread,
+    const fcs_pats__move *const moves, const int num_moves,
+    const int chosen_idx)
+{
+    if (num_rows + (size_t)num_moves > max_num_rows)
+    {
+        max_num_rows = max_num_rows * 2 + (size_t)num_moves + 4096;
+        if (!(features = realloc(features, max_num_rows * sizeof(*features))))
+        {
+            fatalerr("Out of memory for the features.");
+        }
+    }
+    if (num_groups + 1 >= max_num_groups)
+    {
+        max_num_groups = max_num_groups * 2 + 1024;
+        group_starts =
+            realloc(group_starts, max_num_groups * sizeof(*group_starts));
+        chosen = realloc(chosen, max_num_groups * sizeof(*chosen));
+        if (!group_starts || !chosen)
+        {
+            fatalerr("Out of memory for the features.");
+        }
+    }
+    fcs_pats__move_context ctx;
+    fc_solve_pats__move_context(soft_thread, &ctx);
+    group_starts[num_groups] = num_rows;
+    chosen[num_groups] = num_rows + (size_t)chosen_idx;
+    for (int i = 0; i < num_moves; i++)
+    {
+        fc_solve_pats__move_features(
+            soft_thread, &ctx, &moves[i], features[num_rows++]);
+    }
+    group_starts[++num_groups] = num_rows;
+}
+
+// Whether a move of the solver is the move of the solution at in.
+static bool is_same_move(const fcs_pats__move *const move_ptr,
+    const uint8_t *const in, const size_t len)
+{
+    const fcs_pats__move_kind kind = (fcs_pats__move_kind)(in[0] >> 6);
+    if (move_ptr->card != fc_solve_pats__verify__card(in[0] & 0x3f) ||
+        move_ptr->num_cards > 1)
+    {
+        return false;
+    }
+    switch (kind)
+    {
+    case FCS_PATS__MOVE_TO_FREECELL:
+        return (move_ptr->totype == FCS_PATS__TYPE_FREECELL);
+    case FCS_PATS__MOVE_TO_FOUNDATION:
+        return (move_ptr->totype == FCS_PATS__TYPE_FOUNDATION);
+    case FCS_PATS__MOVE_TO_EMPTY_PILE:
+        return (move_ptr->totype == FCS_PATS__TYPE_WASTE &&
+                fcs_card_is_empty(move_ptr->destcard));
+    default:
+        return (len >= 2 && move_ptr->totype == FCS_PATS__TYPE_WASTE &&
+                move_ptr->destcard == fc_solve_pats__verify__card(in[1]));
+    }
+}
+
+/* Replay a solution from the position in soft_thread, and add the moves of
+every position on its way where the solver would have had a choice.  Returns
+false if a move of the solution is illegal. */
+static bool add_solution(fcs_pats_thread *const soft_thread,
+    const uint8_t *const moves, const size_t len)
+{
+    // At depth 0, fc_solve_pats__get_moves() prunes nothing by history.
+    fcs_pats_position root = {.depth = 0};
+    for (size_t offset = 0; offset < len;)
+    {
+        fc_solve_pats__index_cards(soft_thread);
+        int num_moves = 0;
+        fcs_pats__move *const solver_moves =
+            fc_solve_pats__get_moves(soft_thread, &root, &num_moves);
+        if (solver_moves)
+        {
+            int chosen_idx = -1;
+            for (int i = 0; i < num_moves && chosen_idx < 0; i++)
+            {
+                if (is_same_move(
+                        &solver_moves[i], moves + offset, len - offset))
+                {
+                    chosen_idx = i;
+                }
+            }
+            if (num_moves > 1 && chosen_idx >= 0)
+            {
+                add_group(soft_thread, solver_moves, num_moves, chosen_idx);
+            }
+            fc_solve_pats__free_array(
+                soft_thread, solver_moves, fcs_pats__move, (size_t)num_moves);
+        }
+        const size_t move_len = fc_solve_pats__verify__move(
+            soft_thread, moves + offset, len - offset);
+        if (!move_len)
+        {
+            return false;
+        }
+        offset += move_len;
+    }
+    return true;
+}
+
+/* The mean negative log likelihood of the moves of the solutions, and its
+gradient and Hessian (if not NULL), with the L2 penalty. */
+static double likelihood(const double *const weights, const double l2,
+    double *const gradient, double hessian[NUM_FEATURES][NUM_FEATURES],
+    double *const accuracy)
+{
+    double nll = 0;
+    size_t num_right = 0;
+    if (gradient)
+    {
+        memset(gradient, 0, sizeof(double) * NUM_FEATURES);
+        memset(hessian, 0, sizeof(double) * NUM_FEATURES * NUM_FEATURES);
+    }
+    for (size_t g = 0; g < num_groups; g++)
+    {
+        const size_t start = group_starts[g], end = group_starts[g + 1];
+        double max_score = -HUGE_VAL;
+        size_t best = start;
+        double scores[end - start];
+        for (size_t r = start; r < end; r++)
+        {
+            scores[r - start] = fc_solve_pats__move_score(weights, features[r]);
+            if (scores[r - start] > max_score)
+            {
+                max_score = scores[r - start];
+                best = r;
+            }
+        }
+        num_right += (best == chosen[g]);
+        double sum = 0;
+        for (size_t r = start; r < end; r++)
+        {
+            sum += exp(scores[r - start] - max_score);
+        }
+        nll += max_score + log(sum) - scores[chosen[g] - start];
+        if (!gradient)
+        {
+            continue;
+        }
+        // The expected features under the softmax, and their covariance.
+        double mean[NUM_FEATURES] = {0};
+        for (size_t r = start; r < end; r++)
+        {
+            const double p = exp(scores[r - start] - max_score) / sum;
+            for (int i = 0; i < NUM_FEATURES; i++)
+            {
+                mean[i] += p * features[r][i];
+            }
+        }
+        for (size_t r = start; r < end; r++)
+        {
+            const double p = exp(scores[r - start] - max_score) / sum;
+            for (int i = 0; i < NUM_FEATURES; i++)
+            {
+                const double di = features[r][i] - mean[i];
+                for (int j = 0; j <= i; j++)
+                {
+                    hessian[i][j] += p * di * (features[r][j] - mean[j]);
+                }
+            }
+        }
+        for (int i = 0; i < NUM_FEATURES; i++)
+        {
+            gradient[i] += mean[i] - features[chosen[g]][i];
+        }
+    }
+    nll /= (double)num_groups;
+    for (int i = 0; i < NUM_FEATURES; i++)
+    {
+        nll += 0.5 * l2 * weights[i] * weights[i] / (double)num_groups;
+    }
+    if (gradient)
+    {
+        for (int i = 0; i < NUM_FEATURES; i++)
+        {
+            gradient[i] = (gradient[i] + l2 * weights[i]) / (double)num_groups;
+            for (int j = 0; j <= i; j++)
+            {
+                hessian[i][j] = hessian[j][i] =
+                    (hessian[i][j] + (i == j ? l2 : 0)) / (double)num_groups;
+            }
+        }
+    }
+    if (accuracy)
+    {
+        *accuracy = (double)num_right / (double)num_groups;
+    }
+    return nll;
+}
+
+/* Solve a x = b for the symmetric positive definite a, which is destroyed,
+by Cholesky decomposition.  Returns false if a is not positive definite. */
+static bool cholesky_solve(double a[NUM_FEATURES][NUM_FEATURES],
+    const double *const b, double *const x)
+{
+    for (int j = 0; j < NUM_FEATURES; j++)
+    {
+        double d = a[j][j];
+        for (int k = 0; k < j; k++)
+        {
+            d -= a[j][k] * a[j][k];
+        }
+        if (d <= 0)
+        {
+            return false;
+        }
+        a[j][j] = sqrt(d);
+        for (int i = j + 1; i < NUM_FEATURES; i++)
+        {
+            double s = a[i][j];
+            for (int k = 0; k < j; k++)
+            {
+                s -= a[i][k] * a[j][k];
+            }
+            a[i][j] = s / a[j][j];
+        }
+    }
+    for (int i = 0; i < NUM_FEATURES; i++)
+    {
+        double s = b[i];
+        for (int k = 0; k < i; k++)
+        {
+            s -= a[i][k] * x[k];
+        }
+        x[i] = s / a[i][i];
+    }
+    for (int i = NUM_FEATURES - 1; i >= 0; i--)
+    {
+        double s = x[i];
+        for (int k = i + 1; k < NUM_FEATURES; k++)
+        {
+            s -= a[k][i] * x[k];
+        }
+        x[i] = s / a[i][i];
+    }
+    return true;
+}
+
+// Minimize the negative log likelihood by Newton's method, from 0.
+static void fit(double *const weights, const double l2)
+{
+    memset(weights, 0, sizeof(double) * NUM_FEATURES);
+    for (int iter = 0; iter < 50; iter++)
+    {
+        double gradient[NUM_FEATURES], hessian[NUM_FEATURES][NUM_FEATURES];
+        double step[NUM_FEATURES];
+        const double nll = likelihood(weights, l2, gradient, hessian, NULL);
+        if (!cholesky_solve(hessian, gradient, step))
+        {
+            fatalerr("The features are degenerate; try a larger --l2.");
+        }
+        // Halve the step until it improves, as the problem is convex.
+        double t = 1, new_weights[NUM_FEATURES], new_nll = nll;
+        for (int halving = 0; halving < 30; halving++, t /= 2)
+        {
+            for (int i = 0; i < NUM_FEATURES; i++)
+            {
+                new_weights[i] = weights[i] - t * step[i];
+            }
+            new_nll = likelihood(new_weights, l2, NULL, NULL, NULL);
+            if (new_nll <= nll)
+            {
+                break;
+            }
+        }
+        if (new_nll > nll)
+        {
+            break;
+        }
+        memcpy(weights, new_weights, sizeof(new_weights));
+        if (nll - new_nll < 1e-9)
+        {
+            break;
+        }
+    }
+}
+
+// The mean spread (standard deviation) of the scores of the moves.
+static double score_spread(const double *const weights)
+{
+    double sum = 0;
+    for (size_t g = 0; g < num_groups; g++)
+    {
+        const size_t start = group_starts[g], end = group_starts[g + 1];
+        double s1 = 0, s2 = 0;
+        for (size_t r = start; r < end; r++)
+        {
+            const double score =
+                fc_solve_pats__move_score(weights, features[r]);
+            s1 += score;
+            s2 += score * score;
+        }
+        const double n = (double)(end - start);
+        sum += sqrt(fmax(s2 / n - (s1 / n) * (s1 / n), 0));
+    }
+    return sum / (double)num_groups;
+}
+
+static bool read_record(FILE *const in, fcs_pats__solution_header *const header,
+    uint8_t **const moves, size_t *const moves_size)
+{
+    if (fread(header, sizeof(*header), 1, in) != 1)
+    {
+        return false;
+    }
+    if (header->len > *moves_size)
+    {
+        *moves_size = header->len;
+        if (!(*moves = realloc(*moves, *moves_size)))
+        {
+            fatalerr("Out of memory for the moves.");
+        }
+    }
+    if (fread(*moves, 1, header->len, in) != header->len)
+    {
+        fatalerr("The solutions end in the middle of deal %lld.",
+            (long long)header->board_num);
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    program_name = argv[0];
+    const char *corpus_path = NULL;
+    double l2 = 1, scale = 0;
+    /* Take our own long options out, and leave the rest for
+    fc_solve_pats__configure_soft_thread(). */
+    int new_argc = 1;
+    for (int arg_idx = 1; arg_idx < argc; ++arg_idx)
+    {
+        const char *const arg = argv[arg_idx];
+        if (!strcmp(arg, "-h") || !strcmp(arg, "--help"))
+        {
+            USAGE();
+            exit(0);
+        }
+        else if (!strncmp(arg, "--corpus=", 9))
+        {
+            corpus_path = arg + 9;
+        }
+        else if (!strncmp(arg, "--l2=", 5))
+        {
+            l2 = atof(arg + 5);
+        }
+        else if (!strncmp(arg, "--scale=", 8))
+        {
+            scale = atof(arg + 8);
+        }
+        else if (!strncmp(arg, "--", 2))
+        {
+            fatalerr("Unknown option '%s'.", arg);
+        }
+        else
+        {
+            argv[new_argc++] = argv[arg_idx];
+        }
+    }
+    argc = new_argc;
+    argv[argc] = NULL;
+    if (l2 <= 0)
+    {
+        fatalerr("--l2 needs a positive number.");
+    }
+
+    fcs_pats_thread soft_thread_struct__dont_use_directly;
+    fcs_pats_thread *const soft_thread = &soft_thread_struct__dont_use_directly;
+    fcs_instance instance_struct;
+    bool is_quiet = true;
+    fc_solve_pats__configure_soft_thread(soft_thread, &instance_struct, &argc,
+        (const char ***)(&argv), &is_quiet);
+    if (argc != 1)
+    {
+        USAGE();
+        exit(1);
+    }
+    const char *const path = *argv;
+    fcs_pats__corpus corpus = {.map = NULL};
+    if (corpus_path && !fc_solve_pats__corpus_open(&corpus, corpus_path))
+    {
+        fatalerr("Cannot read the corpus '%s'.", corpus_path);
+    }
+
+    FILE *const in = fopen(path, "rb");
+    char magic[8];
+    if (!in || fread(magic, sizeof(magic), 1, in) != 1 ||
+        memcmp(magic, FCS_PATS__SOLUTIONS_MAGIC, sizeof(magic)))
+    {
+        fatalerr("'%s' is not a stream of solutions.", path);
+    }
+    fcs_pats__solution_header header;
+    uint8_t *moves = NULL;
+    size_t moves_size = 0;
+    unsigned long num_solutions = 0;
+    while (read_record(in, &header, &moves, &moves_size))
+    {
+        if (header.status != fc_solve_pats__result_code("Won") || !header.len)
+        {
+            continue;
+        }
+        if (corpus.map)
+        {
+            const uint8_t *const cards =
+                fc_solve_pats__corpus_deal(&corpus, header.board_num);
+            if (!cards)
+            {
+                fatalerr("Deal %lld is not in the corpus.",
+                    (long long)header.board_num);
+            }
+            fc_solve_pats__read_dealt_cards(soft_thread, cards);
+        }
+        else
+        {
+            fc_solve_pats__read_deal(soft_thread, header.board_num);
+        }
+        if (!add_solution(soft_thread, moves, header.len))
+        {
+            fatalerr("The solution of deal %lld is not legal in this variant "
+                     "(see pats-verify).",
+                (long long)header.board_num);
+        }
+        num_solutions++;
+    }
+    fclose(in);
+    free(moves);
+    if (!num_groups)
+    {
+        fatalerr("The solutions have no positions with a choice of moves.");
+    }
+
+    double weights[NUM_FEATURES], x_weights[NUM_FEATURES];
+    fit(weights, l2);
+    fc_solve_pats__move_weights_from_params(
+        &soft_thread->pats_solve_params, x_weights);
+    if (!scale)
+    {
+        scale = score_spread(x_weights) / fmax(score_spread(weights), 1e-9);
+    }
+    double accuracy, x_accuracy;
+    const double nll = likelihood(weights, l2, NULL, NULL, &accuracy);
+    likelihood(x_weights, l2, NULL, NULL, &x_accuracy);
+    for (int i = 0; i < NUM_FEATURES; i++)
+    {
+        weights[i] *= scale;
+    }
+
+    printf("# pats-learn, on %zu positions of %lu solutions: the move of the\n"
+           "# solution scores the highest at %.1f%% of them (%.1f%% with the "
+           "-X\n# priorities), at a log loss of %.3f.  Scaled by %.3f.\n",
+        num_groups, num_solutions, 100 * accuracy, 100 * x_accuracy, nll,
+        scale);
+    fc_solve_pats__move_weights_print(weights, stdout);
+
+    if (corpus.map)
+    {
+        fc_solve_pats__corpus_close(&corpus);
+    }
+    fc_solve_pats__destroy_soft_thread(soft_thread);
+    free(features);
+    free(group_starts);
+    free(chosen);
+    return 0;
+}
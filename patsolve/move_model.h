@@ -0,0 +1,395 @@
+// This file is part of patsolve. It is subject to the license terms in
+// the LICENSE file found in the top-level directory of this distribution
+// and at https://github.com/shlomif/patsolve/blob/master/LICENSE . No
+// part of patsolve, including this file, may be copied, modified, propagated,
+// or distributed except according to the terms contained in the COPYING file.
+//
+// move_model.h : the learned move ordering (--move-weights).  Instead of the
+// fixed priorities of the -X parameters, the priority of a move is the sum
+// of its features, weighted by a file of "<feature> <weight>" lines:
+//
+//     # Lines that start with '#' are comments.
+//     pile_to_pile 4.2
+//     uncover_depth -0.8
+//
+// Features that the file leaves out have a weight of 0.  pats-learn learns
+// the weights from the solutions of --solutions, and pats-tune --move-weights
+// tunes them on the positions checked per deal.
+#pragma once
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "pat.h"
+
+typedef enum
+{
+    // The kind of move, one of which is 1 (see get_possible_moves()).
+    FCS_PATS__MOVE_FEATURE_OUT,
+    FCS_PATS__MOVE_FEATURE_PILE_TO_EMPTY_PILE,
+    FCS_PATS__MOVE_FEATURE_PILE_TO_PILE,
+    FCS_PATS__MOVE_FEATURE_FREECELL_TO_PILE,
+    FCS_PATS__MOVE_FEATURE_FREECELL_TO_EMPTY_PILE,
+    FCS_PATS__MOVE_FEATURE_PILE_TO_FREECELL,
+    /* How many of the next two cards of each suit to go out are in the
+    pile that the move is from, and in the one it is to. */
+    FCS_PATS__MOVE_FEATURE_NEEDED_IN_SOURCE,
+    FCS_PATS__MOVE_FEATURE_NEEDED_IN_DEST,
+    // The move uncovers the next card of its suit to go out.
+    FCS_PATS__MOVE_FEATURE_UNCOVERS_NEEDED,
+    // See fc_solve_pats__is_irreversible_move().
+    FCS_PATS__MOVE_FEATURE_IRREVERSIBLE,
+    /* The cards that are still above the nearest of those needed cards to
+    the top of the pile that the move is from. */
+    FCS_PATS__MOVE_FEATURE_UNCOVER_DEPTH,
+    // The free cells and the empty piles that are left after the move.
+    FCS_PATS__MOVE_FEATURE_FREE_CELLS,
+    FCS_PATS__MOVE_FEATURE_EMPTY_PILES,
+    FCS_PATS__MOVE_FEATURE_EMPTIES_PILE,
+    // The move takes a card off a card that it is in sequence on.
+    FCS_PATS__MOVE_FEATURE_BREAKS_RUN,
+    /* The length of the sequence that the card ends on top of, and the
+    cards under that sequence in the pile it is moved to. */
+    FCS_PATS__MOVE_FEATURE_RUN_LENGTH,
+    FCS_PATS__MOVE_FEATURE_DEST_BURIED,
+    FCS_PATS__MOVE_FEATURE_RANK,
+    FCS_PATS__NUM_MOVE_FEATURES
+} fcs_pats__move_feature;
+
+static const char
+    *const fc_solve_pats__move_feature_names[FCS_PATS__NUM_MOVE_FEATURES] = {
+        "out", "pile_to_empty_pile", "pile_to_pile", "freecell_to_pile",
+        "freecell_to_empty_pile", "pile_to_freecell", "needed_in_source",
+        "needed_in_dest", "uncovers_needed", "irreversible", "uncover_depth",
+        "free_cells", "empty_piles", "empties_pile", "breaks_run",
+        "run_length", "dest_buried", "rank"};
+
+/* Moves that can't be undone get slightly higher priority, since it means
+we are moving a card for the first time. */
+static inline bool fc_solve_pats__is_irreversible_move(
+#ifndef FCS_FREECELL_ONLY
+    const fcs_card game_variant_suit_mask,
+    const fcs_card game_variant_desired_suit_value,
+#endif
+    const bool King_only, const fcs_pats__move *const move_ptr)
+{
+    if (move_ptr->totype == FCS_PATS__TYPE_FOUNDATION)
+    {
+        return true;
+    }
+    else if (move_ptr->fromtype == FCS_PATS__TYPE_WASTE)
+    {
+        const_SLOT(srccard, move_ptr);
+        if (fcs_card_is_valid(srccard))
+        {
+            const_SLOT(card, move_ptr);
+            if ((fcs_card_rank(card) != fcs_card_rank(srccard) - 1) ||
+                !fcs_pats_is_suitable(card, srccard
+#ifndef FCS_FREECELL_ONLY
+                    ,
+                    game_variant_suit_mask, game_variant_desired_suit_value
+#endif
+                    ))
+            {
+                return true;
+            }
+        }
+        /* TODO : This is probably a bug because move_ptr->card probably cannot
+         * be
+         * FCS_PATS__KING - only FCS_PATS__KING bitwise-ORed with some other
+         * value.
+         * */
+        else if (King_only &&
+                 move_ptr->card != fcs_make_card(FCS_PATS__KING, 0))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// What the features of the moves from a position have in common.
+typedef struct
+{
+    fcs_card needed_cards[FCS_NUM_SUITS];
+    int num_needed[MAX_NUM_STACKS];
+    // The depth of the needed card nearest the top of each pile, or -1.
+    int needed_depth[MAX_NUM_STACKS];
+    // The length of each pile, and of the sequence on top of it.
+    int col_lens[MAX_NUM_STACKS];
+    int run_lens[MAX_NUM_STACKS];
+    int num_free_cells, num_empty_piles;
+} fcs_pats__move_context;
+
+// Fill the context from soft_thread->current_pos and its card locations.
+static inline void fc_solve_pats__move_context(
+    fcs_pats_thread *const soft_thread, fcs_pats__move_context *const ctx)
+{
+    DECLARE_STACKS();
+#ifndef FCS_FREECELL_ONLY
+    const fcs_instance *const instance = soft_thread->instance;
+    (void)instance;
+    const fcs_card game_variant_suit_mask = FCS_PATS__SUIT_MASK(instance);
+    const fcs_card game_variant_desired_suit_value =
+        FCS_PATS__DESIRED_SUIT_VALUE(instance);
+#endif
+    const fcs_state *const s = &soft_thread->current_pos.s;
+    ctx->num_free_cells = ctx->num_empty_piles = 0;
+#if MAX_NUM_FREECELLS > 0
+    for (int t = 0; t < LOCAL_FREECELLS_NUM; t++)
+    {
+        ctx->num_free_cells += fcs_freecell_is_empty(*s, t);
+    }
+#endif
+    for (int w = 0; w < LOCAL_STACKS_NUM; w++)
+    {
+        const_AUTO(col, fcs_state_get_col(*s, w));
+        const int col_len = ctx->col_lens[w] = fcs_col_len(col);
+        ctx->num_needed[w] = 0;
+        ctx->needed_depth[w] = -1;
+        ctx->num_empty_piles += (col_len == 0);
+        int run_len = (col_len > 0);
+        while (run_len < col_len)
+        {
+            const fcs_card above = fcs_col_get_card(col, col_len - run_len);
+            const fcs_card below =
+                fcs_col_get_card(col, col_len - run_len - 1);
+            if (fcs_card_rank(below) != fcs_card_rank(above) + 1 ||
+                !fcs_pats_is_suitable(above, below
+#ifndef FCS_FREECELL_ONLY
+                    ,
+                    game_variant_suit_mask, game_variant_desired_suit_value
+#endif
+                    ))
+            {
+                break;
+            }
+            run_len++;
+        }
+        ctx->run_lens[w] = run_len;
+    }
+
+    // The same cards as the ones that prioritize() looks for.
+    const fcs_pats__card_loc *const card_locs =
+        soft_thread->current_pos.card_locs;
+    for (int suit = 0; suit < FCS_NUM_SUITS; suit++)
+    {
+        ctx->needed_cards[suit] = fc_solve_empty_card;
+        const int rank = fcs_foundation_value(*s, suit);
+        for (int r = rank + 1; r <= min(rank + 2, FCS_PATS__KING); r++)
+        {
+            const fcs_card card = fcs_make_card(r, suit);
+            if (r == rank + 1)
+            {
+                ctx->needed_cards[suit] = card;
+            }
+            const_AUTO(loc, card_locs[card]);
+            if (loc.col != FCS_PATS__NOT_IN_COLUMN)
+            {
+                ctx->num_needed[loc.col]++;
+                ctx->needed_depth[loc.col] =
+                    max(ctx->needed_depth[loc.col], (int)loc.depth);
+            }
+        }
+    }
+}
+
+static inline void fc_solve_pats__move_features(
+    fcs_pats_thread *const soft_thread,
+    const fcs_pats__move_context *const ctx,
+    const fcs_pats__move *const move_ptr,
+    double features[FCS_PATS__NUM_MOVE_FEATURES])
+{
+#ifndef FCS_FREECELL_ONLY
+    const fcs_instance *const instance = soft_thread->instance;
+    (void)instance;
+    const fcs_card game_variant_suit_mask = FCS_PATS__SUIT_MASK(instance);
+    const fcs_card game_variant_desired_suit_value =
+        FCS_PATS__DESIRED_SUIT_VALUE(instance);
+    const bool King_only =
+        (INSTANCE_EMPTY_STACKS_FILL == FCS_ES_FILLED_BY_KINGS_ONLY);
+#else
+    const bool King_only = false;
+#endif
+    memset(features, 0, sizeof(double) * FCS_PATS__NUM_MOVE_FEATURES);
+    const int num_cards = max((int)move_ptr->num_cards, 1);
+    const bool from_pile = (move_ptr->fromtype == FCS_PATS__TYPE_WASTE);
+    const bool to_pile = (move_ptr->totype == FCS_PATS__TYPE_WASTE);
+    const bool to_empty_pile =
+        (to_pile && fcs_card_is_empty(move_ptr->destcard));
+
+    fcs_pats__move_feature kind = FCS_PATS__MOVE_FEATURE_OUT;
+    if (move_ptr->totype == FCS_PATS__TYPE_FREECELL)
+    {
+        kind = FCS_PATS__MOVE_FEATURE_PILE_TO_FREECELL;
+    }
+    else if (to_pile && from_pile)
+    {
+        kind = (to_empty_pile ? FCS_PATS__MOVE_FEATURE_PILE_TO_EMPTY_PILE
+                              : FCS_PATS__MOVE_FEATURE_PILE_TO_PILE);
+    }
+    else if (to_pile)
+    {
+        kind = (to_empty_pile ? FCS_PATS__MOVE_FEATURE_FREECELL_TO_EMPTY_PILE
+                              : FCS_PATS__MOVE_FEATURE_FREECELL_TO_PILE);
+    }
+    features[kind] = 1;
+
+    int num_free_cells = ctx->num_free_cells;
+    int num_empty_piles = ctx->num_empty_piles;
+    if (from_pile)
+    {
+        const int w = move_ptr->from;
+        features[FCS_PATS__MOVE_FEATURE_NEEDED_IN_SOURCE] = ctx->num_needed[w];
+        const fcs_card srccard = move_ptr->srccard;
+        features[FCS_PATS__MOVE_FEATURE_UNCOVERS_NEEDED] =
+            (fcs_card_is_valid(srccard) &&
+                srccard == ctx->needed_cards[(int)fcs_card_suit(srccard)]);
+        if (ctx->needed_depth[w] >= 0)
+        {
+            features[FCS_PATS__MOVE_FEATURE_UNCOVER_DEPTH] =
+                max(ctx->col_lens[w] - num_cards - 1 - ctx->needed_depth[w],
+                    0);
+        }
+        const bool empties_pile = (ctx->col_lens[w] == num_cards);
+        features[FCS_PATS__MOVE_FEATURE_EMPTIES_PILE] = empties_pile;
+        num_empty_piles += empties_pile;
+        features[FCS_PATS__MOVE_FEATURE_BREAKS_RUN] =
+            (ctx->run_lens[w] > num_cards);
+    }
+    else
+    {
+        num_free_cells++;
+    }
+    if (to_pile)
+    {
+        const int w = move_ptr->to;
+        features[FCS_PATS__MOVE_FEATURE_NEEDED_IN_DEST] = ctx->num_needed[w];
+        features[FCS_PATS__MOVE_FEATURE_RUN_LENGTH] =
+            (to_empty_pile ? 0 : ctx->run_lens[w]) + num_cards;
+        features[FCS_PATS__MOVE_FEATURE_DEST_BURIED] =
+            (to_empty_pile ? 0 : ctx->col_lens[w] - ctx->run_lens[w]);
+        num_empty_piles -= to_empty_pile;
+    }
+    else if (move_ptr->totype == FCS_PATS__TYPE_FREECELL)
+    {
+        num_free_cells--;
+    }
+    features[FCS_PATS__MOVE_FEATURE_FREE_CELLS] = num_free_cells;
+    features[FCS_PATS__MOVE_FEATURE_EMPTY_PILES] = num_empty_piles;
+    features[FCS_PATS__MOVE_FEATURE_IRREVERSIBLE] =
+        fc_solve_pats__is_irreversible_move(
+#ifndef FCS_FREECELL_ONLY
+            game_variant_suit_mask, game_variant_desired_suit_value,
+#endif
+            King_only, move_ptr);
+    features[FCS_PATS__MOVE_FEATURE_RANK] = fcs_card_rank(move_ptr->card);
+}
+
+static inline double fc_solve_pats__move_score(const double *const weights,
+    const double features[FCS_PATS__NUM_MOVE_FEATURES])
+{
+    double score = 0;
+    for (int i = 0; i < FCS_PATS__NUM_MOVE_FEATURES; i++)
+    {
+        score += weights[i] * features[i];
+    }
+    return score;
+}
+
+/* Set the priorities of the moves (the ones that were not pruned) by
+soft_thread->move_weights. */
+static inline void fc_solve_pats__score_moves(
+    fcs_pats_thread *const soft_thread, fcs_pats__move *const moves_start,
+    const int n)
+{
+    fcs_pats__move_context ctx;
+    fc_solve_pats__move_context(soft_thread, &ctx);
+    const_AUTO(moves_end, moves_start + n);
+    for (fcs_pats__move *move_ptr = moves_start; move_ptr < moves_end;
+        move_ptr++)
+    {
+        if (fcs_card_is_empty(move_ptr->card))
+        {
+            continue;
+        }
+        double features[FCS_PATS__NUM_MOVE_FEATURES];
+        fc_solve_pats__move_features(soft_thread, &ctx, move_ptr, features);
+        const double score =
+            fc_solve_pats__move_score(soft_thread->move_weights, features);
+        move_ptr->pri = (signed char)fmax(-128.0, fmin(127.0, round(score)));
+    }
+}
+
+/* The weights of the features that the -X parameters score, as a start for
+tuning.  The priorities are close to those of -X, but not the same:
+mark_irreversible() adds x[8] in the first n slots of the moves, which may
+be pruned ones while kept ones lie past them, and the sum is clamped here
+where prioritize() lets it wrap. */
+static inline void fc_solve_pats__move_weights_from_params(
+    const fcs_pats_xy_params *const params,
+    double weights[FCS_PATS__NUM_MOVE_FEATURES])
+{
+    memset(weights, 0, sizeof(double) * FCS_PATS__NUM_MOVE_FEATURES);
+    weights[FCS_PATS__MOVE_FEATURE_NEEDED_IN_SOURCE] = params->x[0];
+    weights[FCS_PATS__MOVE_FEATURE_UNCOVERS_NEEDED] = params->x[1];
+    weights[FCS_PATS__MOVE_FEATURE_NEEDED_IN_DEST] = -params->x[2];
+    weights[FCS_PATS__MOVE_FEATURE_PILE_TO_EMPTY_PILE] = params->x[3];
+    weights[FCS_PATS__MOVE_FEATURE_PILE_TO_PILE] = params->x[4];
+    weights[FCS_PATS__MOVE_FEATURE_FREECELL_TO_PILE] = params->x[5];
+    weights[FCS_PATS__MOVE_FEATURE_FREECELL_TO_EMPTY_PILE] = params->x[6];
+    weights[FCS_PATS__MOVE_FEATURE_PILE_TO_FREECELL] = params->x[7];
+    weights[FCS_PATS__MOVE_FEATURE_IRREVERSIBLE] = params->x[8];
+}
+
+/* Read the weights of the features from a file.  Returns 0, or the number of
+the first bad line, or -1 if the file cannot be read. */
+static inline int fc_solve_pats__move_weights_load(
+    double weights[FCS_PATS__NUM_MOVE_FEATURES], const char *const path)
+{
+    memset(weights, 0, sizeof(double) * FCS_PATS__NUM_MOVE_FEATURES);
+    FILE *const fh = fopen(path, "r");
+    if (!fh)
+    {
+        return -1;
+    }
+    int line_num = 0, ret = 0;
+    char line[1024];
+    while (!ret && fgets(line, sizeof(line), fh))
+    {
+        ++line_num;
+        char name[64];
+        double weight;
+        if (line[0] == '#' || sscanf(line, " %63s", name) != 1)
+        {
+            continue;
+        }
+        ret = line_num;
+        if (sscanf(line, " %63s %lf", name, &weight) != 2)
+        {
+            break;
+        }
+        for (int i = 0; i < FCS_PATS__NUM_MOVE_FEATURES; i++)
+        {
+            if (!strcmp(name, fc_solve_pats__move_feature_names[i]))
+            {
+                weights[i] = weight;
+                ret = 0;
+            }
+        }
+    }
+    fclose(fh);
+    return ret;
+}
+
+static inline void fc_solve_pats__move_weights_print(
+    const double weights[FCS_PATS__NUM_MOVE_FEATURES], FILE *const out)
+{
+    for (int i = 0; i < FCS_PATS__NUM_MOVE_FEATURES; i++)
+    {
+        fprintf(out, "%s %.3f\n", fc_solve_pats__move_feature_names[i],
+            weights[i]);
+    }
+}
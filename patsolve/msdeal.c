@@ -6,123 +6,169 @@
 //
 // Copyright (c) 2002 Tom Holroyd
 // Deal Microsoft Freecell / FreeCell-Pro deals.
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <stdint.h>
 
-typedef unsigned long long LONG;
-typedef uint32_t UINT;
-typedef int CARD;
+#include "deal_corpus.h"
 
-#define NUM_CARDS 52
-
-static LONG seedx;
-
-static inline void srandp(UINT s) { seedx = (LONG)s; }
-
-static inline UINT randp(void)
-{
-    seedx = seedx * 214013L + 2531011L;
-    return (seedx >> 16) & 0xffff;
-}
-
-static inline void srando(UINT s) { seedx = (LONG)s; }
+static const char Rank[] = "A23456789TJQK";
+static const char Suit[] = "CDHS";
 
-static inline UINT rando(void)
+static void usage(const char *const program_name)
 {
-    seedx = seedx * 214013L + 2531011L;
-    return (seedx >> 16) & 0x7fff;
+    fprintf(stderr,
+        "usage: %s [s] number\n"
+        "       %s --corpus=<file> [--threads=<n>] <start> <end>\n"
+        "The second form writes the deals from <start> up to but not\n"
+        "including <end> to <file>, for patsolve --corpus=<file>.\n",
+        program_name, program_name);
+    exit(1);
 }
 
-static const char Rank[] = "A23456789TJQK";
-static const char Suit[] = "CDHS";
+static uint8_t *corpus_deals;
+static long long corpus_start_deal_num, corpus_num_deals;
+static int num_threads;
 
-int main(int argc, char **argv)
+// Deal the thread's share of the corpus.
+static void *deal_part(void *const void_thread_idx)
 {
-    int j, c;
-    // num_left_cards is the cards left to be chosen in shuffle
-    int num_left_cards = NUM_CARDS;
-    CARD deck[NUM_CARDS];
-    CARD pos[10][10];
-
-    size_t stacks_num = 8;
-    if (argc > 2 && argv[1][0] == 's')
+    const long long thread_idx = (long long)(intptr_t)void_thread_idx;
+    const long long start = corpus_num_deals * thread_idx / num_threads;
+    const long long end = corpus_num_deals * (thread_idx + 1) / num_threads;
+    for (long long i = start; i < end; i++)
     {
-        stacks_num = 10;
-        argv++;
-        argc--;
+        fc_solve_pats__msdeal_shuffle(
+            (unsigned long long)(corpus_start_deal_num + i),
+            FCS_PATS__MSDEAL_NUM_CARDS,
+            corpus_deals + i * FCS_PATS__MSDEAL_NUM_CARDS);
     }
+    return NULL;
+}
 
-    if (argc != 2)
+static void write_corpus(const char *const path,
+    const long long start_deal_num, const long long end_deal_num)
+{
+    corpus_start_deal_num = start_deal_num;
+    corpus_num_deals = end_deal_num - start_deal_num;
+    const size_t len =
+        sizeof(fcs_pats__corpus_header) +
+        (size_t)corpus_num_deals * FCS_PATS__MSDEAL_NUM_CARDS;
+    const int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0666);
+    // Allocate the blocks now, rather than fail on a write to the map.
+    if (fd < 0 || posix_fallocate(fd, 0, (off_t)len) != 0)
     {
-        fprintf(stderr, "usage: %s number\n", argv[0]);
+        fprintf(stderr, "Cannot write the corpus '%s'.\n", path);
         exit(1);
     }
-    const LONG gnGameNumber = strtoul(argv[1], NULL, 10);
-
-    memset(pos, 0, sizeof(pos));
-    for (int i = 0; i < NUM_CARDS; i++)
+    uint8_t *const map =
+        mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED)
     {
-        deck[i] = i + 1;
+        fprintf(stderr, "Cannot map the corpus '%s'.\n", path);
+        exit(1);
     }
+    fc_solve_pats__corpus_init_header(
+        (fcs_pats__corpus_header *)map, start_deal_num, corpus_num_deals);
+    corpus_deals = map + sizeof(fcs_pats__corpus_header);
 
-    if (gnGameNumber < 0x100000000)
+    pthread_t threads[num_threads];
+    for (int i = 0; i < num_threads; i++)
     {
-        srando((UINT)gnGameNumber);
+        if (pthread_create(&threads[i], NULL, deal_part, (void *)(intptr_t)i))
+        {
+            fprintf(stderr, "Cannot start a thread.\n");
+            exit(1);
+        }
     }
-    else
+    for (int i = 0; i < num_threads; i++)
     {
-        srandp((UINT)(gnGameNumber - 0x100000000));
+        pthread_join(threads[i], NULL);
     }
+    munmap(map, len);
+    close(fd);
+}
+
+int main(int argc, char **argv)
+{
+    const char *const program_name = argv[0];
+    uint8_t cards[FCS_PATS__MSDEAL_NUM_CARDS];
 
-    for (int i = 0; i < NUM_CARDS; i++)
+    if (argc > 1 && !strncmp(argv[1], "--corpus=", 9))
     {
-        if (gnGameNumber < 0x100000000)
+        const char *const path = argv[1] + 9;
+        argv++;
+        argc--;
+        num_threads = 0;
+        if (argc > 1 && !strncmp(argv[1], "--threads=", 10))
         {
-            if (gnGameNumber < 0x80000000)
-            {
-                j = rando() % num_left_cards;
-            }
-            else
-            {
-                j = (rando() | 0x8000) % num_left_cards;
-            }
+            num_threads = atoi(argv[1] + 10);
+            argv++;
+            argc--;
+        }
+        if (argc != 3)
+        {
+            usage(program_name);
         }
-        else
+        const long long start_deal_num = atoll(argv[1]);
+        const long long end_deal_num = atoll(argv[2]);
+        if (start_deal_num < 0 || end_deal_num < start_deal_num)
         {
-            j = (randp() + 1) % num_left_cards;
+            usage(program_name);
         }
-        pos[i % stacks_num][i / stacks_num] = deck[j];
-        deck[j] = deck[--num_left_cards];
-        if (stacks_num == 10 && i == 49)
+        if (num_threads < 1)
         {
-            break;
+            // Only the huge ranges are worth more than one thread.
+            const long long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+            const long long num_chunks =
+                (end_deal_num - start_deal_num) / 100000 + 1;
+            num_threads =
+                (int)((num_chunks < num_cpus) ? num_chunks : num_cpus);
+            if (num_threads < 1)
+            {
+                num_threads = 1;
+            }
         }
+        write_corpus(path, start_deal_num, end_deal_num);
+        return 0;
     }
-    for (size_t i = 0; i < stacks_num; i++)
+
+    int stacks_num = 8;
+    if (argc > 2 && argv[1][0] == 's')
     {
-        j = 0;
-        while (pos[i][j])
+        stacks_num = 10;
+        argv++;
+        argc--;
+    }
+
+    if (argc != 2)
+    {
+        usage(program_name);
+    }
+    const unsigned long long gnGameNumber = strtoull(argv[1], NULL, 10);
+
+    // Seahaven deals 50 cards to the piles, and the other two to the cells.
+    const int num_dealt = (stacks_num == 10) ? 50 : FCS_PATS__MSDEAL_NUM_CARDS;
+    fc_solve_pats__msdeal_shuffle(gnGameNumber, num_dealt, cards);
+    for (int i = 0; i < stacks_num; i++)
+    {
+        for (int j = i; j < num_dealt; j += stacks_num)
         {
-            c = pos[i][j] - 1;
-            j++;
+            const int c = cards[j];
             printf("%c%c ", Rank[c / 4], Suit[c % 4]);
         }
         putchar('\n');
     }
     // leftover cards to temp
-    c = -1;
-    for (size_t i = 0; i < 4; i++)
+    for (int j = num_dealt; j < FCS_PATS__MSDEAL_NUM_CARDS; j++)
     {
-        if (num_left_cards)
-        {
-            j = --num_left_cards;
-            c = deck[j] - 1;
-            printf("%c%c ", Rank[c / 4], Suit[c % 4]);
-        }
+        const int c = cards[j];
+        printf("%c%c ", Rank[c / 4], Suit[c % 4]);
     }
-    if (c >= 0)
+    if (num_dealt < FCS_PATS__MSDEAL_NUM_CARDS)
+    {
         putchar('\n');
+    }
     return 0;
 }
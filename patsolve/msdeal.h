@@ -0,0 +1,62 @@
+// This file is part of patsolve. It is subject to the license terms in
+// the LICENSE file found in the top-level directory of this distribution
+// and at https://github.com/shlomif/patsolve/blob/master/LICENSE . No
+// part of patsolve, including this file, may be copied, modified, propagated,
+// or distributed except according to the terms contained in the COPYING file.
+//
+// Copyright (c) 2002 Tom Holroyd
+// msdeal.h : the shuffle of the Microsoft Freecell deals, and of the
+// FreeCell Pro deals that follow them (deal numbers from 2^32 on).
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define FCS_PATS__MSDEAL_NUM_CARDS 52
+
+/* Shuffle deal number deal_num.  The first num_dealt cards are in the
+order they are dealt (card i goes to pile i % the number of piles), and the
+rest are the cards left over, from the top of the deck.  A card is
+rank * 4 + suit, with the ranks from the Ace (0) and the suits in the order
+"CDHS" (the byte of pats-msdeal --corpus). */
+static inline void fc_solve_pats__msdeal_shuffle(
+    const unsigned long long deal_num, const int num_dealt,
+    uint8_t cards[FCS_PATS__MSDEAL_NUM_CARDS])
+{
+    uint8_t deck[FCS_PATS__MSDEAL_NUM_CARDS];
+    // num_left_cards is the cards left to be chosen in shuffle
+    int num_left_cards = FCS_PATS__MSDEAL_NUM_CARDS;
+    for (int i = 0; i < FCS_PATS__MSDEAL_NUM_CARDS; i++)
+    {
+        deck[i] = (uint8_t)i;
+    }
+
+    const bool is_freecell_pro = (deal_num >= 0x100000000ULL);
+    // Only the low 32 bits of the seed matter.
+    uint32_t seedx = (uint32_t)(is_freecell_pro ? (deal_num - 0x100000000ULL)
+                                                : deal_num);
+    for (int i = 0; i < num_dealt; i++)
+    {
+        seedx = seedx * 214013U + 2531011U;
+        uint32_t r;
+        if (is_freecell_pro)
+        {
+            r = ((seedx >> 16) & 0xffff) + 1;
+        }
+        else
+        {
+            r = (seedx >> 16) & 0x7fff;
+            if (deal_num >= 0x80000000ULL)
+            {
+                r |= 0x8000;
+            }
+        }
+        const int j = (int)(r % (uint32_t)num_left_cards);
+        cards[i] = deck[j];
+        deck[j] = deck[--num_left_cards];
+    }
+    for (int i = num_dealt; i < FCS_PATS__MSDEAL_NUM_CARDS; i++)
+    {
+        cards[i] = deck[--num_left_cards];
+    }
+}
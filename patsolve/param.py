@@ -15,6 +15,7 @@ with open('param.c', 'w') as c:
 #include "freecell-solver/fcs_pats_xy_param.h"
 
 extern const fcs_pats_xy_params freecell_solver_pats__x_y_params_preset[];
+extern const char *const freecell_solver_pats__x_y_params_preset_names[];
 
 """)
 
@@ -26,11 +27,13 @@ const fcs_pats_xy_params freecell_solver_pats__x_y_params_preset[] = {
 """)
 
         p = 0
+        names = []
         with open(filename) as infh:
             for line in infh:
                 if line[0] == '#' or line[0] == '\n':
                     continue
                 fields = line.split()
+                names.append(fields[0])
                 h.write(
                     "#define FC_SOLVE_PATS__PARAM_PRESET__%s %d\n" %
                     (fields[0], p)
@@ -46,6 +49,14 @@ const fcs_pats_xy_params freecell_solver_pats__x_y_params_preset[] = {
 
         c.write("};\n")
 
+        c.write(
+            "\nconst char *const freecell_solver_pats__x_y_params_preset_names"
+            "[] = {\n"
+        )
+        for name in names:
+            c.write('    "%s",\n' % name)
+        c.write("};\n")
+
         h.write(
             "#define FC_SOLVE_PATS__PARAM_PRESET__LastParam %d\n" % (p - 1)
         )
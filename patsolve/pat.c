@@ -7,19 +7,7 @@
 // Copyright (c) 2002 Tom Holroyd
 #include "rinutils/count.h"
 #include "instance.h"
-
-static inline int calc_empty_col_idx(
-    fcs_pats_thread *const soft_thread, const int stacks_num)
-{
-    for (int w = 0; w < stacks_num; w++)
-    {
-        if (fcs_state_col_is_empty(soft_thread->current_pos.s, w))
-        {
-            return w;
-        }
-    }
-    return -1;
-}
+#include "move_model.h"
 
 // Automove logic.  Freecell games must avoid certain types of automoves.
 static inline bool good_automove(
@@ -27,6 +15,7 @@ static inline bool good_automove(
 {
     FCS_ON_NOT_FC_ONLY(
         const fcs_instance *const instance = soft_thread->instance);
+    FCS_ON_NOT_FC_ONLY((void)instance);
 
     if (
 #ifndef FCS_FREECELL_ONLY
@@ -68,31 +57,58 @@ static inline bool good_automove(
 
     return true;
 }
+/* The working representation for get_possible_moves(): sets of columns or
+freecells as bit masks, so the legal targets of a card are a few bit
+operations away instead of a loop over all the columns. */
+typedef uint64_t fcs_pats__pile_mask;
+#if MAX_NUM_STACKS > 64 || MAX_NUM_FREECELLS > 64
+#error "get_possible_moves() keeps the columns and freecells in 64-bit masks."
+#endif
+
+// Remove the lowest pile from the mask and return its index.
+static inline int pop_lowest_pile(fcs_pats__pile_mask *const mask)
+{
+    const int idx = __builtin_ctzll(*mask);
+    *mask &= *mask - 1;
+    return idx;
+}
+
 /* Get the possible moves from a position, and store them in
  * soft_thread->possible_moves[]. */
-
 static inline int get_possible_moves(
     fcs_pats_thread *const soft_thread, bool *const a, int *const num_cards_out)
 {
     FCS_ON_NOT_FC_ONLY(
         const fcs_instance *const instance = soft_thread->instance);
+    FCS_ON_NOT_FC_ONLY((void)instance);
     DECLARE_STACKS();
 
-    /* Check for moves from soft_thread->current_pos.stacks to
-     * soft_thread->current_pos.foundations. */
+    /* The columns by their top card's rank and suit, and the empty ones.
+    Also check for moves from soft_thread->current_pos.stacks to
+    soft_thread->current_pos.foundations while we are at it. */
+    fcs_pats__pile_mask cols_by_rank[FCS_PATS__KING + 2] = {0};
+    fcs_pats__pile_mask cols_by_suit[FCS_NUM_SUITS] = {0};
+    fcs_pats__pile_mask non_empty_cols = 0, empty_cols = 0;
+    fcs_card top_cards[MAX_NUM_STACKS];
+    int col_lens[MAX_NUM_STACKS];
 
 #define NUM_MOVES (move_ptr - soft_thread->possible_moves)
     var_PTR(move_ptr, soft_thread->possible_moves);
     for (int w = 0; w < LOCAL_STACKS_NUM; ++w)
     {
         const_AUTO(col, fcs_state_get_col(soft_thread->current_pos.s, w));
-        const int col_len = fcs_col_len(col);
+        const int col_len = col_lens[w] = fcs_col_len(col);
+        const fcs_pats__pile_mask bit = ((fcs_pats__pile_mask)1) << w;
         if (!col_len)
         {
+            empty_cols |= bit;
             continue;
         }
-        const fcs_card card = fcs_col_get_card(col, col_len - 1);
+        const fcs_card card = top_cards[w] = fcs_col_get_card(col, col_len - 1);
         const int o = fcs_card_suit(card);
+        non_empty_cols |= bit;
+        cols_by_rank[fcs_card_rank(card)] |= bit;
+        cols_by_suit[o] |= bit;
         if (fcs_card_rank(card) ==
             fcs_foundation_value(soft_thread->current_pos.s, o) + 1)
         {
@@ -122,6 +138,7 @@ static inline int get_possible_moves(
     /* Check for moves from soft_thread->current_pos.freecells to
      * soft_thread->current_pos.foundations. */
 
+    fcs_pats__pile_mask occupied_freecells = 0;
     for (int t = 0; t < LOCAL_FREECELLS_NUM; t++)
     {
         const fcs_card card = fcs_freecell_card(soft_thread->current_pos.s, t);
@@ -129,6 +146,7 @@ static inline int get_possible_moves(
         {
             continue;
         }
+        occupied_freecells |= ((fcs_pats__pile_mask)1) << t;
         const int o = fcs_card_suit(card);
         if (fcs_card_rank(card) ==
             fcs_foundation_value(soft_thread->current_pos.s, o) + 1)
@@ -170,19 +188,22 @@ static inline int get_possible_moves(
         true;
 #endif
 
-    const int empty_col_idx = calc_empty_col_idx(soft_thread, LOCAL_STACKS_NUM);
-    const bool has_empty_col = (empty_col_idx >= 0);
+    const bool has_empty_col = (empty_cols != 0);
     if (has_empty_col)
     {
-        for (int i = 0; i < LOCAL_STACKS_NUM; i++)
+        fcs_pats__pile_mask empty_col_mask = empty_cols;
+        const int empty_col_idx = pop_lowest_pile(&empty_col_mask);
+        for (fcs_pats__pile_mask cols = non_empty_cols; cols;)
         {
-            const_AUTO(i_col, fcs_state_get_col(soft_thread->current_pos.s, i));
-            const int i_col_len = fcs_col_len(i_col);
+            const int i = pop_lowest_pile(&cols);
+            const int i_col_len = col_lens[i];
             if (i_col_len > 1)
             {
-                const fcs_card card = fcs_col_get_card(i_col, i_col_len - 1);
+                const fcs_card card = top_cards[i];
                 if (fcs_pats_is_king_only(not_King_only, card))
                 {
+                    const_AUTO(i_col,
+                        fcs_state_get_col(soft_thread->current_pos.s, i));
                     *(move_ptr++) = (typeof(*move_ptr)){
                         .card = card,
                         .from = (unsigned char)i,
@@ -198,112 +219,93 @@ static inline int get_possible_moves(
         }
     }
 
+    /* The columns that a card of each suit can be put on, regardless of
+    rank.  Suitability only depends on the suits. */
 #ifndef FCS_FREECELL_ONLY
-    const fcs_card game_variant_suit_mask = instance->game_variant_suit_mask;
+    const fcs_card game_variant_suit_mask = FCS_PATS__SUIT_MASK(instance);
     const fcs_card game_variant_desired_suit_value =
-        instance->game_variant_desired_suit_value;
+        FCS_PATS__DESIRED_SUIT_VALUE(instance);
 #endif
-    /* Check for moves from soft_thread->current_pos.stacks to non-empty
-     * soft_thread->current_pos.stacks cells. */
-    for (int i = 0; i < LOCAL_STACKS_NUM; i++)
+    fcs_pats__pile_mask cols_by_parent_suit[FCS_NUM_SUITS] = {0};
+    for (int o = 0; o < FCS_NUM_SUITS; o++)
     {
-        const_AUTO(i_col, fcs_state_get_col(soft_thread->current_pos.s, i));
-        const int i_col_len = fcs_col_len(i_col);
-        if (i_col_len > 0)
+        for (int s = 0; s < FCS_NUM_SUITS; s++)
         {
-            const fcs_card card = fcs_col_get_card(i_col, i_col_len - 1);
-            for (int w = 0; w < LOCAL_STACKS_NUM; w++)
-            {
-                if (i == w)
-                {
-                    continue;
-                }
-                const_AUTO(
-                    w_col, fcs_state_get_col(soft_thread->current_pos.s, w));
-                if (fcs_col_len(w_col) > 0)
-                {
-                    const fcs_card w_card =
-                        fcs_col_get_card(w_col, fcs_col_len(w_col) - 1);
-                    if (fcs_card_rank(card) == fcs_card_rank(w_card) - 1 &&
-                        fcs_pats_is_suitable(card, w_card
+            if (fcs_pats_is_suitable(fcs_make_card(1, o), fcs_make_card(2, s)
 #ifndef FCS_FREECELL_ONLY
-                            ,
-                            game_variant_suit_mask,
-                            game_variant_desired_suit_value
+                                                              ,
+                    game_variant_suit_mask, game_variant_desired_suit_value
 #endif
-                            ))
-                    {
-                        *(move_ptr++) = (typeof(*move_ptr)){.card = card,
-                            .from = (unsigned char)i,
-                            .fromtype = FCS_PATS__TYPE_WASTE,
-                            .to = (unsigned char)w,
-                            .totype = FCS_PATS__TYPE_WASTE,
-                            .srccard =
-                                ((i_col_len > 1)
-                                        ? fcs_col_get_card(i_col, i_col_len - 2)
-                                        : fc_solve_empty_card),
-                            .destcard = w_card,
-                            .pri = (signed char)
-                                soft_thread->pats_solve_params.x[4]};
-                    }
-                }
+                    ))
+            {
+                cols_by_parent_suit[o] |= cols_by_suit[s];
             }
         }
     }
 
-#if MAX_NUM_FREECELLS > 0
-    /* Check for moves from soft_thread->current_pos.freecells to non-empty
+    /* Check for moves from soft_thread->current_pos.stacks to non-empty
      * soft_thread->current_pos.stacks cells. */
-    for (int t = 0; t < LOCAL_FREECELLS_NUM; t++)
+    for (fcs_pats__pile_mask cols = non_empty_cols; cols;)
     {
-        const fcs_card card = fcs_freecell_card(soft_thread->current_pos.s, t);
-        if (fcs_card_is_empty(card))
+        const int i = pop_lowest_pile(&cols);
+        const fcs_card card = top_cards[i];
+        const int i_col_len = col_lens[i];
+        for (fcs_pats__pile_mask parents =
+                 (cols_by_rank[fcs_card_rank(card) + 1] &
+                     cols_by_parent_suit[fcs_card_suit(card)]);
+             parents;)
         {
-            continue;
+            const int w = pop_lowest_pile(&parents);
+            const_AUTO(i_col, fcs_state_get_col(soft_thread->current_pos.s, i));
+            *(move_ptr++) = (typeof(*move_ptr)){.card = card,
+                .from = (unsigned char)i,
+                .fromtype = FCS_PATS__TYPE_WASTE,
+                .to = (unsigned char)w,
+                .totype = FCS_PATS__TYPE_WASTE,
+                .srccard = ((i_col_len > 1)
+                                ? fcs_col_get_card(i_col, i_col_len - 2)
+                                : fc_solve_empty_card),
+                .destcard = top_cards[w],
+                .pri = (signed char)soft_thread->pats_solve_params.x[4]};
         }
+    }
 
-        for (int w = 0; w < LOCAL_STACKS_NUM; w++)
+#if MAX_NUM_FREECELLS > 0
+    /* Check for moves from soft_thread->current_pos.freecells to non-empty
+     * soft_thread->current_pos.stacks cells. */
+    for (fcs_pats__pile_mask cells = occupied_freecells; cells;)
+    {
+        const int t = pop_lowest_pile(&cells);
+        const fcs_card card = fcs_freecell_card(soft_thread->current_pos.s, t);
+        for (fcs_pats__pile_mask parents =
+                 (cols_by_rank[fcs_card_rank(card) + 1] &
+                     cols_by_parent_suit[fcs_card_suit(card)]);
+             parents;)
         {
-            var_AUTO(w_col, fcs_state_get_col(soft_thread->current_pos.s, w));
-            if (fcs_col_len(w_col) > 0)
-            {
-                const fcs_card w_card =
-                    fcs_col_get_card(w_col, fcs_col_len(w_col) - 1);
-                if ((fcs_card_rank(card) == fcs_card_rank(w_card) - 1 &&
-                        fcs_pats_is_suitable(card, w_card
-#ifndef FCS_FREECELL_ONLY
-                            ,
-                            game_variant_suit_mask,
-                            game_variant_desired_suit_value
-#endif
-                            )))
-                {
-                    *(move_ptr++) = (typeof(*move_ptr)){.card = card,
-                        .from = (unsigned char)t,
-                        .fromtype = FCS_PATS__TYPE_FREECELL,
-                        .to = (unsigned char)w,
-                        .totype = FCS_PATS__TYPE_WASTE,
-                        .srccard = fc_solve_empty_card,
-                        .destcard = w_card,
-                        .pri =
-                            (signed char)soft_thread->pats_solve_params.x[5]};
-                }
-            }
+            const int w = pop_lowest_pile(&parents);
+            *(move_ptr++) = (typeof(*move_ptr)){.card = card,
+                .from = (unsigned char)t,
+                .fromtype = FCS_PATS__TYPE_FREECELL,
+                .to = (unsigned char)w,
+                .totype = FCS_PATS__TYPE_WASTE,
+                .srccard = fc_solve_empty_card,
+                .destcard = top_cards[w],
+                .pri = (signed char)soft_thread->pats_solve_params.x[5]};
         }
     }
-#endif
 
-#if MAX_NUM_FREECELLS > 0
     /* Check for moves from soft_thread->current_pos.freecells to one of any
      * empty soft_thread->current_pos.stacks cells. */
     if (has_empty_col)
     {
-        for (int t = 0; t < LOCAL_FREECELLS_NUM; t++)
+        fcs_pats__pile_mask empty_col_mask = empty_cols;
+        const int empty_col_idx = pop_lowest_pile(&empty_col_mask);
+        for (fcs_pats__pile_mask cells = occupied_freecells; cells;)
         {
+            const int t = pop_lowest_pile(&cells);
             const fcs_card card =
                 fcs_freecell_card(soft_thread->current_pos.s, t);
-            if (fcs_card_is_valid(card) &&
-                fcs_pats_is_king_only(not_King_only, card))
+            if (fcs_pats_is_king_only(not_King_only, card))
             {
                 *(move_ptr++) = (typeof(*move_ptr)){.card = card,
                     .from = (unsigned char)t,
@@ -317,84 +319,116 @@ static inline int get_possible_moves(
         }
     }
 
-    /* Check for moves from soft_thread->current_pos.stacks to one of any empty
-     * soft_thread->current_pos.freecells cells. */
-    for (int t = 0; t < LOCAL_FREECELLS_NUM; t++)
+    /* Check for moves from soft_thread->current_pos.stacks to the first
+     * empty soft_thread->current_pos.freecells cell. */
+    fcs_pats__pile_mask empty_freecells =
+        ~occupied_freecells &
+        ((((fcs_pats__pile_mask)1) << LOCAL_FREECELLS_NUM) - 1);
+    if (empty_freecells)
     {
-        if (!fcs_freecell_is_empty(soft_thread->current_pos.s, t))
-        {
-            continue;
-        }
-        for (int w = 0; w < LOCAL_STACKS_NUM; w++)
+        const int t = pop_lowest_pile(&empty_freecells);
+        for (fcs_pats__pile_mask cols = non_empty_cols; cols;)
         {
-            var_AUTO(w_col, fcs_state_get_col(soft_thread->current_pos.s, w));
-            const unsigned w_col_len = fcs_col_len(w_col);
-            if (w_col_len > 0)
-            {
-                *(move_ptr++) = (typeof(*move_ptr)){
-                    .card = fcs_col_get_card(w_col, w_col_len - 1),
-                    .from = (unsigned char)w,
-                    .fromtype = FCS_PATS__TYPE_WASTE,
-                    .to = (unsigned char)t,
-                    .totype = FCS_PATS__TYPE_FREECELL,
-                    .srccard = ((w_col_len > 1)
-                                    ? fcs_col_get_card(w_col, w_col_len - 2)
-                                    : fc_solve_empty_card),
-                    .destcard = fc_solve_empty_card,
-                    .pri = (signed char)soft_thread->pats_solve_params.x[7],
-                };
-            }
+            const int w = pop_lowest_pile(&cols);
+            const unsigned w_col_len = (unsigned)col_lens[w];
+            const_AUTO(w_col, fcs_state_get_col(soft_thread->current_pos.s, w));
+            *(move_ptr++) = (typeof(*move_ptr)){
+                .card = top_cards[w],
+                .from = (unsigned char)w,
+                .fromtype = FCS_PATS__TYPE_WASTE,
+                .to = (unsigned char)t,
+                .totype = FCS_PATS__TYPE_FREECELL,
+                .srccard = ((w_col_len > 1)
+                                ? fcs_col_get_card(w_col, w_col_len - 2)
+                                : fc_solve_empty_card),
+                .destcard = fc_solve_empty_card,
+                .pri = (signed char)soft_thread->pats_solve_params.x[7],
+            };
         }
-        break;
     }
 #endif
-    return (int)NUM_MOVES;
-}
 
-/* Moves that can't be undone get slightly higher priority, since it means
-we are moving a card for the first time. */
-
-static inline bool is_irreversible_move(
-#ifndef FCS_FREECELL_ONLY
-    const fcs_card game_variant_suit_mask,
-    const fcs_card game_variant_desired_suit_value,
-#endif
-    const bool King_only, const fcs_pats__move *const move_ptr)
-{
-    if (move_ptr->totype == FCS_PATS__TYPE_FOUNDATION)
-    {
-        return true;
-    }
-    else if (move_ptr->fromtype == FCS_PATS__TYPE_WASTE)
+    /* Check for sequence moves (-m) from soft_thread->current_pos.stacks
+    cells to the other soft_thread->current_pos.stacks cells.  Their top cards
+    alone were done above.  With -k, the piles that a sequence goes through
+    would have to be started by Kings, so only use the free cells. */
+    if (soft_thread->sequence_moves)
     {
-        const_SLOT(srccard, move_ptr);
-        if (fcs_card_is_valid(srccard))
+        int num_free = 0;
+#if MAX_NUM_FREECELLS > 0
+        num_free =
+            LOCAL_FREECELLS_NUM - __builtin_popcountll(occupied_freecells);
+#endif
+        const int num_spare =
+            (not_King_only ? __builtin_popcountll(empty_cols) : 0);
+        const int max_to_pile =
+            fc_solve_pats__seq_capacity(num_free, num_spare);
+        const int max_to_empty =
+            (has_empty_col ? fc_solve_pats__seq_capacity(
+                                 num_free, max(num_spare - 1, 0))
+                           : 0);
+        const int empty_col_idx =
+            (has_empty_col ? __builtin_ctzll(empty_cols) : -1);
+        for (fcs_pats__pile_mask cols = non_empty_cols; cols;)
         {
-            const_SLOT(card, move_ptr);
-            if ((fcs_card_rank(card) != fcs_card_rank(srccard) - 1) ||
-                !fcs_pats_is_suitable(card, srccard
+            const int i = pop_lowest_pile(&cols);
+            const int i_col_len = col_lens[i];
+            const_AUTO(i_col, fcs_state_get_col(soft_thread->current_pos.s, i));
+            fcs_card card = top_cards[i];
+            for (int num_cards = 2;
+                 num_cards <= i_col_len && num_cards <= max_to_pile;
+                 num_cards++)
+            {
+                const fcs_card below =
+                    fcs_col_get_card(i_col, i_col_len - num_cards);
+                if (fcs_card_rank(below) != fcs_card_rank(card) + 1 ||
+                    !fcs_pats_is_suitable(card, below
 #ifndef FCS_FREECELL_ONLY
-                    ,
-                    game_variant_suit_mask, game_variant_desired_suit_value
+                        ,
+                        game_variant_suit_mask, game_variant_desired_suit_value
 #endif
-                    ))
-            {
-                return true;
+                        ))
+                {
+                    break;
+                }
+                card = below;
+                const fcs_card srccard =
+                    ((num_cards < i_col_len)
+                            ? fcs_col_get_card(i_col, i_col_len - num_cards - 1)
+                            : fc_solve_empty_card);
+                for (fcs_pats__pile_mask parents =
+                         (cols_by_rank[fcs_card_rank(card) + 1] &
+                             cols_by_parent_suit[fcs_card_suit(card)]);
+                     parents;)
+                {
+                    const int w = pop_lowest_pile(&parents);
+                    *(move_ptr++) = (typeof(*move_ptr)){.card = card,
+                        .from = (unsigned char)i,
+                        .fromtype = FCS_PATS__TYPE_WASTE,
+                        .to = (unsigned char)w,
+                        .totype = FCS_PATS__TYPE_WASTE,
+                        .srccard = srccard,
+                        .destcard = top_cards[w],
+                        .pri = (signed char)soft_thread->pats_solve_params.x[4],
+                        .num_cards = (unsigned char)num_cards};
+                }
+                if (num_cards <= max_to_empty && num_cards < i_col_len &&
+                    fcs_pats_is_king_only(not_King_only, card))
+                {
+                    *(move_ptr++) = (typeof(*move_ptr)){.card = card,
+                        .from = (unsigned char)i,
+                        .fromtype = FCS_PATS__TYPE_WASTE,
+                        .to = (unsigned char)empty_col_idx,
+                        .totype = FCS_PATS__TYPE_WASTE,
+                        .srccard = srccard,
+                        .destcard = fc_solve_empty_card,
+                        .pri = (signed char)soft_thread->pats_solve_params.x[3],
+                        .num_cards = (unsigned char)num_cards};
+                }
             }
         }
-        /* TODO : This is probably a bug because move_ptr->card probably cannot
-         * be
-         * FCS_PATS__KING - only FCS_PATS__KING bitwise-ORed with some other
-         * value.
-         * */
-        else if (King_only &&
-                 move_ptr->card != fcs_make_card(FCS_PATS__KING, 0))
-        {
-            return true;
-        }
     }
-
-    return false;
+    return (int)NUM_MOVES;
 }
 
 static inline void mark_irreversible(
@@ -402,10 +436,11 @@ static inline void mark_irreversible(
 {
 #ifndef FCS_FREECELL_ONLY
     const fcs_instance *const instance = soft_thread->instance;
+    (void)instance;
 
-    const fcs_card game_variant_suit_mask = instance->game_variant_suit_mask;
+    const fcs_card game_variant_suit_mask = FCS_PATS__SUIT_MASK(instance);
     const fcs_card game_variant_desired_suit_value =
-        instance->game_variant_desired_suit_value;
+        FCS_PATS__DESIRED_SUIT_VALUE(instance);
 #endif
     const bool King_only =
 #ifndef FCS_FREECELL_ONLY
@@ -419,7 +454,7 @@ static inline void mark_irreversible(
     const fcs_pats__move *const moves_end = move_ptr + n;
     for (; move_ptr < moves_end; ++move_ptr)
     {
-        if (is_irreversible_move(
+        if (fc_solve_pats__is_irreversible_move(
 #ifndef FCS_FREECELL_ONLY
                 game_variant_suit_mask, game_variant_desired_suit_value,
 #endif
@@ -468,9 +503,7 @@ static inline int get_pilenum(fcs_pats_thread *const soft_thread, const int w)
     {
         if (soft_thread->next_pile_idx == FC_SOLVE__MAX_NUM_PILES)
         {
-#if 0
-            fc_solve_msg("Ran out of pile numbers!");
-#endif
+            fc_solve_pats__fail(soft_thread, FCS_PATS__FAIL_PILE_IDS);
             return -1;
         }
         list_iter = fc_solve_pats__new(soft_thread, fcs_pats__bucket_list);
@@ -508,6 +541,153 @@ static inline int get_pilenum(fcs_pats_thread *const soft_thread, const int w)
     return list_iter->pilenum;
 }
 
+/* A sequence move (-m) is reported as the single card moves that carry it
+out.  The piles that take part are modelled on their own: each one starts
+with the card under the sequence (or fc_solve_empty_card) and gets the
+cards of the sequence on top of it. */
+typedef struct
+{
+    fcs_card cards[FCS_PATS__KING + 1];
+    int len;
+    unsigned char type, idx;
+} fcs_pats__seq_pile;
+
+/* The source pile, the destination pile, the empty free cells and then the
+spare piles.  The positions don't say which free cells and piles were empty,
+so those are numbered in their order here. */
+#define SEQ_FROM 0
+#define SEQ_TO 1
+#define SEQ_FREECELLS 2
+
+typedef struct
+{
+    fcs_pats__seq_pile
+        piles[SEQ_FREECELLS + MAX_NUM_FREECELLS + MAX_NUM_STACKS];
+    int num_free;
+    fcs_pats__move *moves_ptr;
+} fcs_pats__seq_expansion;
+
+static inline void init_seq_pile(fcs_pats__seq_pile *const pile,
+    const fcs_card base, const int type, const int idx)
+{
+    pile->cards[0] = base;
+    pile->len = 1;
+    pile->type = (unsigned char)type;
+    pile->idx = (unsigned char)idx;
+}
+
+static inline void seq_move_card(
+    fcs_pats__seq_expansion *const e, const int from, const int to)
+{
+    fcs_pats__seq_pile *const src = &e->piles[from];
+    fcs_pats__seq_pile *const dest = &e->piles[to];
+    const fcs_card card = src->cards[--src->len];
+    *(e->moves_ptr++) = (fcs_pats__move){.card = card,
+        .from = src->idx,
+        .fromtype = src->type,
+        .to = dest->idx,
+        .totype = dest->type,
+        .srccard = src->cards[src->len - 1],
+        .destcard = dest->cards[dest->len - 1],
+        .pri = 0};
+    dest->cards[dest->len++] = card;
+}
+
+// See fc_solve_pats__seq_len() in pat.h.
+static void expand_seq_move(fcs_pats__seq_expansion *const e,
+    const int num_cards, const int from, const int to, const int first_spare,
+    const int num_spare)
+{
+    if (num_cards <= e->num_free + 1)
+    {
+        for (int i = 0; i < num_cards - 1; i++)
+        {
+            seq_move_card(e, from, SEQ_FREECELLS + i);
+        }
+        seq_move_card(e, from, to);
+        for (int i = num_cards - 2; i >= 0; i--)
+        {
+            seq_move_card(e, SEQ_FREECELLS + i, to);
+        }
+        return;
+    }
+    const int rest_capacity =
+        fc_solve_pats__seq_capacity(e->num_free, num_spare - 1);
+    if (num_cards <= rest_capacity)
+    {
+        expand_seq_move(
+            e, num_cards, from, to, first_spare + 1, num_spare - 1);
+        return;
+    }
+    const int num_top = num_cards - rest_capacity;
+    expand_seq_move(e, num_top, from, first_spare, first_spare + 1,
+        num_spare - 1);
+    expand_seq_move(
+        e, rest_capacity, from, to, first_spare + 1, num_spare - 1);
+    expand_seq_move(e, num_top, first_spare, to, first_spare + 1,
+        num_spare - 1);
+}
+
+/* Get the id of pile w of pos, from the 12 bit ids that are packed after
+its tree node (see unpack_position() in patsolve.c). */
+static inline int get_pile_id(const fcs_pats_position *const pos, const int w)
+{
+    const unsigned char *const p =
+        (const unsigned char *)(pos->node) + sizeof(fcs_pats__tree) +
+        (w * 12) / 8;
+    return ((w & 1) ? (((p[0] & 0xF) << 8) | p[1])
+                    : ((p[0] << 4) | ((p[1] >> 4) & 0xF)));
+}
+
+/* Write the single card moves of the sequence move of pos to moves_ptr, and
+return the end of them. */
+static inline fcs_pats__move *expand_seq_move_of(
+    fcs_pats_thread *const soft_thread, const fcs_pats_position *const pos,
+    fcs_pats__move *const moves_ptr)
+{
+    DECLARE_STACKS();
+    const_AUTO(m, &pos->move);
+    const int num_cards = m->num_cards;
+    fcs_pats__seq_expansion e;
+    e.num_free = LOCAL_FREECELLS_NUM - pos->parent->num_cards_in_freecells;
+    e.moves_ptr = moves_ptr;
+    const int num_spare = fc_solve_pats__seq_num_spare(num_cards, e.num_free);
+    init_seq_pile(
+        &e.piles[SEQ_FROM], m->srccard, FCS_PATS__TYPE_WASTE, m->from);
+    init_seq_pile(&e.piles[SEQ_TO], m->destcard, FCS_PATS__TYPE_WASTE, m->to);
+    for (int i = 0; i < e.num_free; i++)
+    {
+        init_seq_pile(&e.piles[SEQ_FREECELLS + i], fc_solve_empty_card,
+            FCS_PATS__TYPE_FREECELL, i);
+    }
+    for (int i = 0; i < num_spare; i++)
+    {
+        init_seq_pile(&e.piles[SEQ_FREECELLS + e.num_free + i],
+            fc_solve_empty_card, FCS_PATS__TYPE_WASTE, i);
+    }
+
+    /* The cards of the sequence are on top of the pile that it was moved to
+    in pos. */
+    for (int w = 0; w < LOCAL_STACKS_NUM; w++)
+    {
+        const char *const pile =
+            (const char *)soft_thread
+                ->bucket_from_pile_lookup[get_pile_id(pos, w)]
+                ->pile;
+        const char *const seq = strchr(pile, (char)m->card);
+        if (seq)
+        {
+            memcpy(e.piles[SEQ_FROM].cards + 1, seq, (size_t)num_cards);
+            e.piles[SEQ_FROM].len += num_cards;
+            break;
+        }
+    }
+
+    expand_seq_move(
+        &e, num_cards, SEQ_FROM, SEQ_TO, SEQ_FREECELLS + e.num_free, num_spare);
+    return e.moves_ptr;
+}
+
 static inline void win(
     fcs_pats_thread *const soft_thread, fcs_pats_position *const pos)
 {
@@ -520,7 +700,8 @@ static inline void win(
     size_t num_moves = 0;
     for (fcs_pats_position *p = pos; p->parent; p = p->parent)
     {
-        ++num_moves;
+        num_moves +=
+            (size_t)fc_solve_pats__move_len(soft_thread, &p->move, p->parent);
     }
     typeof(soft_thread->moves_to_win) moves_to_win =
         SMALLOC(moves_to_win, num_moves);
@@ -531,11 +712,22 @@ static inline void win(
     var_AUTO(moves_ptr, moves_to_win + num_moves);
     for (fcs_pats_position *p = pos; p->parent; p = p->parent)
     {
-        *(--moves_ptr) = (p->move);
+        if (p->move.num_cards > 1)
+        {
+            moves_ptr -=
+                fc_solve_pats__move_len(soft_thread, &p->move, p->parent);
+            expand_seq_move_of(soft_thread, p, moves_ptr);
+        }
+        else
+        {
+            *(--moves_ptr) = (p->move);
+        }
     }
 
     soft_thread->moves_to_win = moves_to_win;
     soft_thread->num_moves_to_win = num_moves;
+    // From now on, only look for shorter solutions.
+    soft_thread->solution_len_bound = (int)num_moves;
 }
 
 #ifndef FCS_FREECELL_ONLY
@@ -551,6 +743,7 @@ static inline int prune_seahaven(
 {
     const fcs_instance *const instance = soft_thread->instance;
     const_SLOT(game_params, instance);
+    (void)game_params;
 
     if (!(GET_INSTANCE_SEQUENCES_ARE_BUILT_BY(instance) ==
             FCS_SEQ_BUILT_BY_SUIT) ||
@@ -560,22 +753,26 @@ static inline int prune_seahaven(
         return false;
     }
 
-    // Count the number of cards below this card.
-    const fcs_card r = fcs_card_rank(move_ptr->card) + 1;
+    /* Count the number of cards below this card: the next ranks of its suit,
+    each one deeper in the pile than the one before it. */
+    const int r = fcs_card_rank(move_ptr->card) + 1;
     const fcs_card s = fcs_card_suit(move_ptr->card);
-    const_AUTO(
-        col, fcs_state_get_col(soft_thread->current_pos.s, move_ptr->to));
-    const int len = fcs_col_len(col);
+    const int to = move_ptr->to;
+    const fcs_pats__card_loc *const card_locs =
+        soft_thread->current_pos.card_locs;
 
     {
         int j = 0;
-        for (int i = len - 1; i >= 0; i--)
+        int depth =
+            fcs_col_len(fcs_state_get_col(soft_thread->current_pos.s, to));
+        for (; r + j <= FCS_PATS__KING; j++)
         {
-            const_AUTO(card, fcs_col_get_card(col, i));
-            if (fcs_card_suit(card) == s && fcs_card_rank(card) == r + j)
+            const_AUTO(loc, card_locs[fcs_make_card(r + j, s)]);
+            if (loc.col != to || loc.depth >= depth)
             {
-                j++;
+                break;
             }
+            depth = loc.depth;
         }
         if (j < LOCAL_FREECELLS_NUM + 1)
         {
@@ -586,10 +783,9 @@ static inline int prune_seahaven(
     // If there's a smaller card of this suit in the pile, we can prune
     // the move.
     const int r_minus = r - 1;
-    for (int i = 0; i < len; i++)
+    for (int rank = 1; rank < r_minus; rank++)
     {
-        const_AUTO(card, fcs_col_get_card(col, i));
-        if ((fcs_card_suit(card) == s) && (fcs_card_rank(card) < r_minus))
+        if (card_locs[fcs_make_card(rank, s)].col == to)
         {
             return true;
         }
@@ -599,223 +795,255 @@ static inline int prune_seahaven(
 }
 #endif
 
-/* This utility routine is used to check if a card is ever moved in
-a sequence of moves. */
-
-static inline int was_card_moved(
-    const fcs_card card, fcs_pats__move *const *const moves, const int j)
+static inline void push_history(
+    fcs_pats_thread *const soft_thread, const fcs_pats_position *const pos)
 {
-    for (int i = 0; i < j; i++)
+    DECLARE_STACKS();
+    if (soft_thread->history_len == soft_thread->max_history_entries)
     {
-        if (moves[i]->card == card)
-        {
-            return true;
-        }
+        soft_thread->max_history_entries += FCS_PATS__SOLVE_LEVEL_GROW_BY;
+        soft_thread->history = SREALLOC(
+            soft_thread->history, (size_t)soft_thread->max_history_entries);
     }
-    return false;
+    const_AUTO(idx, soft_thread->history_len++);
+    var_AUTO(entry, &soft_thread->history[idx]);
+    const_SLOT(move, pos);
+    entry->move = move;
+    entry->prev_last_moved = soft_thread->last_moved[move.card];
+    entry->prev_last_dest = soft_thread->last_dest[move.destcard];
+    entry->num_full_freecells =
+        (pos->num_cards_in_freecells == LOCAL_FREECELLS_NUM);
+    entry->num_sequence_moves = (move.num_cards > 1);
+    if (idx > 0)
+    {
+        entry->num_full_freecells += entry[-1].num_full_freecells;
+        entry->num_sequence_moves += entry[-1].num_sequence_moves;
+    }
+    soft_thread->last_moved[move.card] = idx;
+    soft_thread->last_dest[move.destcard] = idx;
+}
+
+static inline void pop_history(fcs_pats_thread *const soft_thread)
+{
+    const_AUTO(entry, &soft_thread->history[--soft_thread->history_len]);
+    soft_thread->last_dest[entry->move.destcard] = entry->prev_last_dest;
+    soft_thread->last_moved[entry->move.card] = entry->prev_last_moved;
 }
 
-/* This utility routine is used to check if a card is ever used as a
-destination in a sequence of moves. */
-static inline int is_card_dest(
-    const fcs_card card, fcs_pats__move *const *const moves, const int j)
+/* Bring the history up to the position at the current level of the solve
+stack.  Going up one level pushes a single move, and going down pops them,
+so this takes constant time per position, except for the first position
+of each solve(), where the last -H moves are found through the parents. */
+void fc_solve_pats__update_history(fcs_pats_thread *const soft_thread)
 {
-    for (int i = 0; i < j; i++)
+    if (soft_thread->max_history_len <= 1)
+    {
+        return;
+    }
+    const_AUTO(depth, soft_thread->curr_solve_depth);
+    if (depth > 0 && soft_thread->history_depth >= depth - 1)
     {
-        if (moves[i]->destcard == card)
+        while (soft_thread->history_len > soft_thread->history_base + depth - 1)
         {
-            return true;
+            pop_history(soft_thread);
         }
+        push_history(soft_thread, soft_thread->solve_stack[depth].parent);
+        soft_thread->history_depth = depth;
+        return;
     }
-    return false;
+
+    for (int i = 0; i < FCS_PATS__NUM_CARD_LOCS; i++)
+    {
+        soft_thread->last_moved[i] = soft_thread->last_dest[i] = -1;
+    }
+    soft_thread->history_len = 0;
+    const fcs_pats_position *pos = soft_thread->solve_stack[0].parent;
+    const fcs_pats_position *path[FCS_PATS__MAX_HISTORY_LEN];
+    int num_moves = 0;
+    for (; pos->parent && num_moves < soft_thread->max_history_len;
+         pos = pos->parent)
+    {
+        path[num_moves++] = pos;
+    }
+    while (num_moves > 0)
+    {
+        push_history(soft_thread, path[--num_moves]);
+    }
+    soft_thread->history_base = soft_thread->history_len;
+    for (int i = 1; i <= depth; i++)
+    {
+        push_history(soft_thread, soft_thread->solve_stack[i].parent);
+    }
+    soft_thread->history_depth = depth;
 }
 
-static inline int was_card_moved_or_dest(
-    const fcs_card card, fcs_pats__move *const *const moves, const int j)
+/* Two moves commute if they touch different piles, free cells and
+foundations: either order leads to the same position, so only the one
+that moves the lower card first is generated (-O).  m is the move that
+led to the position, and move_ptr is one of the moves from it.  Sequence
+moves (-m) are never taken to commute. */
+static inline bool is_reordering(
+    const fcs_pats__move *const m, const fcs_pats__move *const move_ptr)
 {
-    return (was_card_moved(card, moves, j) || is_card_dest(card, moves, j));
-}
+    const fcs_card card = move_ptr->card;
+    if (card >= m->card || m->num_cards > 1 || move_ptr->num_cards > 1)
+    {
+        return false;
+    }
+    // The card must not have been uncovered by m.
+    if (m->fromtype == FCS_PATS__TYPE_WASTE && card == m->srccard)
+    {
+        return false;
+    }
+    switch (move_ptr->totype)
+    {
+    case FCS_PATS__TYPE_FOUNDATION:
+        // Not the next card of the suit that m put out.
+        return (m->totype != FCS_PATS__TYPE_FOUNDATION ||
+                fcs_card_suit(card) != fcs_card_suit(m->card));
 
-// Prune redundant moves, if we can prove that they really are redundant.
-#define MAX_PREVIOUS_MOVES 4 /* Increasing this beyond 4 doesn't do much. */
+    case FCS_PATS__TYPE_FREECELL:
+        // Not the free cell that m emptied.
+        return (m->fromtype != FCS_PATS__TYPE_FREECELL);
 
-static inline int prune_redundant(fcs_pats_thread *const soft_thread GCC_UNUSED,
-    const fcs_pats__move *const move_ptr, fcs_pats_position *const pos0)
-{
-    DECLARE_STACKS();
-    int j;
-    fcs_pats__move *m, *prev[MAX_PREVIOUS_MOVES];
+    default:
+        if (fcs_card_is_empty(move_ptr->destcard))
+        {
+            // Not the pile that m emptied.
+            return (m->fromtype != FCS_PATS__TYPE_WASTE ||
+                    !fcs_card_is_empty(m->srccard));
+        }
+        // Neither onto m's card, nor onto the card that m uncovered.
+        return (move_ptr->destcard != m->card &&
+                (m->fromtype != FCS_PATS__TYPE_WASTE ||
+                    move_ptr->destcard != m->srccard));
+    }
+}
 
+/* Prune redundant moves, if we can prove that they really are redundant.
+The history says when each card was last moved or moved onto, so none of
+the checks need to go up the chain of parents. */
+static inline bool prune_redundant(fcs_pats_thread *const soft_thread,
+    const fcs_pats__move *const move_ptr, const fcs_pats_position *const pos)
+{
     // Don't move the same card twice in a row.
-    fcs_pats_position *pos = pos0;
     if (pos->depth == 0)
     {
         return false;
     }
-    m = &pos->move;
-    if (m->card == move_ptr->card)
+    if (pos->move.card == move_ptr->card)
     {
         return true;
     }
 
     /* The check above is the simplest case of the more general strategy
-    of searching the move stack (up the chain of parents) to prove that
-    the current move is redundant.  To do that, we need some more data. */
-
-    pos = pos->parent;
-    if (pos->depth == 0)
+    of searching the moves along the path to prove that the current move
+    is redundant. */
+    if (soft_thread->max_history_len <= 1)
     {
         return false;
     }
-    prev[0] = m;
-    j = -1;
-    for (int i = 1; i < MAX_PREVIOUS_MOVES; i++)
-    {
-        // Make a list of the last few moves.
-        prev[i] = &pos->move;
-
-        // Locate the last time we moved this card.
-        if (m->card == move_ptr->card)
-        {
-            j = i;
-            break;
-        }
-
-        /* Keep going up the move stack, looking for this
-        card, until we run out of moves (or patience). */
-        pos = pos->parent;
-        if (pos->depth == 0)
-        {
-            return false;
-        }
-    }
+    const fcs_pats__history_entry *const history = soft_thread->history;
+    const int last = soft_thread->history_len - 1;
 
-    /* If we haven't moved this card recently, assume this isn't
-    a redundant move. */
-    if (j < 0)
+    /* Locate the last time we moved this card.  If we haven't moved it
+    recently, assume this isn't a redundant move. */
+    const int j = soft_thread->last_moved[move_ptr->card];
+    if (j < 0 || last - j >= soft_thread->max_history_len)
     {
         return false;
     }
 
-    /* If the number of empty soft_thread->current_pos.freecells cells
-     * ever goes to zero, from prev[0] to
-    prev[j-1], there may be a dependency.  We also want to know if there
-    were any empty soft_thread->current_pos.freecells cells on move prev[j]. */
-    bool was_all_freecells_occupied = false;
-    pos = pos0;
-    for (int i = 0; i < j; i++)
+    /* The rules below reason about single cards, while a sequence move
+    (-m) takes the cards above its card along. */
+    if (move_ptr->num_cards > 1 ||
+        history[last].num_sequence_moves >
+            (j > 0 ? history[j - 1].num_sequence_moves : 0))
     {
-        was_all_freecells_occupied =
-            was_all_freecells_occupied ||
-            (pos->num_cards_in_freecells == LOCAL_FREECELLS_NUM);
-        pos = pos->parent;
+        return false;
     }
 
-    /* Now, prev[j] (m) is a move involving the same card as the current
+    /* If the number of empty free cells ever goes to zero after move j,
+    there may be a dependency.  We also want to know if there were any
+    empty free cells after move j itself. */
+    const bool was_all_freecells_occupied =
+        (history[last].num_full_freecells > history[j].num_full_freecells);
+    const bool were_freecells_full_at_j =
+        (history[j].num_full_freecells >
+            (j > 0 ? history[j - 1].num_full_freecells : 0));
+
+    /* Since the last move of the card (or onto it) happened after move j,
+    these tell if any intervening move touched it. */
+#define WAS_CARD_MOVED(card) (soft_thread->last_moved[card] > j)
+#define IS_CARD_DEST(card) (soft_thread->last_dest[card] > j)
+
+    /* Now, move j (m) is a move involving the same card as the current
     move.  See if the current move inverts that move.  There are several
     cases. */
+    const fcs_pats__move *const m = &history[j].move;
+    bool ret = false;
 
-    /* soft_thread->current_pos.freecells -> soft_thread->current_pos.stacks,
-     * ..., soft_thread->current_pos.stacks ->
-     * soft_thread->current_pos.freecells */
+    // freecells -> stacks, ..., stacks -> freecells
     if (m->fromtype == FCS_PATS__TYPE_FREECELL &&
         m->totype == FCS_PATS__TYPE_WASTE &&
         move_ptr->fromtype == FCS_PATS__TYPE_WASTE &&
         move_ptr->totype == FCS_PATS__TYPE_FREECELL)
     {
-        /* If the number of soft_thread->current_pos.freecells cells goes to
-        zero, we have a soft_thread->current_pos.freecells
-        dependency, and we can't prune. */
-        if (was_all_freecells_occupied)
-        {
-            return false;
-        }
-
-        /* If any intervening move used this card as a destination,
-        we have a dependency and we can't prune. */
-        if (is_card_dest(move_ptr->card, prev, j))
-        {
-            return false;
-        }
-        return true;
+        /* If the number of free cells goes to zero, we have a free cell
+        dependency, and we can't prune.  If any intervening move used this
+        card as a destination, we have a dependency and we can't prune. */
+        ret = !was_all_freecells_occupied && !IS_CARD_DEST(move_ptr->card);
     }
 
-    /* soft_thread->current_pos.stacks -> soft_thread->current_pos.freecells,
-     * ..., soft_thread->current_pos.freecells ->
-     * soft_thread->current_pos.stacks */
-    /* soft_thread->current_pos.stacks -> soft_thread->current_pos.stacks, ...,
-     * soft_thread->current_pos.stacks -> soft_thread->current_pos.stacks */
-
-    if ((m->fromtype == FCS_PATS__TYPE_WASTE &&
-            m->totype == FCS_PATS__TYPE_FREECELL &&
-            move_ptr->fromtype == FCS_PATS__TYPE_FREECELL &&
-            move_ptr->totype == FCS_PATS__TYPE_WASTE) ||
-        (m->fromtype == FCS_PATS__TYPE_WASTE &&
-            m->totype == FCS_PATS__TYPE_WASTE &&
-            move_ptr->fromtype == FCS_PATS__TYPE_WASTE &&
-            move_ptr->totype == FCS_PATS__TYPE_WASTE))
-    {
-        /* If we're not putting the card back where we found it,
-        it's not an inverse. */
-        if (m->srccard != move_ptr->destcard)
-        {
-            return false;
-        }
-
-        /* If any of the intervening moves either moves the card
+    /* stacks -> freecells, ..., freecells -> stacks
+     * stacks -> stacks, ..., stacks -> stacks */
+    else if ((m->fromtype == FCS_PATS__TYPE_WASTE &&
+                 m->totype == FCS_PATS__TYPE_FREECELL &&
+                 move_ptr->fromtype == FCS_PATS__TYPE_FREECELL &&
+                 move_ptr->totype == FCS_PATS__TYPE_WASTE) ||
+             (m->fromtype == FCS_PATS__TYPE_WASTE &&
+                 m->totype == FCS_PATS__TYPE_WASTE &&
+                 move_ptr->fromtype == FCS_PATS__TYPE_WASTE &&
+                 move_ptr->totype == FCS_PATS__TYPE_WASTE))
+    {
+        /* If we're not putting the card back where we found it, it's not
+        an inverse.  If any of the intervening moves either moves the card
         that was uncovered or uses it as a destination (including
         fc_solve_empty_card), there is a dependency. */
-        if (was_card_moved_or_dest(move_ptr->destcard, prev, j))
-        {
-            return false;
-        }
-
-        return true;
+        ret = m->srccard == move_ptr->destcard &&
+              !WAS_CARD_MOVED(move_ptr->destcard) &&
+              !IS_CARD_DEST(move_ptr->destcard);
     }
 
     /* These are not inverse prunes, we're taking a shortcut. */
 
-    /* soft_thread->current_pos.stacks -> soft_thread->current_pos.stacks, ...,
-     * soft_thread->current_pos.stacks -> soft_thread->current_pos.freecells */
-    if (m->fromtype == FCS_PATS__TYPE_WASTE &&
-        m->totype == FCS_PATS__TYPE_WASTE &&
-        move_ptr->fromtype == FCS_PATS__TYPE_WASTE &&
-        move_ptr->totype == FCS_PATS__TYPE_FREECELL)
+    // stacks -> stacks, ..., stacks -> freecells
+    else if (m->fromtype == FCS_PATS__TYPE_WASTE &&
+             m->totype == FCS_PATS__TYPE_WASTE &&
+             move_ptr->fromtype == FCS_PATS__TYPE_WASTE &&
+             move_ptr->totype == FCS_PATS__TYPE_FREECELL)
     {
-        /* If we could have moved the card to soft_thread->current_pos.freecells
-        on the
-        first move, prune.  There are other cases, but they
-        are more complicated. */
-        if (pos->num_cards_in_freecells != LOCAL_FREECELLS_NUM &&
-            !was_all_freecells_occupied)
-        {
-            return true;
-        }
-
-        return false;
+        /* If we could have moved the card to the free cells on the first
+        move, prune.  There are other cases, but they are more
+        complicated. */
+        ret = !were_freecells_full_at_j && !was_all_freecells_occupied;
     }
 
-    /* soft_thread->current_pos.freecells -> soft_thread->current_pos.stacks,
-     * ..., soft_thread->current_pos.stacks -> soft_thread->current_pos.stacks
-     */
-
-    if (m->fromtype == FCS_PATS__TYPE_FREECELL &&
-        m->totype == FCS_PATS__TYPE_WASTE &&
-        move_ptr->fromtype == FCS_PATS__TYPE_WASTE &&
-        move_ptr->totype == FCS_PATS__TYPE_WASTE)
+    // freecells -> stacks, ..., stacks -> stacks
+    else if (m->fromtype == FCS_PATS__TYPE_FREECELL &&
+             m->totype == FCS_PATS__TYPE_WASTE &&
+             move_ptr->fromtype == FCS_PATS__TYPE_WASTE &&
+             move_ptr->totype == FCS_PATS__TYPE_WASTE)
     {
-        /* We can prune these moves as long as the intervening
-        moves don't touch move_ptr->destcard. */
-
-        if (was_card_moved_or_dest(move_ptr->destcard, prev, j))
-        {
-            return false;
-        }
-
-        return true;
+        /* We can prune these moves as long as the intervening moves don't
+        touch move_ptr->destcard. */
+        ret = !WAS_CARD_MOVED(move_ptr->destcard) &&
+              !IS_CARD_DEST(move_ptr->destcard);
     }
+#undef WAS_CARD_MOVED
+#undef IS_CARD_DEST
 
-    return false;
+    return ret;
 }
 
 // Next card in rank.
@@ -833,14 +1061,18 @@ static inline void prioritize(fcs_pats_thread *const soft_thread,
     fcs_pats__move *const moves_start, const int n)
 {
     DECLARE_STACKS();
-    int pile[8];
+    const fcs_pats__card_loc *const card_locs =
+        soft_thread->current_pos.card_locs;
 
     /* There are 4 cards that we "need": the next cards to go out.  We
     give higher priority to the moves that remove cards from the piles
-    containing these cards. */
-    for (size_t i = 0; i < COUNT(pile); i++)
+    containing these cards.  Count, for every pile, how many of them it
+    holds - not only the cards we need next, but the cards after those
+    as well. */
+    int num_needed[MAX_NUM_STACKS];
+    for (int w = 0; w < LOCAL_STACKS_NUM; w++)
     {
-        pile[i] = -1;
+        num_needed[w] = 0;
     }
 
     fcs_card needed_cards[FCS_NUM_SUITS];
@@ -849,47 +1081,30 @@ static inline void prioritize(fcs_pats_thread *const soft_thread,
         needed_cards[suit] = fc_solve_empty_card;
         const fcs_card rank =
             fcs_foundation_value(soft_thread->current_pos.s, suit);
-        if (rank != FCS_PATS__KING)
+        if (rank == FCS_PATS__KING)
         {
-            needed_cards[suit] = fcs_make_card(rank + 1, suit);
+            continue;
         }
-    }
-
-    /* Locate the needed cards.  There's room for optimization here,
-    like maybe an array that keeps track of every card; if maintaining
-    such an array is not too expensive. */
-    int num_piles = 0;
-
-    for (int w = 0; w < LOCAL_STACKS_NUM; w++)
-    {
-        var_AUTO(col, fcs_state_get_col(soft_thread->current_pos.s, w));
-        const int len = fcs_col_len(col);
-        for (int i = 0; i < len; i++)
+        const fcs_card card = needed_cards[suit] =
+            fcs_make_card(rank + 1, suit);
+        if (card_locs[card].col != FCS_PATS__NOT_IN_COLUMN)
         {
-            const fcs_card card = fcs_col_get_card(col, i);
-            const int suit = fcs_card_suit(card);
-
-            /* Save the locations of the piles containing
-            not only the card we need next, but the card
-            after that as well. */
-            if (fcs_card_is_valid(needed_cards[suit]) &&
-                (card == needed_cards[suit] ||
-                    card == fcs_pats_next_card(needed_cards[suit])))
+            num_needed[card_locs[card].col]++;
+        }
+        if (rank + 1 != FCS_PATS__KING)
+        {
+            const_AUTO(next_loc, card_locs[fcs_pats_next_card(card)]);
+            if (next_loc.col != FCS_PATS__NOT_IN_COLUMN)
             {
-                pile[num_piles++] = w;
-                if (num_piles == COUNT(pile))
-                {
-                    goto end_of_stacks;
-                }
+                num_needed[next_loc.col]++;
             }
         }
     }
 
-end_of_stacks:;
-    /* Now if any of the moves remove a card from any of the piles
-    listed in pile[], bump their priority.  Likewise, if a move
-    covers a card we need, decrease its priority.  These priority
-    increments and decrements were determined empirically. */
+    /* Now if any of the moves remove a card from any of these piles,
+    bump their priority.  Likewise, if a move covers a card we need,
+    decrease its priority.  These priority increments and decrements were
+    determined empirically. */
     const_AUTO(moves_end, moves_start + n);
     for (fcs_pats__move *move_ptr = moves_start; move_ptr < moves_end;
         move_ptr++)
@@ -901,33 +1116,20 @@ end_of_stacks:;
         if (move_ptr->fromtype == FCS_PATS__TYPE_WASTE)
         {
             const int w = move_ptr->from;
-            for (int j = 0; j < num_piles; j++)
+            move_ptr->pri +=
+                num_needed[w] * soft_thread->pats_solve_params.x[0];
+            // The card that the move uncovers.
+            const fcs_card card = move_ptr->srccard;
+            if (fcs_card_is_valid(card) &&
+                card == needed_cards[(int)fcs_card_suit(card)])
             {
-                if (w == pile[j])
-                {
-                    move_ptr->pri += soft_thread->pats_solve_params.x[0];
-                }
-            }
-            var_AUTO(col, fcs_state_get_col(soft_thread->current_pos.s, w));
-            if (fcs_col_len(col) > 1)
-            {
-                const fcs_card card =
-                    fcs_col_get_card(col, fcs_col_len(col) - 2);
-                if (card == needed_cards[(int)fcs_card_suit(card)])
-                {
-                    move_ptr->pri += soft_thread->pats_solve_params.x[1];
-                }
+                move_ptr->pri += soft_thread->pats_solve_params.x[1];
             }
         }
         if (move_ptr->totype == FCS_PATS__TYPE_WASTE)
         {
-            for (int j = 0; j < num_piles; j++)
-            {
-                if (move_ptr->to == pile[j])
-                {
-                    move_ptr->pri -= soft_thread->pats_solve_params.x[2];
-                }
-            }
+            move_ptr->pri -=
+                num_needed[move_ptr->to] * soft_thread->pats_solve_params.x[2];
         }
     }
 }
@@ -945,6 +1147,356 @@ static inline bool is_win(fcs_pats_thread *const soft_thread)
     return true;
 }
 
+/* A lower bound on the number of moves needed to win from the current
+position.  Every card that isn't out has to be moved out, and a card that
+lies above a lower card of its own suit in a pile has to be moved off that
+pile before it can go out. */
+int fc_solve_pats__min_moves_to_win(fcs_pats_thread *const soft_thread)
+{
+    DECLARE_STACKS();
+    int num_moves = 4 * FCS_PATS__KING;
+    for (int o = 0; o < 4; o++)
+    {
+        num_moves -= fcs_foundation_value(soft_thread->current_pos.s, o);
+    }
+    for (int w = 0; w < LOCAL_STACKS_NUM; w++)
+    {
+        const_AUTO(col, fcs_state_get_col(soft_thread->current_pos.s, w));
+        const int col_len = (int)fcs_col_len(col);
+        int min_rank[4] = {FCS_PATS__KING + 1, FCS_PATS__KING + 1,
+            FCS_PATS__KING + 1, FCS_PATS__KING + 1};
+        for (int i = 0; i < col_len; i++)
+        {
+            const fcs_card card = fcs_col_get_card(col, i);
+            const int o = fcs_card_suit(card);
+            const int rank = fcs_card_rank(card);
+            if (min_rank[o] < rank)
+            {
+                ++num_moves;
+            }
+            else
+            {
+                min_rank[o] = rank;
+            }
+        }
+    }
+    return num_moves;
+}
+
+/* Dead position detection (-D).  These rules only cut positions that can't
+be won whatever moves follow, so they never lose a solution.  A card waiting
+for its turn to go out has to sit in a free cell, or at the bottom of an
+empty pile, when nothing in the piles will take it, so the rules count the
+cards that must wait at the same time. */
+
+/* Which cards can never again be put onto a card in the piles?  Kings have
+nothing to go on, and the other cards of suit o get there once all the cards
+they could go on are out, which is below the rank homeless_below[o] (0 when
+building by suit, as a card can't be out before the lower ones). */
+static inline void get_homeless_ranks(
+    fcs_pats_thread *const soft_thread, int *const homeless_below)
+{
+#ifndef FCS_FREECELL_ONLY
+    const fcs_instance *const instance = soft_thread->instance;
+    (void)instance;
+#endif
+    for (int o = 0; o < FCS_NUM_SUITS; o++)
+    {
+        homeless_below[o] = FCS_PATS__KING;
+        for (int p = 0; p < FCS_NUM_SUITS; p++)
+        {
+            const int rank =
+                fcs_foundation_value(soft_thread->current_pos.s, p);
+            if (fcs_pats_is_suitable(fcs_make_card(1, o), fcs_make_card(2, p)
+#ifndef FCS_FREECELL_ONLY
+                                                              ,
+                    FCS_PATS__SUIT_MASK(instance),
+                    FCS_PATS__DESIRED_SUIT_VALUE(instance)
+#endif
+                    ) &&
+                rank < homeless_below[o])
+            {
+                homeless_below[o] = rank;
+            }
+        }
+    }
+}
+
+static inline bool is_homeless(
+    const int *const homeless_below, const int o, const int rank)
+{
+    return (rank == FCS_PATS__KING || rank < homeless_below[o]);
+}
+
+/* Cyclic blockers.  With -k and no free cells, a card other than a King can
+only leave its pile to go out, if the cards it could go on are out or lie
+below it.  Such a card must go out before the cards below it, and so before
+the higher cards of their suits.  If these orders make a cycle, as when two
+such cards each lie above a lower card of the other's suit, none of the
+cards in it can go out first. */
+static inline bool has_cyclic_blockers(fcs_pats_thread *const soft_thread)
+{
+#ifndef FCS_FREECELL_ONLY
+    DECLARE_STACKS();
+    const fcs_instance *const instance = soft_thread->instance;
+    (void)instance;
+    if (LOCAL_FREECELLS_NUM > 0 ||
+        INSTANCE_EMPTY_STACKS_FILL != FCS_ES_FILLED_BY_KINGS_ONLY)
+    {
+        return false;
+    }
+    const fcs_pats__card_loc *const card_locs =
+        soft_thread->current_pos.card_locs;
+
+    // The stuck cards, and the lowest rank of every suit below each one.
+    fcs_card stuck_cards[FCS_PATS__NUM_CARD_LOCS];
+    int stuck_min_ranks[FCS_PATS__NUM_CARD_LOCS][FCS_NUM_SUITS];
+    int num_stuck = 0;
+    for (int w = 0; w < LOCAL_STACKS_NUM; w++)
+    {
+        const_AUTO(col, fcs_state_get_col(soft_thread->current_pos.s, w));
+        const int col_len = (int)fcs_col_len(col);
+        int min_rank[FCS_NUM_SUITS] = {FCS_PATS__KING + 1,
+            FCS_PATS__KING + 1, FCS_PATS__KING + 1, FCS_PATS__KING + 1};
+        for (int i = 0; i < col_len; i++)
+        {
+            const fcs_card card = fcs_col_get_card(col, i);
+            const int o = fcs_card_suit(card);
+            const int rank = fcs_card_rank(card);
+            bool is_stuck = (rank != FCS_PATS__KING);
+            for (int p = 0; is_stuck && p < FCS_NUM_SUITS; p++)
+            {
+                const fcs_card parent = fcs_make_card(rank + 1, p);
+                is_stuck = (!fcs_pats_is_suitable(card, parent,
+                                FCS_PATS__SUIT_MASK(instance),
+                                FCS_PATS__DESIRED_SUIT_VALUE(instance)) ||
+                            fcs_foundation_value(soft_thread->current_pos.s,
+                                p) > rank ||
+                            (card_locs[parent].col == w &&
+                                card_locs[parent].depth < i));
+            }
+            if (is_stuck)
+            {
+                stuck_cards[num_stuck] = card;
+                memcpy(stuck_min_ranks[num_stuck], min_rank, sizeof(min_rank));
+                num_stuck++;
+            }
+            if (rank < min_rank[o])
+            {
+                min_rank[o] = rank;
+            }
+        }
+    }
+
+    /* An edge from a to b means that a must go out before b.  Follow the
+    edges until one comes back. */
+    uint64_t before[FCS_PATS__NUM_CARD_LOCS];
+    for (int a = 0; a < num_stuck; a++)
+    {
+        before[a] = 0;
+        for (int b = 0; b < num_stuck; b++)
+        {
+            if (stuck_min_ranks[a][fcs_card_suit(stuck_cards[b])] <
+                fcs_card_rank(stuck_cards[b]))
+            {
+                before[a] |= ((uint64_t)1) << b;
+            }
+        }
+    }
+    for (bool is_changed = true; is_changed;)
+    {
+        is_changed = false;
+        for (int a = 0; a < num_stuck; a++)
+        {
+            uint64_t reached = before[a];
+            for (uint64_t rest = before[a]; rest; rest &= rest - 1)
+            {
+                reached |= before[__builtin_ctzll(rest)];
+            }
+            if (reached != before[a])
+            {
+                before[a] = reached;
+                is_changed = true;
+            }
+        }
+    }
+    for (int a = 0; a < num_stuck; a++)
+    {
+        if (before[a] & (((uint64_t)1) << a))
+        {
+            return true;
+        }
+    }
+#endif
+    return false;
+}
+
+/* Buried lower cards.  A card that lies above a lower card of its own suit
+must leave its pile before that card can go out, and if it is homeless it
+then waits until it goes out itself.  So when the card of rank k of a suit
+goes out, every homeless card of that suit above rank k which lay above a
+card of rank k or less is waiting.  They can't all wait if there are more
+of them than free cells and piles (with -k, only Kings may wait in piles).
+
+Building by suit, no card is homeless before the Kings, but with -k the
+same goes for the cards above one of their own suit: when that card is
+first uncovered, the next lower cards of its suit that lay above it can
+only be in the free cells, one on top of another being impossible there. */
+typedef struct
+{
+    int all[FCS_NUM_SUITS][FCS_PATS__KING + 1];
+    int non_kings[FCS_NUM_SUITS][FCS_PATS__KING + 1];
+} fcs_pats__waiting_cards;
+
+// A card of rank rank waits while the cards from from_rank up go out.
+static inline void add_waiting_card(fcs_pats__waiting_cards *const waiting,
+    const int o, const int from_rank, const int rank)
+{
+    waiting->all[o][from_rank]++;
+    waiting->all[o][rank]--;
+    if (rank != FCS_PATS__KING)
+    {
+        waiting->non_kings[o][from_rank]++;
+        waiting->non_kings[o][rank]--;
+    }
+}
+
+static inline bool has_buried_lower_cards(fcs_pats_thread *const soft_thread)
+{
+    DECLARE_STACKS();
+#ifndef FCS_FREECELL_ONLY
+    const fcs_instance *const instance = soft_thread->instance;
+    (void)instance;
+    const bool kings_only =
+        (INSTANCE_EMPTY_STACKS_FILL == FCS_ES_FILLED_BY_KINGS_ONLY);
+    const bool chains_wait =
+        (kings_only && GET_INSTANCE_SEQUENCES_ARE_BUILT_BY(instance) ==
+                           FCS_SEQ_BUILT_BY_SUIT);
+#else
+    const bool kings_only = false;
+    const bool chains_wait = false;
+#endif
+    int homeless_below[FCS_NUM_SUITS];
+    get_homeless_ranks(soft_thread, homeless_below);
+    /* Until some cards other than Kings are homeless, at most one card of
+    every suit can wait, and there is room for that. */
+    if (!chains_wait)
+    {
+        bool has_homeless = false;
+        for (int o = 0; o < FCS_NUM_SUITS; o++)
+        {
+            has_homeless = (has_homeless || homeless_below[o] > 1);
+        }
+        if (!has_homeless)
+        {
+            return false;
+        }
+    }
+    const fcs_pats__card_loc *const card_locs =
+        soft_thread->current_pos.card_locs;
+
+    /* The number of waiting cards of every suit when its card of each rank
+    goes out, as differences from the count of the rank below. */
+    fcs_pats__waiting_cards waiting = {{{0}}, {{0}}};
+    for (int w = 0; w < LOCAL_STACKS_NUM; w++)
+    {
+        const_AUTO(col, fcs_state_get_col(soft_thread->current_pos.s, w));
+        const int col_len = (int)fcs_col_len(col);
+        int min_rank[FCS_NUM_SUITS] = {FCS_PATS__KING + 1,
+            FCS_PATS__KING + 1, FCS_PATS__KING + 1, FCS_PATS__KING + 1};
+        for (int i = 0; i < col_len; i++)
+        {
+            const fcs_card card = fcs_col_get_card(col, i);
+            const int o = fcs_card_suit(card);
+            const int rank = fcs_card_rank(card);
+            if (min_rank[o] < rank)
+            {
+                if (is_homeless(homeless_below, o, rank))
+                {
+                    add_waiting_card(&waiting, o, min_rank[o], rank);
+                }
+                if (chains_wait)
+                {
+                    int num_chain = 0;
+                    for (int r = rank - 1; r > min_rank[o]; r--, num_chain++)
+                    {
+                        const_AUTO(loc, card_locs[fcs_make_card(r, o)]);
+                        if (loc.col != w || loc.depth < i)
+                        {
+                            break;
+                        }
+                    }
+                    if (num_chain > LOCAL_FREECELLS_NUM)
+                    {
+                        return true;
+                    }
+                }
+            }
+            else
+            {
+                min_rank[o] = rank;
+            }
+        }
+    }
+    // The homeless cards that already wait in the free cells.
+    for (int t = 0; t < LOCAL_FREECELLS_NUM; t++)
+    {
+        const fcs_card card = fcs_freecell_card(soft_thread->current_pos.s, t);
+        if (fcs_card_is_empty(card))
+        {
+            continue;
+        }
+        const int o = fcs_card_suit(card);
+        const int rank = fcs_card_rank(card);
+        if (!is_homeless(homeless_below, o, rank))
+        {
+            continue;
+        }
+        const int from_rank =
+            fcs_foundation_value(soft_thread->current_pos.s, o) + 1;
+        if (from_rank < rank)
+        {
+            add_waiting_card(&waiting, o, from_rank, rank);
+        }
+    }
+
+    for (int o = 0; o < FCS_NUM_SUITS; o++)
+    {
+        int total = 0, non_kings = 0;
+        for (int rank = 1; rank < FCS_PATS__KING; rank++)
+        {
+            total += waiting.all[o][rank];
+            non_kings += waiting.non_kings[o][rank];
+            if (total > LOCAL_FREECELLS_NUM + LOCAL_STACKS_NUM ||
+                (kings_only && non_kings > LOCAL_FREECELLS_NUM))
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/* Check the current position with the rules of soft_thread->dead_rules,
+and count the move to it if one of them finds it dead. */
+bool fc_solve_pats__is_dead_position(fcs_pats_thread *const soft_thread)
+{
+    const int dead_rules = soft_thread->dead_rules;
+    if ((dead_rules & FCS_PATS__DEAD_CYCLES) &&
+        has_cyclic_blockers(soft_thread))
+    {
+        soft_thread->num_dead_moves[1]++;
+        return true;
+    }
+    if ((dead_rules & FCS_PATS__DEAD_BURIED) &&
+        has_buried_lower_cards(soft_thread))
+    {
+        soft_thread->num_dead_moves[2]++;
+        return true;
+    }
+    return false;
+}
+
 // Generate an array of the moves we can make from this position.
 fcs_pats__move *fc_solve_pats__get_moves(fcs_pats_thread *const soft_thread,
     fcs_pats_position *const pos, int *const num_moves)
@@ -959,6 +1511,15 @@ fcs_pats__move *fc_solve_pats__get_moves(fcs_pats_thread *const soft_thread,
 
     if (!a)
     {
+        /* An automove was the only move from its position, so there is no
+        other order of it and a move from here to skip. */
+        const fcs_pats__move *const last_move = &pos->move;
+        const bool skip_reorderings =
+            (soft_thread->por_mode != FCS_PATS__POR_OFF && pos->depth > 0 &&
+                !(last_move->totype == FCS_PATS__TYPE_FOUNDATION &&
+                    good_automove(soft_thread, fcs_card_suit(last_move->card),
+                        fcs_card_rank(last_move->card))));
+
         // Throw out some obviously bad (non-auto)moves.
         var_PTR(move_ptr, soft_thread->possible_moves);
         const_AUTO(moves_end, move_ptr + total_num_moves);
@@ -966,8 +1527,10 @@ fcs_pats__move *fc_solve_pats__get_moves(fcs_pats_thread *const soft_thread,
         {
 #ifndef FCS_FREECELL_ONLY
             // Special prune for Seahaven -k.
-            if (prune_seahaven(soft_thread, move_ptr))
+            if ((soft_thread->dead_rules & FCS_PATS__DEAD_SEAHAVEN_RUNS) &&
+                prune_seahaven(soft_thread, move_ptr))
             {
+                soft_thread->num_dead_moves[0]++;
                 move_ptr->card = fc_solve_empty_card;
                 n--;
                 continue;
@@ -979,10 +1542,22 @@ fcs_pats__move *fc_solve_pats__get_moves(fcs_pats_thread *const soft_thread,
             {
                 move_ptr->card = fc_solve_empty_card;
                 n--;
+                continue;
+            }
+
+            // And the other order of two independent moves (-O).
+            if (skip_reorderings && is_reordering(last_move, move_ptr))
+            {
+                soft_thread->num_reordered_moves++;
+                move_ptr->card = fc_solve_empty_card;
+                n--;
             }
         }
 
-        mark_irreversible(soft_thread, n);
+        if (!soft_thread->move_weights)
+        {
+            mark_irreversible(soft_thread, n);
+        }
     }
 
     // No moves?  Maybe we won.
@@ -1011,7 +1586,16 @@ fcs_pats__move *fc_solve_pats__get_moves(fcs_pats_thread *const soft_thread,
     don't need a priority. */
     if (!a)
     {
-        prioritize(soft_thread, soft_thread->possible_moves, total_num_moves);
+        if (soft_thread->move_weights)
+        {
+            fc_solve_pats__score_moves(
+                soft_thread, soft_thread->possible_moves, total_num_moves);
+        }
+        else
+        {
+            prioritize(
+                soft_thread, soft_thread->possible_moves, total_num_moves);
+        }
     }
 
     /* Now copy to safe storage and return.  Non-auto moves out get put
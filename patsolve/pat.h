@@ -13,16 +13,76 @@
 #include "tree.h"
 #include "param.h"
 #include <limits.h>
+#include <signal.h>
 #include <stdbool.h>
 #include "freecell-solver/fcs_dllexport.h"
 #include "state.h"
 #include "fnv.h"
+#include "pats_clock.h"
 #include "rinutils/alloc_wrap.h"
 #include "instance.h"
 
 #define FCS_PATS__COLOR 0x01 /* black if set */
 #define FCS_PATS__SUIT 0x03  /* mask both suit bits */
 
+/* A solver kernel is pat.c, patsolve.c and tree.c compiled once more with
+the variant of the game as constants (see kernel.c.in), so the compiler can
+unroll the loops over the piles and free cells and drop the branches of the
+other variants.  Its external functions get the kernel's name as a suffix,
+and fc_solve_pats__do_it() hands the search over to the kernel that matches
+the variant, if there is one (see kernels.c). */
+#ifdef FCS_PATS__KERNEL
+#undef LOCAL_STACKS_NUM
+#define LOCAL_STACKS_NUM FCS_PATS__KERNEL_STACKS_NUM
+#undef LOCAL_FREECELLS_NUM
+#define LOCAL_FREECELLS_NUM FCS_PATS__KERNEL_FREECELLS_NUM
+#undef GET_INSTANCE_SEQUENCES_ARE_BUILT_BY
+#define GET_INSTANCE_SEQUENCES_ARE_BUILT_BY(instance)                          \
+    FCS_PATS__KERNEL_SEQUENCES_ARE_BUILT_BY
+#undef INSTANCE_EMPTY_STACKS_FILL
+#define INSTANCE_EMPTY_STACKS_FILL FCS_PATS__KERNEL_EMPTY_STACKS_FILL
+#define FCS_PATS__SUIT_MASK(instance)                                          \
+    ((FCS_PATS__KERNEL_SEQUENCES_ARE_BUILT_BY == FCS_SEQ_BUILT_BY_SUIT)       \
+            ? FCS_PATS__SUIT                                                   \
+            : FCS_PATS__COLOR)
+#define FCS_PATS__DESIRED_SUIT_VALUE(instance)                                 \
+    ((FCS_PATS__KERNEL_SEQUENCES_ARE_BUILT_BY == FCS_SEQ_BUILT_BY_SUIT)       \
+            ? 0                                                                \
+            : FCS_PATS__COLOR)
+
+#define FCS_PATS__KERNEL_SYMBOL(name)                                          \
+    FCS_PATS__KERNEL_SYMBOL2(name, FCS_PATS__KERNEL)
+#define FCS_PATS__KERNEL_SYMBOL2(name, kernel)                                 \
+    FCS_PATS__KERNEL_SYMBOL3(name, kernel)
+#define FCS_PATS__KERNEL_SYMBOL3(name, kernel) name##__##kernel
+#define fc_solve_pats__do_it FCS_PATS__KERNEL_SYMBOL(fc_solve_pats__do_it)
+#define fc_solve_pats__do_it_bounded                                           \
+    FCS_PATS__KERNEL_SYMBOL(fc_solve_pats__do_it_bounded)
+#define fc_solve_pats__get_moves                                               \
+    FCS_PATS__KERNEL_SYMBOL(fc_solve_pats__get_moves)
+#define fc_solve_pats__insert FCS_PATS__KERNEL_SYMBOL(fc_solve_pats__insert)
+#define fc_solve_pats__is_dead_position                                        \
+    FCS_PATS__KERNEL_SYMBOL(fc_solve_pats__is_dead_position)
+#define fc_solve_pats__min_moves_to_win                                        \
+    FCS_PATS__KERNEL_SYMBOL(fc_solve_pats__min_moves_to_win)
+#define fc_solve_pats__new_block                                               \
+    FCS_PATS__KERNEL_SYMBOL(fc_solve_pats__new_block)
+#define fc_solve_pats__new_from_block                                          \
+    FCS_PATS__KERNEL_SYMBOL(fc_solve_pats__new_from_block)
+#define fc_solve_pats__new_position                                            \
+    FCS_PATS__KERNEL_SYMBOL(fc_solve_pats__new_position)
+#define fc_solve_pats__queue_position                                          \
+    FCS_PATS__KERNEL_SYMBOL(fc_solve_pats__queue_position)
+#define fc_solve_pats__sort_piles                                              \
+    FCS_PATS__KERNEL_SYMBOL(fc_solve_pats__sort_piles)
+#define fc_solve_pats__update_history                                          \
+    FCS_PATS__KERNEL_SYMBOL(fc_solve_pats__update_history)
+#else
+#define FCS_PATS__SUIT_MASK(instance) ((instance)->game_variant_suit_mask)
+#define FCS_PATS__DESIRED_SUIT_VALUE(instance)                                 \
+    ((instance)->game_variant_desired_suit_value)
+#endif
+
 #define FCS_PATS__KING 13
 
 /* The following implements
@@ -57,6 +117,9 @@ typedef struct
     fcs_card srccard;  /* card we're uncovering */
     fcs_card destcard; /* card we're moving to */
     signed char pri;   /* move priority (low priority == low value) */
+    /* For a sequence move (-m), the number of cards moved from the top of
+    one pile to another, with card being the lowest one.  0 otherwise. */
+    unsigned char num_cards;
 } fcs_pats__move;
 
 // Pile types
@@ -82,9 +145,21 @@ typedef struct fc_solve_pats__pos__struct
     unsigned char num_childs;             /* number of child nodes left */
 } fcs_pats_position;
 
+/* A move on the path to the position whose moves are being generated, as
+kept for prune_redundant() (-H). */
+typedef struct
+{
+    fcs_pats__move move;
+    /* What last_moved[] and last_dest[] were before this move. */
+    int prev_last_moved, prev_last_dest;
+    /* The number of positions with all the free cells occupied, and of
+    sequence moves, along the path up to and including this move. */
+    int num_full_freecells, num_sequence_moves;
+} fcs_pats__history_entry;
+
 // Temp storage for possible moves.
-// > max # moves from any position
-#define FCS_PATS__MAX_NUM_MOVES 64
+// > max # moves from any position, including the sequence moves of -m
+#define FCS_PATS__MAX_NUM_MOVES (64 + MAX_NUM_STACKS * (FCS_PATS__KING + 1))
 
 typedef enum
 {
@@ -98,15 +173,21 @@ typedef enum
 {
     FCS_PATS__FAIL = -1,
     FCS_PATS__WIN = 0,
-    FCS_PATS__NOSOL = 1
+    FCS_PATS__NOSOL = 1,
+    // fc_solve_pats__do_it_bounded() used up its budget.
+    FCS_PATS__SUSPENDED = 2
 } fc_solve_pats__status_code;
 
-#ifdef FCS_PATSOLVE__WITH_FAIL_REASON
+// Why the status is FCS_PATS__FAIL.
 typedef enum
 {
     FCS_PATS__FAIL_CHECKED_STATES = 0,
+    FCS_PATS__FAIL_OUT_OF_MEMORY,
+    FCS_PATS__FAIL_WALL_TIME,
+    FCS_PATS__FAIL_CPU_TIME,
+    FCS_PATS__FAIL_PILE_IDS,
+    FCS_PATS__FAIL_INTERRUPTED,
 } fc_solve_pats__status_fail_reason;
-#endif
 
 // Memory.
 typedef struct fcs_pats__block_struct
@@ -140,6 +221,27 @@ typedef struct fcs_pats__bucket_list_struct
 // Statistics.
 #define FC_SOLVE_PATS__NUM_QUEUES 100
 
+/* Beam search.  Instead of the priority queues, the positions are kept
+in one layer per depth, and each layer holds at most beam_width positions
+(the ones with the highest queue priority).  The layers are stored as
+min-heaps so the worst position is the one that gets discarded. */
+typedef struct
+{
+    fcs_pats_position *pos;
+    unsigned long seq; /* insertion order, to break ties */
+    int pri;
+} fcs_pats__beam_item;
+
+#define FCS_PATS__BEAM_LAYER_GROW_BY 64
+
+typedef struct
+{
+    fcs_pats__beam_item *items;
+    int capacity, count;
+    int next;       /* the next item to dequeue, once the layer is sorted */
+    bool is_sorted; /* the layer is being dequeued from */
+} fcs_pats__beam_layer;
+
 #ifdef PATSOLVE_STANDALONE
 struct fc_solve_instance_struct
 {
@@ -154,6 +256,18 @@ struct fc_solve_instance_struct
 typedef struct fc_solve_instance_struct fcs_instance;
 #endif
 
+/* Where a card is in the current position: its column and its depth there
+(0 is the bottom card).  Cards in the freecells or on the foundations have a
+col of FCS_PATS__NOT_IN_COLUMN. */
+#define FCS_PATS__NOT_IN_COLUMN (-1)
+typedef struct
+{
+    signed char col, depth;
+} fcs_pats__card_loc;
+
+// Indexed by the card value itself, so there is room for every rank and suit.
+#define FCS_PATS__NUM_CARD_LOCS ((FCS_PATS__KING + 1) << 2)
+
 enum FC_SOLVE_PATS__MYDIR
 {
     FC_SOLVE_PATS__UP,
@@ -171,6 +285,12 @@ struct fc_solve__patsolve_thread_struct
     fcs_pats_position
         *queue_tail[FC_SOLVE_PATS__NUM_QUEUES]; /* positions are added here */
     int max_queue_idx;
+    /* -B means beam search with this many positions per depth (0 is
+     * off). -W is the width that it may be widened to on retries. */
+    int beam_width, max_beam_width;
+    fcs_pats__beam_layer *beam_layers;
+    int num_beam_layers, beam_depth;
+    unsigned long beam_seq, num_beam_discarded;
 #ifdef DEBUG
     int num_positions_in_clusters[0x10000];
     int num_positions_in_queue[FC_SOLVE_PATS__NUM_QUEUES];
@@ -187,6 +307,9 @@ struct fc_solve__patsolve_thread_struct
         /* Every different pile has a hash and a unique id. */
         uint32_t stack_hashes[MAX_NUM_STACKS];
         int stack_ids[MAX_NUM_STACKS];
+        /* Kept up to date by every move, so the prioritization and pruning
+        rules can find a card without scanning the columns. */
+        fcs_pats__card_loc card_locs[FCS_PATS__NUM_CARD_LOCS];
     } current_pos;
 
     /* Temp storage for possible moves. */
@@ -194,8 +317,38 @@ struct fc_solve__patsolve_thread_struct
 
     /* Statistics. */
     unsigned long num_checked_states, max_num_checked_states;
+    /* Per-deal time limits in microseconds (0 means no limit), and the
+     * clock readings they are measured from. The clocks are only read
+     * every FCS_PATS__CLOCK_CHECK_INTERVAL calls to check_for_exceeded(). */
+    long long max_wall_usecs, max_cpu_usecs;
+    long long wall_start_usecs, cpu_start_usecs;
+    int clock_check_countdown;
+    bool is_limit_exceeded;
+    /* If this points to a non-zero flag (e.g. one set by a signal
+     * handler), fc_solve_pats__do_it() stops with
+     * FCS_PATS__FAIL_INTERRUPTED, and may be called again once the flag
+     * is cleared and the status is reset to FCS_PATS__NOSOL. */
+    volatile sig_atomic_t *interrupt_requested;
+    /* The budget of the current fc_solve_pats__do_it_bounded() call: stop
+     * once num_checked_states reaches step_end_checked_states, or once the
+     * wall clock reaches step_end_usecs (0 means no deadline) after at
+     * least one more position was checked. */
+    unsigned long step_start_checked_states, step_end_checked_states;
+    long long step_end_usecs;
+    bool is_step_done;
+    /* -K saves checkpoints to this file, every checkpoint_interval_usecs
+     * (-J, in seconds) and when stopped, and -R resumes from one. */
+    const char *checkpoint_filename, *resume_filename;
+#define FCS_PATS__DEFAULT_CHECKPOINT_INTERVAL_USECS 600000000LL
+    long long checkpoint_interval_usecs;
+    /* fc_solve_pats__play() prints its reports here (stdout by default). */
+    FILE *out;
     unsigned long num_states_in_collection;
     fcs_pats_xy_params pats_solve_params;
+    /* The weights of the features of a move (--move-weights, see
+     * move_model.h) that set its priority instead of pats_solve_params,
+     * or NULL. */
+    const double *move_weights;
     size_t position_size;
 
     fcs_pats__bucket_list *buckets_list[FC_SOLVE_BUCKETLIST_NBUCKETS];
@@ -207,6 +360,53 @@ struct fc_solve__patsolve_thread_struct
     size_t bytes_per_tree_node;
     bool dont_exit_on_sol; /* -E means don't exit */
     int num_solutions;     /* number of solutions found in -E mode */
+    /* Only look for solutions shorter than this many moves.  It starts as
+     * initial_solution_len_bound (-L, INT_MAX by default) and drops to the
+     * length of each solution found. */
+    int solution_len_bound, initial_solution_len_bound;
+    /* -e means seed the bound of -E with a quick -S run. */
+    bool seed_solution_len_bound;
+    /* -m means also move whole sequences at once, as far as the empty free
+     * cells and piles allow. */
+    bool sequence_moves;
+    /* -D is a mask of the dead position rules to use, or -1 for the
+     * default (only the Seahaven runs rule).  num_dead_moves counts the
+     * moves to dead positions that each rule cut, by the number of the
+     * rule's bit, and they are reported if -D was given. */
+#define FCS_PATS__DEAD_SEAHAVEN_RUNS 0x1
+#define FCS_PATS__DEAD_CYCLES 0x2
+#define FCS_PATS__DEAD_BURIED 0x4
+#define FCS_PATS__NUM_DEAD_RULES 3
+    int dead_rules;
+    bool report_dead_moves;
+    unsigned long num_dead_moves[FCS_PATS__NUM_DEAD_RULES];
+    /* -O skips the moves that only reorder two independent moves, which
+     * would lead to a position that the other order reaches as well
+     * (partial-order reduction).  With FCS_PATS__POR_VERIFY, the deals
+     * that are not won are solved again without it, to check that it did
+     * not lose the solution.  num_reordered_moves counts the skipped
+     * moves. */
+#define FCS_PATS__POR_OFF 0
+#define FCS_PATS__POR_ON 1
+#define FCS_PATS__POR_VERIFY 2
+    int por_mode;
+    unsigned long num_reordered_moves;
+    /* -G means always run the generic solver, rather than the kernel
+     * compiled for the variant. */
+    bool use_generic_kernel;
+    /* -H is how many moves back prune_redundant() looks for the move that
+     * a new one undoes.  1 only stops a card from moving twice in a row.
+     * Beyond that, history has the moves on the path to the position being
+     * expanded, and last_moved[] / last_dest[] the index of the last move
+     * of each card / onto each card, so every check takes constant time.
+     * The first history_base moves lead to the position at level 0 of the
+     * solve stack, and history_depth is the level that the history was
+     * last brought up to, or -1 if it has to be rebuilt. */
+#define FCS_PATS__MAX_HISTORY_LEN 64
+    int max_history_len;
+    fcs_pats__history_entry *history;
+    int history_len, max_history_entries, history_base, history_depth;
+    int last_moved[FCS_PATS__NUM_CARD_LOCS], last_dest[FCS_PATS__NUM_CARD_LOCS];
     /* -S means stack, not queue, the moves to be done. This is a boolean
      * value.
      * Default should be false.
@@ -216,9 +416,7 @@ struct fc_solve__patsolve_thread_struct
     int num_moves_to_cut_off;
     /* win, lose, or fail */
     fc_solve_pats__status_code status;
-#ifdef FCS_PATSOLVE__WITH_FAIL_REASON
     fc_solve_pats__status_fail_reason fail_reason;
-#endif
 #define FCS_PATS__TREE_LIST_NUM_BUCKETS 499 /* a prime */
     fcs_pats__treelist *tree_list[FCS_PATS__TREE_LIST_NUM_BUCKETS];
     fcs_pats__block *my_block;
@@ -246,8 +444,25 @@ typedef struct fc_solve__patsolve_thread_struct fcs_pats_thread;
 extern fcs_pats__insert_code fc_solve_pats__insert(
     fcs_pats_thread *soft_thread, int *cluster, int d, fcs_pats__tree **node);
 extern void fc_solve_pats__do_it(fcs_pats_thread *);
+
+// A solver kernel (see FCS_PATS__KERNEL above) and the variant it is for.
+typedef struct
+{
+    const char *name;
+    int stacks_num, freecells_num;
+    int sequences_are_built_by, empty_stacks_filled_by;
+    void (*do_it)(fcs_pats_thread *);
+} fcs_pats__kernel;
+
+extern const fcs_pats__kernel *fc_solve_pats__find_kernel(
+    const fcs_pats_thread *soft_thread);
+extern fc_solve_pats__status_code fc_solve_pats__do_it_bounded(
+    fcs_pats_thread *, unsigned long max_checked_states, long long max_usecs);
 extern fcs_pats__move *fc_solve_pats__get_moves(
     fcs_pats_thread *soft_thread, fcs_pats_position *, int *);
+extern void fc_solve_pats__update_history(fcs_pats_thread *soft_thread);
+extern int fc_solve_pats__min_moves_to_win(fcs_pats_thread *soft_thread);
+extern bool fc_solve_pats__is_dead_position(fcs_pats_thread *soft_thread);
 extern unsigned char *fc_solve_pats__new_from_block(
     fcs_pats_thread *soft_thread, size_t);
 extern void fc_solve_pats__sort_piles(fcs_pats_thread *soft_thread);
@@ -294,6 +509,13 @@ static inline void fc_solve_pats__init_buckets(
         fc_solve_pats__align(sizeof(fcs_pats_position) + (size_t)freecells_num);
 }
 
+static inline void fc_solve_pats__fail(fcs_pats_thread *const soft_thread,
+    const fc_solve_pats__status_fail_reason reason)
+{
+    soft_thread->status = FCS_PATS__FAIL;
+    soft_thread->fail_reason = reason;
+}
+
 // A function and some macros for allocating memory.
 // Allocate some space and return a pointer to it.  See fc_solve_pats__new()
 static inline void *fc_solve_pats__malloc(
@@ -312,11 +534,11 @@ static inline void *fc_solve_pats__malloc(
             soft_thread->freed_positions = pos;
         }
         if (s > soft_thread->remaining_memory) {
-            soft_thread->status = FCS_PATS__FAIL;
+            fc_solve_pats__fail(soft_thread, FCS_PATS__FAIL_OUT_OF_MEMORY);
             return NULL;
         }
 #else
-        soft_thread->status = FCS_PATS__FAIL;
+        fc_solve_pats__fail(soft_thread, FCS_PATS__FAIL_OUT_OF_MEMORY);
         return NULL;
 #endif
     }
@@ -325,7 +547,7 @@ static inline void *fc_solve_pats__malloc(
 
     if (x == NULL)
     {
-        soft_thread->status = FCS_PATS__FAIL;
+        fc_solve_pats__fail(soft_thread, FCS_PATS__FAIL_OUT_OF_MEMORY);
         return NULL;
     }
 
@@ -400,6 +622,24 @@ static inline void fc_solve_pats__free_clusters(
     }
 }
 
+static inline void fc_solve_pats__free_beam(fcs_pats_thread *const soft_thread)
+{
+    for (int i = 0; i < soft_thread->num_beam_layers; i++)
+    {
+        var_AUTO(layer, &soft_thread->beam_layers[i]);
+        if (layer->items)
+        {
+            fc_solve_pats__free_array(soft_thread, layer->items,
+                fcs_pats__beam_item, (size_t)layer->capacity);
+            layer->items = NULL;
+        }
+        layer->capacity = layer->count = layer->next = 0;
+        layer->is_sorted = false;
+    }
+    soft_thread->beam_depth = 0;
+    soft_thread->beam_seq = 0;
+}
+
 static inline void fc_solve_pats__soft_thread_reset_helper(
     fcs_pats_thread *const soft_thread)
 {
@@ -407,14 +647,20 @@ static inline void fc_solve_pats__soft_thread_reset_helper(
     soft_thread->num_checked_states = 0;
     soft_thread->num_states_in_collection = 0;
     soft_thread->num_solutions = 0;
+    memset(soft_thread->num_dead_moves, 0,
+        sizeof(soft_thread->num_dead_moves));
+    soft_thread->num_reordered_moves = 0;
 
     soft_thread->status = FCS_PATS__NOSOL;
+    soft_thread->fail_reason = FCS_PATS__FAIL_CHECKED_STATES;
+    soft_thread->is_limit_exceeded = false;
 
     soft_thread->dequeue__qpos = 0;
     soft_thread->dequeue__minpos = 0;
 
     soft_thread->curr_solve_depth = 0;
     soft_thread->curr_solve_pos = NULL;
+    soft_thread->history_depth = -1;
 }
 
 static inline void fc_solve_pats__recycle_soft_thread(
@@ -423,6 +669,7 @@ static inline void fc_solve_pats__recycle_soft_thread(
     fc_solve_pats__free_buckets(soft_thread);
     fc_solve_pats__free_clusters(soft_thread);
     fc_solve_pats__free_blocks(soft_thread);
+    fc_solve_pats__free_beam(soft_thread);
 
     if (soft_thread->moves_to_win)
     {
@@ -438,11 +685,43 @@ static inline void fc_solve_pats__init_soft_thread(
 {
     soft_thread->instance = instance;
     soft_thread->dont_exit_on_sol = false;
+    soft_thread->initial_solution_len_bound = INT_MAX;
+    soft_thread->solution_len_bound = INT_MAX;
+    soft_thread->seed_solution_len_bound = false;
+    soft_thread->sequence_moves = false;
+    soft_thread->dead_rules = -1;
+    soft_thread->report_dead_moves = false;
+    soft_thread->max_history_len = 1;
+    soft_thread->por_mode = FCS_PATS__POR_OFF;
+    soft_thread->use_generic_kernel = false;
+    soft_thread->history = NULL;
+    soft_thread->history_len = 0;
+    soft_thread->max_history_entries = 0;
     soft_thread->to_stack = false;
     soft_thread->num_moves_to_cut_off = 1;
     soft_thread->remaining_memory = (50 * 1000 * 1000);
     soft_thread->freed_positions = NULL;
     soft_thread->max_num_checked_states = ULONG_MAX;
+    soft_thread->max_wall_usecs = 0;
+    soft_thread->max_cpu_usecs = 0;
+    soft_thread->interrupt_requested = NULL;
+    soft_thread->step_start_checked_states = 0;
+    soft_thread->step_end_checked_states = ULONG_MAX;
+    soft_thread->step_end_usecs = 0;
+    soft_thread->is_step_done = false;
+    soft_thread->checkpoint_filename = NULL;
+    soft_thread->resume_filename = NULL;
+    soft_thread->checkpoint_interval_usecs =
+        FCS_PATS__DEFAULT_CHECKPOINT_INTERVAL_USECS;
+    soft_thread->out = stdout;
+    soft_thread->move_weights = NULL;
+    soft_thread->beam_width = 0;
+    soft_thread->max_beam_width = 0;
+    soft_thread->beam_layers = NULL;
+    soft_thread->num_beam_layers = 0;
+    soft_thread->beam_depth = 0;
+    soft_thread->beam_seq = 0;
+    soft_thread->num_beam_discarded = 0;
 
     soft_thread->moves_to_win = NULL;
     soft_thread->num_moves_to_win = 0;
@@ -459,6 +738,12 @@ static inline void fc_solve_pats__destroy_soft_thread(
 {
     free(soft_thread->solve_stack);
     soft_thread->solve_stack = NULL;
+    free(soft_thread->beam_layers);
+    soft_thread->beam_layers = NULL;
+    soft_thread->num_beam_layers = 0;
+    free(soft_thread->history);
+    soft_thread->history = NULL;
+    soft_thread->max_history_entries = 0;
     soft_thread->max_solve_depth = 0;
     soft_thread->curr_solve_depth = -1;
 }
@@ -479,15 +764,46 @@ extern fcs_pats_position *fc_solve_pats__new_position(
     fcs_pats_thread *const soft_thread, fcs_pats_position *const parent,
     const fcs_pats__move *const m);
 
-extern void fc_solve_pats__queue_position(
+extern bool fc_solve_pats__queue_position(
     fcs_pats_thread *const soft_thread, fcs_pats_position *const pos, int pri);
 
-#if !defined(HARD_CODED_NUM_STACKS)
+#if !defined(HARD_CODED_NUM_STACKS) && !defined(FCS_PATS__KERNEL)
 #define DECLARE_STACKS() const_SLOT(game_params, soft_thread->instance)
 #else
 #define DECLARE_STACKS()
 #endif
 
+static inline void fc_solve_pats__set_card_loc(
+    fcs_pats_thread *const soft_thread, const fcs_card card, const int col,
+    const int depth)
+{
+    soft_thread->current_pos.card_locs[card] = (fcs_pats__card_loc){
+        .col = (signed char)col, .depth = (signed char)depth};
+}
+
+// Rebuild the card locations from scratch after the whole position changed.
+static inline void fc_solve_pats__index_cards(
+    fcs_pats_thread *const soft_thread)
+{
+    DECLARE_STACKS();
+
+    for (int i = 0; i < FCS_PATS__NUM_CARD_LOCS; i++)
+    {
+        fc_solve_pats__set_card_loc(
+            soft_thread, (fcs_card)i, FCS_PATS__NOT_IN_COLUMN, 0);
+    }
+    for (int w = 0; w < LOCAL_STACKS_NUM; w++)
+    {
+        const_AUTO(col, fcs_state_get_col(soft_thread->current_pos.s, w));
+        const int len = fcs_col_len(col);
+        for (int i = 0; i < len; i++)
+        {
+            fc_solve_pats__set_card_loc(
+                soft_thread, fcs_col_get_card(col, i), w, i);
+        }
+    }
+}
+
 static inline void fc_solve_pats__hash_layout(
     fcs_pats_thread *const soft_thread)
 {
@@ -499,15 +815,91 @@ static inline void fc_solve_pats__hash_layout(
     }
 }
 
+/* Sequence moves (-m).  With num_free empty free cells and num_spare empty
+piles (besides the destination), a sequence of up to
+(num_free + 1) * 2^num_spare cards can be moved one card at a time. */
+static inline int fc_solve_pats__seq_capacity(
+    const int num_free, const int num_spare)
+{
+    return (num_free + 1) << num_spare;
+}
+
+// The number of empty piles needed to move num_cards cards.
+static inline int fc_solve_pats__seq_num_spare(
+    const int num_cards, const int num_free)
+{
+    int num_spare = 0;
+    while (fc_solve_pats__seq_capacity(num_free, num_spare) < num_cards)
+    {
+        num_spare++;
+    }
+    return num_spare;
+}
+
+/* The number of single card moves in moving num_cards cards.  This follows
+the order of expand_seq_move() in pat.c: go through the free cells if they
+are enough, else move the top of the sequence to a spare pile, move the rest
+with one spare pile less, and move the top back onto it. */
+static inline int fc_solve_pats__seq_len(
+    const int num_cards, const int num_free, const int num_spare)
+{
+    if (num_cards <= num_free + 1)
+    {
+        return 2 * num_cards - 1;
+    }
+    const int rest_capacity =
+        fc_solve_pats__seq_capacity(num_free, num_spare - 1);
+    if (num_cards <= rest_capacity)
+    {
+        return fc_solve_pats__seq_len(num_cards, num_free, num_spare - 1);
+    }
+    const int num_top = num_cards - rest_capacity;
+    return 2 * fc_solve_pats__seq_len(num_top, num_free, num_spare - 1) +
+           fc_solve_pats__seq_len(rest_capacity, num_free, num_spare - 1);
+}
+
+/* The number of single card moves that a move from parent stands for.
+Positions count their depth in these, so the solution length bounds keep
+working with -m. */
+static inline int fc_solve_pats__move_len(fcs_pats_thread *const soft_thread,
+    const fcs_pats__move *const m, const fcs_pats_position *const parent)
+{
+    if (m->num_cards <= 1)
+    {
+        return 1;
+    }
+    DECLARE_STACKS();
+    const int num_free =
+        LOCAL_FREECELLS_NUM - parent->num_cards_in_freecells;
+    return fc_solve_pats__seq_len(m->num_cards, num_free,
+        fc_solve_pats__seq_num_spare(m->num_cards, num_free));
+}
+
+#define FCS_PATS__CLOCK_CHECK_INTERVAL 1024
+
+static inline void fc_solve_pats__start_clocks(
+    fcs_pats_thread *const soft_thread)
+{
+    soft_thread->is_limit_exceeded = false;
+    soft_thread->clock_check_countdown = FCS_PATS__CLOCK_CHECK_INTERVAL;
+    soft_thread->wall_start_usecs =
+        (soft_thread->max_wall_usecs ? fc_solve_pats__wall_usecs() : 0);
+    soft_thread->cpu_start_usecs =
+        (soft_thread->max_cpu_usecs ? fc_solve_pats__cpu_usecs() : 0);
+}
+
 static inline void fc_solve_pats__initialize_solving_process(
     fcs_pats_thread *const soft_thread)
 {
+    fc_solve_pats__start_clocks(soft_thread);
+    soft_thread->solution_len_bound = soft_thread->initial_solution_len_bound;
     // Init the queues.
     for (int i = 0; i < FC_SOLVE_PATS__NUM_QUEUES; i++)
     {
         soft_thread->queue_head[i] = NULL;
     }
     soft_thread->max_queue_idx = 0;
+    soft_thread->num_beam_discarded = 0;
 #ifdef DEBUG
     memset(soft_thread->num_positions_in_clusters, 0,
         sizeof(soft_thread->num_positions_in_clusters));
@@ -517,6 +909,7 @@ static inline void fc_solve_pats__initialize_solving_process(
 
     // Queue the initial position to get started.
     fc_solve_pats__hash_layout(soft_thread);
+    fc_solve_pats__index_cards(soft_thread);
     fc_solve_pats__sort_piles(soft_thread);
     fcs_pats__move m;
     m.card = fc_solve_empty_card;
@@ -529,6 +922,58 @@ static inline void fc_solve_pats__initialize_solving_process(
     fc_solve_pats__queue_position(soft_thread, pos, 0);
 }
 
+// Short names for the outcome of a deal, as printed in range mode.
+static inline const char *fc_solve_pats__status_name(
+    const fcs_pats_thread *const soft_thread)
+{
+    switch (soft_thread->status)
+    {
+    case FCS_PATS__WIN:
+        return "Won";
+    case FCS_PATS__NOSOL:
+        return "Impossible";
+    case FCS_PATS__SUSPENDED:
+        return "Suspended";
+    default:
+        break;
+    }
+    switch (soft_thread->fail_reason)
+    {
+    case FCS_PATS__FAIL_CHECKED_STATES:
+        return "Iterations";
+    case FCS_PATS__FAIL_WALL_TIME:
+        return "WallTime";
+    case FCS_PATS__FAIL_CPU_TIME:
+        return "CPUTime";
+    case FCS_PATS__FAIL_PILE_IDS:
+        return "PileIds";
+    case FCS_PATS__FAIL_INTERRUPTED:
+        return "Interrupted";
+    default:
+        return "OutOfMem";
+    }
+}
+
+static inline const char *fc_solve_pats__fail_reason_message(
+    const fc_solve_pats__status_fail_reason reason)
+{
+    switch (reason)
+    {
+    case FCS_PATS__FAIL_CHECKED_STATES:
+        return "Exceeded the iterations limit.";
+    case FCS_PATS__FAIL_WALL_TIME:
+        return "Exceeded the wall time limit.";
+    case FCS_PATS__FAIL_CPU_TIME:
+        return "Exceeded the CPU time limit.";
+    case FCS_PATS__FAIL_PILE_IDS:
+        return "Ran out of pile numbers.";
+    case FCS_PATS__FAIL_INTERRUPTED:
+        return "Interrupted.";
+    default:
+        return "Out of memory.";
+    }
+}
+
 static inline void fc_solve_pats__set_cut_off(
     fcs_pats_thread *const soft_thread)
 {
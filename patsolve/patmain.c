@@ -6,7 +6,13 @@
 //
 // Copyright (c) 2002 Tom Holroyd
 // Main().  Parse args, read the position, and call the solver.
+#include <signal.h>
 #include "pat.h"
+#include "checkpoint.h"
+#include "deal_corpus.h"
+#include "pats_clock.h"
+#include "pats_socket.h"
+#include "results_db.h"
 #include "range_solvers_gen_ms_boards.h"
 
 #include "print_layout.h"
@@ -16,14 +22,68 @@
 #include "pats__print_msg.h"
 
 static const char Usage[] =
-    "usage: %s [-s|f] [-k|a] [-w<n>] [-t<n>] [-E] [-S] [-q|v] [layout]\n"
+    "usage: %s [-s|f] [-k|a] [-w<n>] [-t<n>] [-E] [-S] [-B<n>] [-W<n>]\n"
+    "    [-e] [-L<n>] [-m] [-G] [-D<n>] [-H<n>] [-O<n>] [-I<n>] [-T<secs>]\n"
+    "    [-C<secs>] [-K<file>] [-R<file>] [-J<secs>] [-q|v]\n"
+    "    [--server[=<address>]] [--results-db=<file>] [--corpus=<file>]\n"
+    "    [--solutions=<file>] [--params-file=<file>] [--preset-rules=<file>]\n"
+    "    [--features] [--move-weights=<file>] [layout]\n"
     "-s Seahaven (same suit), -f Freecell (red/black)\n"
     "-k only Kings start a pile, -a any card starts a pile\n"
     "-w<n> number of work piles, -t<n> number of free cells\n"
     "-E don't exit after one solution; continue looking for better ones\n"
+    "-e with -E, start from the length of a quick -S solution\n"
+    "-L<n> only look for solutions shorter than <n> moves\n"
     "-S speed mode; find a solution quickly, rather than a good solution\n"
+    "-m also move whole sequences at once (the solution has single moves)\n"
+    "-G use the generic solver, not the one compiled for the variant\n"
+    "-D<n> cut dead positions by the rules in the bit mask <n>: 1 Seahaven\n"
+    "    runs, 2 cyclic blockers, 4 buried cards (default 1), and report it\n"
+    "-H<n> prune moves that undo one of the last <n> moves (default 1)\n"
+    "-O<n> 1 skips moves that only reorder independent moves, 2 also checks\n"
+    "    that this did not lose the solution, by solving again without it\n"
+    "-B<n> beam search; keep only the best <n> positions at each depth\n"
+    "-W<n> on failure, retry with a wider beam, up to <n> positions\n"
+    "-I<n> give up on a deal after checking <n> positions\n"
+    "-T<secs> give up on a deal after <secs> seconds of wall time\n"
+    "-C<secs> give up on a deal after <secs> seconds of CPU time\n"
+    "-K<file> save the search to <file> when it stops early or on SIGTERM\n"
+    "-J<secs> also save it every <secs> seconds (default 600, 0 is never)\n"
+    "-R<file> resume a search saved with -K (give the same layout)\n"
     "-q quiet, -v verbose\n"
-    "-s implies -aw10 -t4, -f implies -aw8 -t4\n";
+    "-s implies -aw10 -t4, -f implies -aw8 -t4\n"
+    "--server answer requests on stdin, or at unix:<path> or <host>:<port>\n"
+    "    (see serve_requests() in patmain.c)\n"
+    "--results-db=<file> in range mode, also record the result of each deal\n"
+    "    in <file>, which pats-results reads\n"
+    "--corpus=<file> in range mode, take the deals from <file>, which\n"
+    "    pats-msdeal --corpus wrote (by default, all of them)\n"
+    "--solutions=<file> in range mode, also write the solution of each deal\n"
+    "    to <file> (indexed in <file>.idx), which pats-solutions prints;\n"
+    "    \"-\" is stdout, and then the reports go to stderr\n"
+    "--params-file=<file> read the presets of -P and of the variants from\n"
+    "    <file>, in the format of param.dat\n"
+    "--preset-rules=<file> choose the preset of each deal by its features,\n"
+    "    with the rules in <file> (see presets.h and select_presets.py)\n"
+    "--features in range mode, print the features of each deal that the\n"
+    "    rules test, instead of solving it\n"
+    "--move-weights=<file> order the moves by the weights of their features\n"
+    "    in <file> (see move_model.h and pats-learn), not by the -X ones\n";
+
+// The rules of --preset-rules, if it was given.
+static const char *preset_rules_path = NULL;
+static fcs_pats__preset_selector preset_selector;
+// The parameters of the variant, for the deals that no rule matches.
+static fcs_pats_xy_params variant_params;
+
+static inline void select_preset(fcs_pats_thread *const soft_thread)
+{
+    if (preset_rules_path)
+    {
+        fc_solve_pats__select_preset(
+            soft_thread, &preset_selector, &variant_params);
+    }
+}
 
 static inline void trace_solution(
     fcs_pats_thread *const soft_thread, FILE *const out, const bool is_quiet)
@@ -78,20 +138,377 @@ static inline void trace_solution(
     }
 }
 
+static inline void write_win_file(
+    fcs_pats_thread *const soft_thread, const bool is_quiet)
+{
+    FILE *const out = fopen("win", "w");
+    if (!out)
+    {
+        fprintf(stderr, "%s\n", "Cannot open 'win' for writing.");
+        exit(1);
+    }
+    trace_solution(soft_thread, out, is_quiet);
+    fclose(out);
+}
+
+static volatile sig_atomic_t interrupt_requested = 0;
+
+static void on_terminate(int signum) { interrupt_requested = 1; }
+
+static inline void save_checkpoint(
+    fcs_pats_thread *const soft_thread, const bool is_quiet)
+{
+    if (!fc_solve_pats__save_checkpoint(
+            soft_thread, soft_thread->checkpoint_filename))
+    {
+        fatalerr("Cannot write the checkpoint '%s'.",
+            soft_thread->checkpoint_filename);
+    }
+    if (!is_quiet)
+    {
+        printf("Saved a checkpoint to '%s'.\n",
+            soft_thread->checkpoint_filename);
+    }
+}
+
+/* Play the layout like fc_solve_pats__play(), but start from a checkpoint
+with -R, and save one with -K every -J seconds, on SIGTERM / SIGINT and when
+a limit stops the search (so it can be resumed with a higher limit). */
+static inline void play_with_checkpoints(
+    fcs_pats_thread *const soft_thread, const bool is_quiet)
+{
+    if (soft_thread->resume_filename)
+    {
+        if (!fc_solve_pats__load_checkpoint(
+                soft_thread, soft_thread->resume_filename))
+        {
+            fatalerr("Cannot resume from '%s'.", soft_thread->resume_filename);
+        }
+    }
+    else
+    {
+        fc_solve_pats__start_play(soft_thread);
+    }
+    if (!soft_thread->checkpoint_filename)
+    {
+        fc_solve_pats__do_it(soft_thread);
+        fc_solve_pats__print_result(soft_thread, is_quiet);
+        return;
+    }
+
+    soft_thread->interrupt_requested = &interrupt_requested;
+    signal(SIGTERM, on_terminate);
+    signal(SIGINT, on_terminate);
+    // Run in slices of -J seconds, with a checkpoint after each one.
+    while (fc_solve_pats__do_it_bounded(soft_thread, 0,
+               soft_thread->checkpoint_interval_usecs) == FCS_PATS__SUSPENDED)
+    {
+        save_checkpoint(soft_thread, is_quiet);
+    }
+    soft_thread->interrupt_requested = NULL;
+    if (soft_thread->status == FCS_PATS__FAIL &&
+        soft_thread->fail_reason != FCS_PATS__FAIL_OUT_OF_MEMORY &&
+        soft_thread->fail_reason != FCS_PATS__FAIL_PILE_IDS)
+    {
+        save_checkpoint(soft_thread, is_quiet);
+    }
+    fc_solve_pats__print_result(soft_thread, is_quiet);
+}
+
+/* The server mode (--server).  Each request is a line, and the layout of
+"SOLVE" follows it:
+
+    SOLVE <len>\n<len bytes of a layout>
+    DEAL <n>\n              (Microsoft deal <n>)
+    QUIT\n
+
+and each answer is
+
+    RESULT <status> <moves> <positions> <usecs> <len>\n<len bytes>
+
+where the bytes are the moves, as in the win file, or "ERROR <message>\n".
+All the requests are solved by the same soft thread, with the options that
+the server was started with. */
+static void serve_requests(
+    fcs_pats_thread *const soft_thread, FILE *const in, FILE *const out)
+{
+    fcs_state_string state_string;
+    char *moves = NULL;
+    size_t moves_size = 0;
+    FILE *const moves_fh = open_memstream(&moves, &moves_size);
+    if (!moves_fh)
+    {
+        fatalerr("Cannot open the output buffer.");
+    }
+    char line[100];
+    while (fgets(line, sizeof(line), in))
+    {
+        if (!strchr(line, '\n') && !feof(in))
+        {
+            fprintf(out, "ERROR The request is too long.\n");
+            fflush(out);
+            // Skip the rest of it, to find the next request.
+            int c;
+            while ((c = fgetc(in)) != EOF && c != '\n')
+            {
+            }
+            continue;
+        }
+        size_t len;
+        // A DEAL request, or -1 for a layout.
+        long long deal_num = -1;
+        if (sscanf(line, "SOLVE %zu", &len) == 1)
+        {
+            if (len >= sizeof(state_string))
+            {
+                fprintf(out, "ERROR The layout is too long.\n");
+                fflush(out);
+                // Skip it, to find the next request.
+                for (; len > 0 && fgetc(in) != EOF; --len)
+                {
+                }
+                continue;
+            }
+            if (fread(state_string, 1, len, in) != len)
+            {
+                break;
+            }
+            state_string[len] = '\0';
+        }
+        else if (sscanf(line, "DEAL %lld", &deal_num) == 1)
+        {
+            if (deal_num < 0)
+            {
+                fprintf(out, "ERROR Unknown request.\n");
+                fflush(out);
+                continue;
+            }
+        }
+        else if (!strcmp(line, "QUIT\n"))
+        {
+            break;
+        }
+        else
+        {
+            fprintf(out, "ERROR Unknown request.\n");
+            fflush(out);
+            continue;
+        }
+
+        const long long start_usecs = fc_solve_pats__wall_usecs();
+        if (deal_num >= 0)
+        {
+            fc_solve_pats__read_deal(soft_thread, deal_num);
+        }
+        else if (!fc_solve_pats__read_layout(soft_thread, state_string))
+        {
+            fprintf(out, "ERROR Not a layout of the 52 cards.\n");
+            fflush(out);
+            continue;
+        }
+        select_preset(soft_thread);
+        fc_solve_pats__play(soft_thread, true);
+        const long long usecs = fc_solve_pats__wall_usecs() - start_usecs;
+        const long num_moves = (long)soft_thread->num_moves_to_win;
+        fseeko(moves_fh, 0, SEEK_SET);
+        // With -E, a search that failed may still have found a solution.
+        if (soft_thread->moves_to_win)
+        {
+            trace_solution(soft_thread, moves_fh, true);
+        }
+        fflush(moves_fh);
+        const size_t moves_len = (size_t)ftello(moves_fh);
+        fprintf(out, "RESULT %s %ld %lu %lld %zu\n",
+            fc_solve_pats__status_name(soft_thread), num_moves,
+            (unsigned long)soft_thread->num_checked_states, usecs, moves_len);
+        fwrite(moves, 1, moves_len, out);
+        fflush(out);
+        fc_solve_pats__recycle_soft_thread(soft_thread);
+    }
+    fclose(moves_fh);
+    free(moves);
+}
+
+// Serve the requests on stdin, or on each connection to the address.
+static void run_server(
+    fcs_pats_thread *const soft_thread, const char *const address)
+{
+    // Keep the answers apart from the reports of fc_solve_pats__play().
+    soft_thread->out = stderr;
+    if (!address)
+    {
+        serve_requests(soft_thread, stdin, stdout);
+        return;
+    }
+    const int listen_fd = fc_solve_pats__open_socket(address, true);
+    if (listen_fd < 0)
+    {
+        fatalerr("Cannot listen at '%s'.", address);
+    }
+    signal(SIGPIPE, SIG_IGN);
+    while (true)
+    {
+        const int fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0)
+        {
+            continue;
+        }
+        FILE *const in = fdopen(fd, "r");
+        FILE *const out = fdopen(dup(fd), "w");
+        if (in && out)
+        {
+            serve_requests(soft_thread, in, out);
+        }
+        if (in)
+        {
+            fclose(in);
+        }
+        if (out)
+        {
+            fclose(out);
+        }
+    }
+}
+
 #include "read_state.h"
 int main(int argc, char **argv)
 {
-    const long long start_board_idx =
+    program_name = argv[0];
+    long long start_board_idx =
         get_idx_from_env("PATSOLVE_START"); // for range solving
-    const long long end_board_idx = get_idx_from_env("PATSOLVE_END");
+    long long end_board_idx = get_idx_from_env("PATSOLVE_END");
 
     fcs_pats_thread soft_thread_struct__dont_use_directly;
     fcs_pats_thread *const soft_thread = &soft_thread_struct__dont_use_directly;
 
+    // Take our long options out, and leave the rest for the usual options.
+    bool is_server = false;
+    const char *server_address = NULL;
+    const char *results_db_path = NULL;
+    const char *corpus_path = NULL;
+    const char *solutions_path = NULL;
+    const char *params_path = NULL;
+    const char *move_weights_path = NULL;
+    bool is_features_mode = false;
+    int new_argc = 1;
+    for (int arg_idx = 1; arg_idx < argc; ++arg_idx)
+    {
+        if (!strcmp(argv[arg_idx], "--server"))
+        {
+            is_server = true;
+        }
+        else if (!strncmp(argv[arg_idx], "--server=", 9))
+        {
+            is_server = true;
+            server_address = argv[arg_idx] + 9;
+        }
+        else if (!strncmp(argv[arg_idx], "--results-db=", 13))
+        {
+            results_db_path = argv[arg_idx] + 13;
+        }
+        else if (!strncmp(argv[arg_idx], "--corpus=", 9))
+        {
+            corpus_path = argv[arg_idx] + 9;
+        }
+        else if (!strncmp(argv[arg_idx], "--solutions=", 12))
+        {
+            solutions_path = argv[arg_idx] + 12;
+        }
+        else if (!strncmp(argv[arg_idx], "--params-file=", 14))
+        {
+            params_path = argv[arg_idx] + 14;
+        }
+        else if (!strncmp(argv[arg_idx], "--preset-rules=", 15))
+        {
+            preset_rules_path = argv[arg_idx] + 15;
+        }
+        else if (!strncmp(argv[arg_idx], "--move-weights=", 15))
+        {
+            move_weights_path = argv[arg_idx] + 15;
+        }
+        else if (!strcmp(argv[arg_idx], "--features"))
+        {
+            is_features_mode = true;
+        }
+        else
+        {
+            argv[new_argc++] = argv[arg_idx];
+        }
+    }
+    argc = new_argc;
+    argv[argc] = NULL;
+
+    if (params_path)
+    {
+        fc_solve_pats__load_params_file(params_path);
+    }
     fcs_instance instance_struct;
     bool is_quiet = false;
     fc_solve_pats__configure_soft_thread(soft_thread, &instance_struct, &argc,
         (const char ***)(&argv), &is_quiet);
+    variant_params = soft_thread->pats_solve_params;
+    double move_weights[FCS_PATS__NUM_MOVE_FEATURES];
+    if (move_weights_path)
+    {
+        fc_solve_pats__load_move_weights(move_weights, move_weights_path);
+        soft_thread->move_weights = move_weights;
+    }
+    if (preset_rules_path)
+    {
+        fc_solve_pats__load_preset_rules(&preset_selector, preset_rules_path);
+    }
+    fcs_pats__corpus corpus = {.map = NULL};
+    if (corpus_path)
+    {
+        if (is_server)
+        {
+            fatalerr("--corpus doesn't work with --server.");
+        }
+        if (!fc_solve_pats__corpus_open(&corpus, corpus_path))
+        {
+            fatalerr("Cannot read the corpus '%s'.", corpus_path);
+        }
+        // By default, solve all of the corpus.
+        if (start_board_idx < 0)
+        {
+            start_board_idx = corpus.start_deal_num;
+            end_board_idx = corpus.end_deal_num;
+        }
+        else if (start_board_idx < corpus.start_deal_num ||
+                 end_board_idx > corpus.end_deal_num)
+        {
+            fatalerr("The corpus '%s' has deals %lld to %lld only.",
+                corpus_path, corpus.start_deal_num, corpus.end_deal_num - 1);
+        }
+    }
+    if (is_server)
+    {
+        if (soft_thread->checkpoint_filename || soft_thread->resume_filename)
+        {
+            fatalerr("-K and -R don't work with --server.");
+        }
+        run_server(soft_thread, server_address);
+        fc_solve_pats__destroy_soft_thread(soft_thread);
+        return 0;
+    }
+    fcs_pats__solutions_stream solutions = {.fh = NULL};
+    if (solutions_path)
+    {
+        if (start_board_idx < 0)
+        {
+            fatalerr("--solutions only works in range mode.");
+        }
+        if (!fc_solve_pats__solutions_open(&solutions, solutions_path))
+        {
+            fatalerr("Cannot write the solutions to '%s'.", solutions_path);
+        }
+        // Keep the reports apart from the solutions.
+        if (solutions.fh == stdout)
+        {
+            soft_thread->out = stderr;
+        }
+    }
+    fc_solve_pats__announce_variation(soft_thread, &instance_struct, &is_quiet);
 
     FILE *in_fh = stdin;
     if (argc && **argv != '-')
@@ -108,34 +525,50 @@ int main(int argc, char **argv)
         // Read in the initial layout and play it.
 
         const fcs_user_state_str user_state = read_state(in_fh);
-        fc_solve_pats__read_layout(soft_thread, user_state.s);
+        if (!fc_solve_pats__read_layout(soft_thread, user_state.s))
+        {
+            fatalerr("The input is not a layout of the 52 cards.");
+        }
+        select_preset(soft_thread);
         if (!is_quiet)
         {
             fc_solve_pats__print_layout(soft_thread);
         }
-        fc_solve_pats__play(soft_thread, is_quiet);
+        if (soft_thread->checkpoint_filename || soft_thread->resume_filename)
+        {
+            play_with_checkpoints(soft_thread, is_quiet);
+        }
+        else
+        {
+            fc_solve_pats__play(soft_thread, is_quiet);
+        }
         const_AUTO(exit_code, (soft_thread->status));
         switch (exit_code)
         {
-        case FCS_PATS__WIN: {
-            FILE *const out = fopen("win", "w");
-            if (!out)
-            {
-                fprintf(stderr, "%s\n", "Cannot open 'win' for writing.");
-                exit(1);
-            }
-            trace_solution(soft_thread, out, is_quiet);
-            fclose(out);
-        }
-        break;
+        case FCS_PATS__WIN:
+            write_win_file(soft_thread, is_quiet);
+            break;
 
         case FCS_PATS__FAIL:
-            printf("%s\n", "Ran out of memory.");
+            printf("%s\n",
+                (soft_thread->fail_reason == FCS_PATS__FAIL_OUT_OF_MEMORY)
+                    ? "Ran out of memory."
+                    : fc_solve_pats__fail_reason_message(
+                          soft_thread->fail_reason));
+            // In -E mode, still report the shortest solution found so far.
+            if (soft_thread->num_solutions > 0 && soft_thread->moves_to_win)
+            {
+                write_win_file(soft_thread, is_quiet);
+            }
             break;
 
         case FCS_PATS__NOSOL:
             printf("%s\n", "Failed to solve.");
             break;
+
+        case FCS_PATS__SUSPENDED:
+            // Only fc_solve_pats__do_it_bounded() returns this.
+            break;
         }
         fc_solve_pats__recycle_soft_thread(soft_thread);
         fc_solve_pats__destroy_soft_thread(soft_thread);
@@ -144,33 +577,104 @@ int main(int argc, char **argv)
     }
     else
     {
-        fcs_state_string state_string;
-        get_board__setup_string(state_string);
+        if (soft_thread->checkpoint_filename || soft_thread->resume_filename)
+        {
+            fatalerr("-K and -R only work on a single deal.");
+        }
+        fcs_pats__results_db results_db = {.fd = -1};
+        if (results_db_path &&
+            !fc_solve_pats__results_db_open(&results_db, results_db_path,
+                start_board_idx, end_board_idx, true))
+        {
+            fatalerr("Cannot open the results database '%s'.",
+                results_db_path);
+        }
+        if (is_features_mode)
+        {
+            fprintf(soft_thread->out, "deal");
+            for (int i = 0; i < FCS_PATS__NUM_FEATURES; i++)
+            {
+                fprintf(
+                    soft_thread->out, " %s", fc_solve_pats__feature_names[i]);
+            }
+            fprintf(soft_thread->out, "\n");
+        }
         // Range mode.  Play lots of consecutive games.
         for (long long board_num = start_board_idx; board_num < end_board_idx;
             ++board_num)
         {
-            printf("#%ld\n", (long)board_num);
-            get_board_l__without_setup(board_num, state_string);
-            fc_solve_pats__read_layout(soft_thread, state_string);
+            if (!is_features_mode)
+            {
+                fprintf(soft_thread->out, "#%ld\n", (long)board_num);
+            }
+            const long long start_usecs = fc_solve_pats__wall_usecs();
+            if (corpus_path)
+            {
+                const uint8_t *const cards =
+                    fc_solve_pats__corpus_deal(&corpus, board_num);
+                if (!cards)
+                {
+                    fatalerr("Deal %lld of the corpus is not a deal.",
+                        board_num);
+                }
+                fc_solve_pats__read_dealt_cards(soft_thread, cards);
+            }
+            else
+            {
+                fc_solve_pats__read_deal(soft_thread, board_num);
+            }
+            if (is_features_mode)
+            {
+                int features[FCS_PATS__NUM_FEATURES];
+                fc_solve_pats__deal_features(soft_thread, features);
+                fprintf(soft_thread->out, "%lld", board_num);
+                for (int i = 0; i < FCS_PATS__NUM_FEATURES; i++)
+                {
+                    fprintf(soft_thread->out, " %d", features[i]);
+                }
+                fprintf(soft_thread->out, "\n");
+                continue;
+            }
+            select_preset(soft_thread);
             fc_solve_pats__play(soft_thread, is_quiet);
-            switch (soft_thread->status)
+            fprintf(soft_thread->out, "#%ld - %s\n", (long)board_num,
+                fc_solve_pats__status_name(soft_thread));
+            if (solutions_path &&
+                (!fc_solve_pats__solutions_index(&solutions, board_num, 0) ||
+                    !fc_solve_pats__write_solution(
+                        soft_thread, board_num, solutions.fh)))
             {
-            case FCS_PATS__WIN:
-                printf("#%ld - Won\n", (long)board_num);
-                break;
-
-            case FCS_PATS__FAIL:
-                printf("#%ld - OutOfMem\n", (long)board_num);
-                break;
-
-            case FCS_PATS__NOSOL:
-                printf("#%ld - Impossible\n", (long)board_num);
-                break;
+                fatalerr("Cannot write the solutions to '%s'.", solutions_path);
+            }
+            if (results_db_path)
+            {
+                fc_solve_pats__results_db_set(&results_db, board_num,
+                    fc_solve_pats__status_name(soft_thread),
+                    soft_thread->num_moves_to_win,
+                    soft_thread->num_checked_states,
+                    soft_thread->num_states_in_collection,
+                    fc_solve_pats__wall_usecs() - start_usecs);
             }
             fc_solve_pats__recycle_soft_thread(soft_thread);
-            fflush(stdout);
+            fflush(soft_thread->out);
+        }
+        if (solutions_path && !fc_solve_pats__solutions_close(&solutions))
+        {
+            fatalerr("Cannot write the solutions to '%s'.", solutions_path);
+        }
+        if (results_db_path)
+        {
+            fc_solve_pats__results_db_close(&results_db);
+        }
+        if (corpus_path)
+        {
+            fc_solve_pats__corpus_close(&corpus);
+        }
+        if (preset_rules_path)
+        {
+            fc_solve_pats__preset_rules_free(&preset_selector);
         }
+        fc_solve_pats__presets_free(&fc_solve_pats__presets);
         fc_solve_pats__destroy_soft_thread(soft_thread);
 
         return 0;
@@ -0,0 +1,35 @@
+// This file is part of patsolve. It is subject to the license terms in
+// the LICENSE file found in the top-level directory of this distribution
+// and at https://github.com/shlomif/patsolve/blob/master/LICENSE . No
+// part of patsolve, including this file, may be copied, modified, propagated,
+// or distributed except according to the terms contained in the COPYING file.
+//
+// pats_clock.h : the clocks used for the per-deal time limits.
+#pragma once
+
+#include <time.h>
+
+// Microseconds of wall time, from an arbitrary starting point.
+static inline long long fc_solve_pats__wall_usecs(void)
+{
+#ifdef CLOCK_MONOTONIC
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((long long)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000);
+#else
+    return ((long long)time(NULL) * 1000000LL);
+#endif
+}
+
+/* Microseconds of CPU time used by the calling thread (or by the whole
+process, where there is no per-thread clock). */
+static inline long long fc_solve_pats__cpu_usecs(void)
+{
+#ifdef CLOCK_THREAD_CPUTIME_ID
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ((long long)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000);
+#else
+    return ((long long)clock() * 1000000LL / CLOCKS_PER_SEC);
+#endif
+}
@@ -0,0 +1,135 @@
+// This file is part of patsolve. It is subject to the license terms in
+// the LICENSE file found in the top-level directory of this distribution
+// and at https://github.com/shlomif/patsolve/blob/master/LICENSE . No
+// part of patsolve, including this file, may be copied, modified, propagated,
+// or distributed except according to the terms contained in the COPYING file.
+//
+// pats_socket.h : the sockets that pats-coordinator and its workers talk
+// over.  An address is either "unix:<path>" or "<host>:<port>" (TCP).
+#pragma once
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+static inline int fc_solve_pats__open_unix_socket(
+    const char *const path, const bool is_server)
+{
+    struct sockaddr_un addr;
+    if (strlen(path) >= sizeof(addr.sun_path))
+    {
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    if (is_server)
+    {
+        unlink(path);
+        if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0 &&
+            listen(fd, SOMAXCONN) == 0)
+        {
+            return fd;
+        }
+    }
+    else if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0)
+    {
+        return fd;
+    }
+    close(fd);
+    return -1;
+}
+
+static inline int fc_solve_pats__open_tcp_socket(
+    const char *const address, const bool is_server)
+{
+    const char *const colon = strrchr(address, ':');
+    if (!colon)
+    {
+        return -1;
+    }
+    const size_t host_len = (size_t)(colon - address);
+    char host[host_len + 1];
+    memcpy(host, address, host_len);
+    host[host_len] = '\0';
+
+    struct addrinfo hints, *addrs;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = (is_server ? AI_PASSIVE : 0);
+    // An empty host listens on every interface, or connects to this host.
+    if (getaddrinfo(
+            (host_len ? host : NULL), colon + 1, &hints, &addrs) != 0)
+    {
+        return -1;
+    }
+    int fd = -1;
+    for (const struct addrinfo *a = addrs; a; a = a->ai_next)
+    {
+        fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        if (fd < 0)
+        {
+            continue;
+        }
+        if (is_server)
+        {
+            const int yes = 1;
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+            if (bind(fd, a->ai_addr, a->ai_addrlen) == 0 &&
+                listen(fd, SOMAXCONN) == 0)
+            {
+                break;
+            }
+        }
+        else if (connect(fd, a->ai_addr, a->ai_addrlen) == 0)
+        {
+            break;
+        }
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(addrs);
+    return fd;
+}
+
+/* Listen at the address (is_server), or connect to it.  Returns the socket,
+or -1 on failure. */
+static inline int fc_solve_pats__open_socket(
+    const char *const address, const bool is_server)
+{
+    if (!strncmp(address, "unix:", 5))
+    {
+        return fc_solve_pats__open_unix_socket(address + 5, is_server);
+    }
+    return fc_solve_pats__open_tcp_socket(address, is_server);
+}
+
+// Write all of the buffer, or return false.
+static inline bool fc_solve_pats__write_all(
+    const int fd, const void *const buf, const size_t len)
+{
+    const char *p = buf;
+    const char *const end = p + len;
+    while (p < end)
+    {
+        const ssize_t written = write(fd, p, (size_t)(end - p));
+        if (written <= 0)
+        {
+            return false;
+        }
+        p += written;
+    }
+    return true;
+}
@@ -9,8 +9,11 @@
 #pragma once
 
 #include "freecell-solver/fcs_conf.h"
+#include "move_model.h"
 #include "pat.h"
 #include "pats__print_msg.h"
+#include "presets.h"
+#include "solutions.h"
 
 static inline void fc_solve_pats__before_play(fcs_pats_thread *soft_thread)
 {
@@ -21,50 +24,334 @@ static inline void fc_solve_pats__before_play(fcs_pats_thread *soft_thread)
     soft_thread->num_checked_states = 0;
     soft_thread->num_states_in_collection = 0;
     soft_thread->num_solutions = 0;
+    memset(soft_thread->num_dead_moves, 0,
+        sizeof(soft_thread->num_dead_moves));
+    soft_thread->num_reordered_moves = 0;
     soft_thread->status = FCS_PATS__NOSOL;
 
     fc_solve_pats__initialize_solving_process(soft_thread);
 }
 
-static inline void fc_solve_pats__play(
+/* In beam mode, a search that ran out of positions only proves anything if
+the beam never had to discard one.  Otherwise we may try again from the
+start with a wider beam (up to -W). */
+static inline bool fc_solve_pats__should_widen_beam(
+    const fcs_pats_thread *const soft_thread)
+{
+    return (soft_thread->beam_width &&
+            soft_thread->status == FCS_PATS__NOSOL &&
+            soft_thread->num_solutions == 0 &&
+            soft_thread->num_beam_discarded > 0 &&
+            soft_thread->beam_width < soft_thread->max_beam_width);
+}
+
+static inline void fc_solve_pats__seed_solution_len_bound(
+    fcs_pats_thread *soft_thread);
+
+// Set up the search of the layout that was read into soft_thread.
+static inline void fc_solve_pats__start_play(fcs_pats_thread *const soft_thread)
+{
+    if (soft_thread->dont_exit_on_sol && soft_thread->seed_solution_len_bound)
+    {
+        fc_solve_pats__seed_solution_len_bound(soft_thread);
+    }
+    else
+    {
+        fc_solve_pats__before_play(soft_thread);
+    }
+}
+
+// Report the moves that the -D rules cut, if there were any.
+static inline void fc_solve_pats__print_dead_moves(
+    const fcs_pats_thread *const soft_thread)
+{
+    const unsigned long *const num_dead = soft_thread->num_dead_moves;
+    if (!soft_thread->report_dead_moves ||
+        num_dead[0] + num_dead[1] + num_dead[2] == 0)
+    {
+        return;
+    }
+    fprintf(soft_thread->out,
+        "Cut moves to dead positions: %lu Seahaven runs, %lu cyclic "
+        "blockers, %lu buried cards.\n",
+        num_dead[0], num_dead[1], num_dead[2]);
+}
+
+static inline void fc_solve_pats__print_result(
     fcs_pats_thread *const soft_thread, const bool is_quiet)
 {
-    fc_solve_pats__before_play(soft_thread);
-    fc_solve_pats__do_it(soft_thread);
+    if (soft_thread->status == FCS_PATS__WIN && !is_quiet &&
+        soft_thread->dont_exit_on_sol)
+    {
+        fprintf(soft_thread->out, "No shorter solutions.\n");
+    }
     if (soft_thread->status != FCS_PATS__WIN && !is_quiet)
     {
         if (soft_thread->status == FCS_PATS__FAIL)
         {
-            printf("Out of memory.\n");
-        }
-        else if (soft_thread->dont_exit_on_sol &&
-                 soft_thread->num_solutions > 0)
-        {
-            printf("No shorter solutions.\n");
+            fprintf(soft_thread->out, "%s\n",
+                fc_solve_pats__fail_reason_message(soft_thread->fail_reason));
         }
         else
         {
-            printf("No solution.\n");
+            fprintf(soft_thread->out, "No solution.\n");
         }
 #ifdef DEBUG
-        printf(
+        fprintf(soft_thread->out,
             "%d positions generated.\n", soft_thread->num_states_in_collection);
-        printf("%d unique positions.\n", soft_thread->num_checked_states);
-        printf("remaining_memory = %ld\n", soft_thread->remaining_memory);
+        fprintf(soft_thread->out, "%d unique positions.\n",
+            soft_thread->num_checked_states);
+        fprintf(soft_thread->out, "remaining_memory = %ld\n",
+            soft_thread->remaining_memory);
 #endif
     }
+    if (!is_quiet)
+    {
+        fc_solve_pats__print_dead_moves(soft_thread);
+        if (soft_thread->num_reordered_moves > 0)
+        {
+            fprintf(soft_thread->out, "Skipped reordered moves: %lu.\n",
+                soft_thread->num_reordered_moves);
+        }
+    }
 #ifdef DEBUG
     fc_solve_msg("remaining_memory = %ld\n", soft_thread->remaining_memory);
 #endif
 }
 
-static void set_param(fcs_pats_thread *const soft_thread, const int param_num)
+static inline void fc_solve_pats__play(
+    fcs_pats_thread *const soft_thread, const bool is_quiet)
+{
+    const_AUTO(beam_width, soft_thread->beam_width);
+    const_AUTO(initial_pos, soft_thread->current_pos);
+    fc_solve_pats__start_play(soft_thread);
+    fc_solve_pats__do_it(soft_thread);
+    while (fc_solve_pats__should_widen_beam(soft_thread))
+    {
+        const int new_width =
+            ((soft_thread->beam_width > soft_thread->max_beam_width / 2)
+                    ? soft_thread->max_beam_width
+                    : (soft_thread->beam_width * 2));
+        if (!is_quiet)
+        {
+            fprintf(soft_thread->out,
+                "Beam width %d discarded %lu positions; retrying with %d.\n",
+                soft_thread->beam_width, soft_thread->num_beam_discarded,
+                new_width);
+        }
+        // The time limits are for the whole deal, not for each retry.
+        const_AUTO(wall_start_usecs, soft_thread->wall_start_usecs);
+        const_AUTO(cpu_start_usecs, soft_thread->cpu_start_usecs);
+        fc_solve_pats__recycle_soft_thread(soft_thread);
+        soft_thread->current_pos = initial_pos;
+        soft_thread->beam_width = new_width;
+        fc_solve_pats__before_play(soft_thread);
+        soft_thread->wall_start_usecs = wall_start_usecs;
+        soft_thread->cpu_start_usecs = cpu_start_usecs;
+        fc_solve_pats__do_it(soft_thread);
+    }
+    soft_thread->beam_width = beam_width;
+    fc_solve_pats__print_result(soft_thread, is_quiet);
+
+    /* With -O2, check that the partial-order reduction did not lose the
+    solution of a deal that it found impossible, by solving it again
+    without it.  A search stopped by a limit proves nothing either way. */
+    if (soft_thread->por_mode == FCS_PATS__POR_VERIFY &&
+        soft_thread->status == FCS_PATS__NOSOL)
+    {
+        /* The callers record the result that was reported (with -O), so
+        keep it. */
+        const_AUTO(num_checked_states, soft_thread->num_checked_states);
+        const_AUTO(num_states_in_collection,
+            soft_thread->num_states_in_collection);
+        const_AUTO(num_reordered_moves, soft_thread->num_reordered_moves);
+        unsigned long num_dead_moves[FCS_PATS__NUM_DEAD_RULES];
+        memcpy(num_dead_moves, soft_thread->num_dead_moves,
+            sizeof(num_dead_moves));
+        fc_solve_pats__recycle_soft_thread(soft_thread);
+        soft_thread->current_pos = initial_pos;
+        soft_thread->por_mode = FCS_PATS__POR_OFF;
+        fc_solve_pats__before_play(soft_thread);
+        fc_solve_pats__do_it(soft_thread);
+        soft_thread->por_mode = FCS_PATS__POR_VERIFY;
+        if (soft_thread->status == FCS_PATS__WIN)
+        {
+            fprintf(soft_thread->out,
+                "The partial-order reduction lost the solution.\n");
+        }
+        free(soft_thread->moves_to_win);
+        soft_thread->moves_to_win = NULL;
+        soft_thread->num_moves_to_win = 0;
+        soft_thread->status = FCS_PATS__NOSOL;
+        soft_thread->num_checked_states = num_checked_states;
+        soft_thread->num_states_in_collection = num_states_in_collection;
+        soft_thread->num_reordered_moves = num_reordered_moves;
+        memcpy(soft_thread->num_dead_moves, num_dead_moves,
+            sizeof(num_dead_moves));
+    }
+}
+
+static inline fcs_pats__move_kind fc_solve_pats__move_kind(
+    const fcs_pats__move *const move)
 {
+    switch (move->totype)
+    {
+    case FCS_PATS__TYPE_FREECELL:
+        return FCS_PATS__MOVE_TO_FREECELL;
+    case FCS_PATS__TYPE_FOUNDATION:
+        return FCS_PATS__MOVE_TO_FOUNDATION;
+    default:
+        return (fcs_card_is_empty(move->destcard) ? FCS_PATS__MOVE_TO_EMPTY_PILE
+                                                  : FCS_PATS__MOVE_TO_CARD);
+    }
+}
+
+#define FCS_PATS__CARD_CODE(card)                                              \
+    ((int)((fcs_card_rank(card) << 2) | fcs_card_suit(card)))
+
+/* Write the record of the deal, with the moves of its solution if one was
+found, to the stream of --solutions (see solutions.h).  Returns false on a
+write error. */
+static inline bool fc_solve_pats__write_solution(
+    const fcs_pats_thread *const soft_thread, const long long board_num,
+    FILE *const out)
+{
+    const_SLOT(moves_to_win, soft_thread);
+    const size_t num_moves =
+        (moves_to_win ? soft_thread->num_moves_to_win : 0);
+    fcs_pats__solution_header header;
+    memset(&header, 0, sizeof(header));
+    header.board_num = board_num;
+    header.num_moves = (uint32_t)num_moves;
+    header.status =
+        fc_solve_pats__result_code(fc_solve_pats__status_name(soft_thread));
+    for (size_t i = 0; i < num_moves; i++)
+    {
+        header.len += (fc_solve_pats__move_kind(&moves_to_win[i]) ==
+                              FCS_PATS__MOVE_TO_CARD
+                          ? 2
+                          : 1);
+    }
+    bool is_ok = (fwrite(&header, sizeof(header), 1, out) == 1);
+    for (size_t i = 0; is_ok && i < num_moves; i++)
+    {
+        uint8_t move[FCS_PATS__MAX_MOVE_LEN];
+        const size_t len = fc_solve_pats__encode_move(move,
+            fc_solve_pats__move_kind(&moves_to_win[i]),
+            FCS_PATS__CARD_CODE(moves_to_win[i].card),
+            FCS_PATS__CARD_CODE(moves_to_win[i].destcard));
+        is_ok = (fwrite(move, len, 1, out) == 1);
+    }
+    return is_ok;
+}
+
+/* The presets of -P and of the variants: the ones compiled from param.dat,
+unless main() loaded others with --params-file before configuring the soft
+threads. */
+static fcs_pats__presets fc_solve_pats__presets = {
+    .names = freecell_solver_pats__x_y_params_preset_names,
+    .params = freecell_solver_pats__x_y_params_preset,
+    .num_presets = FC_SOLVE_PATS__PARAM_PRESET__LastParam + 1,
+    .is_loaded = false};
+
+static inline void fc_solve_pats__use_preset(
+    fcs_pats_thread *const soft_thread, const int preset)
+{
+    soft_thread->pats_solve_params = fc_solve_pats__presets.params[preset];
+    fc_solve_pats__set_cut_off(soft_thread);
+}
+
+/* Use the compiled preset param_num, or the preset of the same name from
+--params-file.  If name is given, a preset of that name comes first. */
+static void set_param(fcs_pats_thread *const soft_thread, const int param_num,
+    const char *const name)
+{
+    int preset = (name ? fc_solve_pats__presets_find(
+                             &fc_solve_pats__presets, name)
+                       : -1);
+    if (preset < 0)
+    {
+        preset = fc_solve_pats__presets_find(&fc_solve_pats__presets,
+            freecell_solver_pats__x_y_params_preset_names[param_num]);
+    }
     soft_thread->pats_solve_params =
-        freecell_solver_pats__x_y_params_preset[param_num];
+        (preset >= 0 ? fc_solve_pats__presets.params[preset]
+                     : freecell_solver_pats__x_y_params_preset[param_num]);
     fc_solve_pats__set_cut_off(soft_thread);
 }
 
+/* Replace the compiled presets with the ones in the file of --params-file.
+Call it before configuring the soft threads. */
+static inline void fc_solve_pats__load_params_file(const char *const path)
+{
+    fcs_pats__presets presets;
+    const int ret = fc_solve_pats__presets_load(&presets, path);
+    if (ret < 0)
+    {
+        fatalerr("Cannot read the parameters file '%s'.", path);
+    }
+    if (ret > 0)
+    {
+        fatalerr("Line %d of the parameters file '%s' is not a preset.", ret,
+            path);
+    }
+    fc_solve_pats__presets = presets;
+}
+
+static inline void fc_solve_pats__load_preset_rules(
+    fcs_pats__preset_selector *const selector, const char *const path)
+{
+    const int ret = fc_solve_pats__preset_rules_load(
+        selector, &fc_solve_pats__presets, path);
+    if (ret < 0)
+    {
+        fatalerr("Cannot read the preset rules '%s'.", path);
+    }
+    if (ret > 0)
+    {
+        fatalerr("Line %d of the preset rules '%s' is not a rule, or names "
+                 "an unknown feature or preset.",
+            ret, path);
+    }
+}
+
+static inline void fc_solve_pats__load_move_weights(
+    double weights[FCS_PATS__NUM_MOVE_FEATURES], const char *const path)
+{
+    const int ret = fc_solve_pats__move_weights_load(weights, path);
+    if (ret < 0)
+    {
+        fatalerr("Cannot read the move weights '%s'.", path);
+    }
+    if (ret > 0)
+    {
+        fatalerr("Line %d of the move weights '%s' is not a feature and a "
+                 "weight.",
+            ret, path);
+    }
+}
+
+/* With --preset-rules, use the preset that the rules choose for the deal in
+the soft thread, or else variant_params. */
+static inline void fc_solve_pats__select_preset(
+    fcs_pats_thread *const soft_thread,
+    const fcs_pats__preset_selector *const selector,
+    const fcs_pats_xy_params *const variant_params)
+{
+    int features[FCS_PATS__NUM_FEATURES];
+    fc_solve_pats__deal_features(soft_thread, features);
+    const int preset = fc_solve_pats__preset_rules_select(selector, features);
+    if (preset >= 0)
+    {
+        fc_solve_pats__use_preset(soft_thread, preset);
+    }
+    else
+    {
+        soft_thread->pats_solve_params = *variant_params;
+        fc_solve_pats__set_cut_off(soft_thread);
+    }
+}
+
 static const int freecell_solver_user_set_sequences_are_built_by_type(
     fcs_instance *const instance, const int sequences_are_built_by)
 {
@@ -124,6 +411,9 @@ static inline void pats__init_soft_thread_and_instance(
 #endif
 }
 
+/* Print the variant that the options chose, unless quiet.  This is not part
+of fc_solve_pats__configure_soft_thread(), so that threaded-pats can print it
+once rather than once per worker. */
 static inline void fc_solve_pats__announce_variation(
     fcs_pats_thread *const soft_thread, fcs_instance *const instance,
     bool *const is_quiet)
@@ -135,20 +425,21 @@ static inline void fc_solve_pats__announce_variation(
 #if !defined(HARD_CODED_NUM_STACKS) || !defined(HARD_CODED_NUM_FREECELLS)
     const_SLOT(game_params, soft_thread->instance);
 #endif
-    printf("%s",
+    fprintf(soft_thread->out, "%s",
         (GET_INSTANCE_SEQUENCES_ARE_BUILT_BY(instance) == FCS_SEQ_BUILT_BY_SUIT)
             ? "Seahaven; "
             : "Freecell; ");
     if (INSTANCE_EMPTY_STACKS_FILL == FCS_ES_FILLED_BY_KINGS_ONLY)
     {
-        printf("%s", "only Kings are allowed to start a pile.\n");
+        fprintf(soft_thread->out, "%s",
+            "only Kings are allowed to start a pile.\n");
     }
     else
     {
-        printf("%s", "any card may start a pile.\n");
+        fprintf(soft_thread->out, "%s", "any card may start a pile.\n");
     }
-    printf("%d work piles, %d temp cells.\n", LOCAL_STACKS_NUM,
-        LOCAL_FREECELLS_NUM);
+    fprintf(soft_thread->out, "%d work piles, %d temp cells.\n",
+        LOCAL_STACKS_NUM, LOCAL_FREECELLS_NUM);
 }
 
 static inline void fc_solve_pats__configure_soft_thread__set_variant(
@@ -166,15 +457,70 @@ static inline void fc_solve_pats__configure_soft_thread__set_variant(
                 ? (to_stack ? FC_SOLVE_PATS__PARAM_PRESET__SeahavenSpeed
                             : FC_SOLVE_PATS__PARAM_PRESET__SeahavenBest)
                 : (to_stack ? FC_SOLVE_PATS__PARAM_PRESET__FreecellSpeed
-                            : FC_SOLVE_PATS__PARAM_PRESET__FreecellBest));
+                            : FC_SOLVE_PATS__PARAM_PRESET__FreecellBest),
+            NULL);
     }
-    else
+    else if (built_by_suit)
     {
         set_param(soft_thread,
-            built_by_suit
-                ? (to_stack ? FC_SOLVE_PATS__PARAM_PRESET__SeahavenKingSpeed
-                            : FC_SOLVE_PATS__PARAM_PRESET__SeahavenKing)
-                : 0);
+            (to_stack ? FC_SOLVE_PATS__PARAM_PRESET__SeahavenKingSpeed
+                      : FC_SOLVE_PATS__PARAM_PRESET__SeahavenKing),
+            NULL);
+    }
+    else
+    {
+        /* param.dat has no presets for -fk and -fkS, but --params-file may
+        have them. */
+        set_param(soft_thread, 0,
+            (to_stack ? "FreecellKingSpeed" : "FreecellKing"));
+    }
+}
+
+/* For -e: find a solution quickly with the -S settings, and use its length
+as the initial bound of the -E search.  Its moves are kept, so they are
+still reported if the -E search can't find anything shorter. */
+static inline void fc_solve_pats__seed_solution_len_bound(
+    fcs_pats_thread *const soft_thread)
+{
+    const_AUTO(initial_pos, soft_thread->current_pos);
+    const_AUTO(pats_solve_params, soft_thread->pats_solve_params);
+    const_AUTO(num_moves_to_cut_off, soft_thread->num_moves_to_cut_off);
+
+    soft_thread->to_stack = true;
+    soft_thread->dont_exit_on_sol = false;
+    fc_solve_pats__configure_soft_thread__set_variant(
+        soft_thread, soft_thread->instance);
+    fc_solve_pats__before_play(soft_thread);
+    fc_solve_pats__do_it(soft_thread);
+
+    const bool is_won = (soft_thread->status == FCS_PATS__WIN);
+    var_AUTO(moves_to_win, soft_thread->moves_to_win);
+    const_AUTO(num_moves_to_win, soft_thread->num_moves_to_win);
+    // The time limits are for the whole deal.
+    const_AUTO(wall_start_usecs, soft_thread->wall_start_usecs);
+    const_AUTO(cpu_start_usecs, soft_thread->cpu_start_usecs);
+    soft_thread->moves_to_win = NULL;
+    fc_solve_pats__recycle_soft_thread(soft_thread);
+
+    soft_thread->to_stack = false;
+    soft_thread->dont_exit_on_sol = true;
+    soft_thread->pats_solve_params = pats_solve_params;
+    soft_thread->num_moves_to_cut_off = num_moves_to_cut_off;
+    soft_thread->current_pos = initial_pos;
+    fc_solve_pats__before_play(soft_thread);
+    soft_thread->wall_start_usecs = wall_start_usecs;
+    soft_thread->cpu_start_usecs = cpu_start_usecs;
+
+    if (is_won && (int)num_moves_to_win < soft_thread->solution_len_bound)
+    {
+        soft_thread->moves_to_win = moves_to_win;
+        soft_thread->num_moves_to_win = num_moves_to_win;
+        soft_thread->solution_len_bound = (int)num_moves_to_win;
+        soft_thread->num_solutions = 1;
+    }
+    else
+    {
+        free(moves_to_win);
     }
 }
 
@@ -234,6 +580,12 @@ static inline void fc_solve_pats__configure_soft_thread__get_operating_mode(
                 curr_arg = NULL;
                 break;
 
+            case 'K':
+            case 'R':
+                // File names, which may contain mode letters.
+                curr_arg = NULL;
+                break;
+
             case 't':
                 FCS_ON_NOT_FC_ONLY(INSTANCE_FREECELLS_NUM = atoi(curr_arg));
                 curr_arg = NULL;
@@ -290,6 +642,54 @@ fc_solve_pats__configure_soft_thread__process_other_cmdline_args(
                 soft_thread->dont_exit_on_sol = true;
                 break;
 
+            case 'e':
+                soft_thread->seed_solution_len_bound = true;
+                break;
+
+            case 'm':
+                soft_thread->sequence_moves = true;
+                break;
+
+            case 'G':
+                soft_thread->use_generic_kernel = true;
+                break;
+
+            case 'D':
+                soft_thread->dead_rules = atoi(curr_arg);
+                curr_arg = NULL;
+                break;
+
+            case 'H':
+                soft_thread->max_history_len = atoi(curr_arg);
+                curr_arg = NULL;
+                break;
+
+            case 'O':
+                soft_thread->por_mode = atoi(curr_arg);
+                curr_arg = NULL;
+                break;
+
+            case 'L':
+                soft_thread->initial_solution_len_bound = atoi(curr_arg);
+                curr_arg = NULL;
+                break;
+
+            case 'K':
+                soft_thread->checkpoint_filename = curr_arg;
+                curr_arg = NULL;
+                break;
+
+            case 'R':
+                soft_thread->resume_filename = curr_arg;
+                curr_arg = NULL;
+                break;
+
+            case 'J':
+                soft_thread->checkpoint_interval_usecs =
+                    (long long)(atof(curr_arg) * 1000000);
+                curr_arg = NULL;
+                break;
+
             case 'c':
                 soft_thread->num_moves_to_cut_off = atoi(curr_arg);
                 curr_arg = NULL;
@@ -300,6 +700,24 @@ fc_solve_pats__configure_soft_thread__process_other_cmdline_args(
                 curr_arg = NULL;
                 break;
 
+            case 'I':
+                soft_thread->max_num_checked_states =
+                    strtoul(curr_arg, NULL, 10);
+                curr_arg = NULL;
+                break;
+
+            case 'T':
+                soft_thread->max_wall_usecs =
+                    (long long)(atof(curr_arg) * 1000000);
+                curr_arg = NULL;
+                break;
+
+            case 'C':
+                soft_thread->max_cpu_usecs =
+                    (long long)(atof(curr_arg) * 1000000);
+                curr_arg = NULL;
+                break;
+
             case 'v':
                 *is_quiet = false;
                 break;
@@ -329,13 +747,23 @@ fc_solve_pats__configure_soft_thread__process_other_cmdline_args(
                 curr_arg = NULL;
                 break;
 
+            case 'B':
+                soft_thread->beam_width = atoi(curr_arg);
+                curr_arg = NULL;
+                break;
+
+            case 'W':
+                soft_thread->max_beam_width = atoi(curr_arg);
+                curr_arg = NULL;
+                break;
+
             case 'P': {
                 const_AUTO(i, atoi(curr_arg));
-                if (i < 0 || i > FC_SOLVE_PATS__PARAM_PRESET__LastParam)
+                if (i < 0 || i >= fc_solve_pats__presets.num_presets)
                 {
                     fatalerr("invalid parameter code");
                 }
-                set_param(soft_thread, i);
+                fc_solve_pats__use_preset(soft_thread, i);
                 curr_arg = NULL;
             }
             break;
@@ -378,6 +806,54 @@ static inline void fc_solve_pats__configure_soft_thread(
     {
         fatalerr("-S and -E may not be used together.");
     }
+    if (soft_thread->seed_solution_len_bound && !soft_thread->dont_exit_on_sol)
+    {
+        fatalerr("-e only makes sense with -E.");
+    }
+    if (soft_thread->initial_solution_len_bound <= 0)
+    {
+        soft_thread->initial_solution_len_bound = INT_MAX;
+    }
+    soft_thread->report_dead_moves = (soft_thread->dead_rules >= 0);
+    if (soft_thread->dead_rules < 0)
+    {
+        // The other rules cost more time than they save.
+        soft_thread->dead_rules = FCS_PATS__DEAD_SEAHAVEN_RUNS;
+    }
+    if (soft_thread->max_history_len > FCS_PATS__MAX_HISTORY_LEN)
+    {
+        soft_thread->max_history_len = FCS_PATS__MAX_HISTORY_LEN;
+    }
+    if (soft_thread->max_num_checked_states == 0)
+    {
+        soft_thread->max_num_checked_states = ULONG_MAX;
+    }
+    if (soft_thread->max_wall_usecs < 0 || soft_thread->max_cpu_usecs < 0)
+    {
+        fatalerr("-T and -C must not be negative.");
+    }
+    if (soft_thread->beam_width < 0)
+    {
+        fatalerr("-B must not be negative.");
+    }
+    if (soft_thread->max_beam_width < soft_thread->beam_width)
+    {
+        soft_thread->max_beam_width = soft_thread->beam_width;
+    }
+    if (soft_thread->por_mode < FCS_PATS__POR_OFF ||
+        soft_thread->por_mode > FCS_PATS__POR_VERIFY)
+    {
+        fatalerr("-O must be 0, 1 or 2.");
+    }
+    if (soft_thread->checkpoint_interval_usecs < 0)
+    {
+        fatalerr("-J must not be negative.");
+    }
+    if ((soft_thread->checkpoint_filename || soft_thread->resume_filename) &&
+        soft_thread->max_beam_width > soft_thread->beam_width)
+    {
+        fatalerr("-K and -R may not be used with -W.");
+    }
     if (soft_thread->remaining_memory < (FC_SOLVE__PATS__BLOCKSIZE * 2))
     {
         fatalerr("-M too small.");
@@ -404,6 +880,4 @@ static inline void fc_solve_pats__configure_soft_thread(
         instance->game_variant_desired_suit_value = 0;
     }
 #endif
-
-    fc_solve_pats__announce_variation(soft_thread, instance, is_quiet);
 }
@@ -134,11 +134,240 @@ static inline void unpack_position(
         }
     }
 #endif
+    fc_solve_pats__index_cards(soft_thread);
+}
+
+/* The queue of a position, from the priority of the move that got us
+there.  In addition to the priority of a move, a position gets an
+additional priority depending on the number of cards out.  We use a
+"queue squashing function" to map num_cards_out to priority.  */
+static inline int queue_priority(fcs_pats_thread *const soft_thread, int pri)
+{
+    const int num_cards_out =
+        fcs_foundation_value(soft_thread->current_pos.s, 0) +
+        fcs_foundation_value(soft_thread->current_pos.s, 1) +
+        fcs_foundation_value(soft_thread->current_pos.s, 2) +
+        fcs_foundation_value(soft_thread->current_pos.s, 3);
+
+    /* y_param[0] * nout^2 + y_param[1] * nout + y_param[2] */
+    const_PTR(y_param, soft_thread->pats_solve_params.y);
+    const double x =
+        (y_param[0] * num_cards_out + y_param[1]) * num_cards_out + y_param[2];
+    /*
+     * GCC gives a warning with some flags if we cast the result
+     * of floor to an int directly. As a result, we need to use
+     * an intermediate variable.
+     * */
+    const double rounded_x = (floor(x + .5));
+    pri += (int)rounded_x;
+
+    if (pri < 0)
+    {
+        return 0;
+    }
+    if (pri >= FC_SOLVE_PATS__NUM_QUEUES)
+    {
+        return FC_SOLVE_PATS__NUM_QUEUES - 1;
+    }
+    return pri;
+}
+
+/* Beam search layers.  An item is worse than another if it has a lower
+priority, or the same priority and it would be dequeued later. */
+static inline bool beam_is_worse(fcs_pats_thread *const soft_thread,
+    const fcs_pats__beam_item *const a, const fcs_pats__beam_item *const b)
+{
+    if (a->pri != b->pri)
+    {
+        return (a->pri < b->pri);
+    }
+    return (soft_thread->to_stack ? (a->seq < b->seq) : (a->seq > b->seq));
+}
+
+static inline void beam_sift_down(fcs_pats_thread *const soft_thread,
+    fcs_pats__beam_item *const items, const int count, int i)
+{
+    while (true)
+    {
+        int worst = i;
+        const int left = 2 * i + 1, right = left + 1;
+        if (left < count &&
+            beam_is_worse(soft_thread, &items[left], &items[worst]))
+        {
+            worst = left;
+        }
+        if (right < count &&
+            beam_is_worse(soft_thread, &items[right], &items[worst]))
+        {
+            worst = right;
+        }
+        if (worst == i)
+        {
+            return;
+        }
+        const_AUTO(temp, items[i]);
+        items[i] = items[worst];
+        items[worst] = temp;
+        i = worst;
+    }
+}
+
+static inline fcs_pats_position *beam_dequeue_position(
+    fcs_pats_thread *const soft_thread)
+{
+    /* Positions are only ever queued deeper than the position being
+    expanded, so once we start on a layer it is frozen.  Heapsort it in
+    place, which leaves the best position first. */
+    while (soft_thread->beam_depth < soft_thread->num_beam_layers)
+    {
+        var_AUTO(layer, &soft_thread->beam_layers[soft_thread->beam_depth]);
+        if (!layer->is_sorted)
+        {
+            for (int n = layer->count - 1; n > 0; n--)
+            {
+                const_AUTO(temp, layer->items[0]);
+                layer->items[0] = layer->items[n];
+                layer->items[n] = temp;
+                beam_sift_down(soft_thread, layer->items, n, 0);
+            }
+            layer->is_sorted = true;
+        }
+        if (layer->next < layer->count)
+        {
+            fcs_pats_position *const pos = layer->items[layer->next++].pos;
+            unpack_position(soft_thread, pos);
+#ifdef DEBUG
+            --soft_thread->num_positions_in_clusters[pos->cluster];
+#endif
+            return pos;
+        }
+        if (layer->items)
+        {
+            fc_solve_pats__free_array(soft_thread, layer->items,
+                fcs_pats__beam_item, (size_t)layer->capacity);
+            layer->items = NULL;
+        }
+        layer->capacity = layer->count = layer->next = 0;
+        layer->is_sorted = false;
+        ++soft_thread->beam_depth;
+    }
+
+    return NULL;
+}
+
+static inline bool beam_queue_position(
+    fcs_pats_thread *const soft_thread, fcs_pats_position *const pos, int pri)
+{
+    const int depth = pos->depth;
+    if (depth >= soft_thread->num_beam_layers)
+    {
+        const int new_num = depth + FCS_PATS__SOLVE_LEVEL_GROW_BY;
+        fcs_pats__beam_layer *const new_layers =
+            SREALLOC(soft_thread->beam_layers, new_num);
+        if (!new_layers)
+        {
+            fc_solve_pats__fail(soft_thread, FCS_PATS__FAIL_OUT_OF_MEMORY);
+            return false;
+        }
+        memset(new_layers + soft_thread->num_beam_layers, 0,
+            sizeof(new_layers[0]) *
+                (size_t)(new_num - soft_thread->num_beam_layers));
+        soft_thread->beam_layers = new_layers;
+        soft_thread->num_beam_layers = new_num;
+    }
+    var_AUTO(layer, &soft_thread->beam_layers[depth]);
+    if (layer->count == layer->capacity &&
+        layer->capacity < soft_thread->beam_width)
+    {
+        // Most layers never fill up, so grow them as needed.
+        const int new_capacity = min(soft_thread->beam_width,
+            max(FCS_PATS__BEAM_LAYER_GROW_BY, layer->capacity * 2));
+        fcs_pats__beam_item *const new_items = fc_solve_pats__new_array(
+            soft_thread, fcs_pats__beam_item, (size_t)new_capacity);
+        if (!new_items)
+        {
+            return false;
+        }
+        if (layer->items)
+        {
+            memcpy(new_items, layer->items,
+                sizeof(new_items[0]) * (size_t)layer->count);
+            fc_solve_pats__free_array(soft_thread, layer->items,
+                fcs_pats__beam_item, (size_t)layer->capacity);
+        }
+        layer->items = new_items;
+        layer->capacity = new_capacity;
+    }
+
+    const fcs_pats__beam_item item = {
+        .pos = pos, .seq = soft_thread->beam_seq++, .pri = pri};
+    if (layer->count < layer->capacity)
+    {
+        // Sift up.
+        int i = layer->count++;
+        while (i > 0)
+        {
+            const int up = (i - 1) / 2;
+            if (!beam_is_worse(soft_thread, &item, &layer->items[up]))
+            {
+                break;
+            }
+            layer->items[i] = layer->items[up];
+            i = up;
+        }
+        layer->items[i] = item;
+    }
+    else
+    {
+        /* The layer is full.  Either the new position or the worst one
+        in the layer has to go. */
+        ++soft_thread->num_beam_discarded;
+        if (!beam_is_worse(soft_thread, &layer->items[0], &item))
+        {
+            return false;
+        }
+        fcs_pats_position *const evicted = layer->items[0].pos;
+        layer->items[0] = item;
+        beam_sift_down(soft_thread, layer->items, layer->count, 0);
+#ifdef DEBUG
+        --soft_thread->num_positions_in_clusters[evicted->cluster];
+#endif
+        free_position_recursive(soft_thread, evicted);
+    }
+#ifdef DEBUG
+    ++soft_thread->num_positions_in_clusters[pos->cluster];
+#endif
+    return true;
+}
+
+/* Whether beam_queue_position() would keep a position of this depth, that
+the move of priority pri got us to.  The ones that it would not keep need
+not be stored at all. */
+static inline bool beam_admits(
+    fcs_pats_thread *const soft_thread, const int depth, const int pri)
+{
+    if (depth >= soft_thread->num_beam_layers)
+    {
+        return true;
+    }
+    const_AUTO(layer, &soft_thread->beam_layers[depth]);
+    if (layer->count < soft_thread->beam_width)
+    {
+        return true;
+    }
+    const fcs_pats__beam_item item = {.pos = NULL,
+        .seq = soft_thread->beam_seq,
+        .pri = queue_priority(soft_thread, pri)};
+    return beam_is_worse(soft_thread, &layer->items[0], &item);
 }
 
 static inline fcs_pats_position *dequeue_position(
     fcs_pats_thread *const soft_thread)
 {
+    if (soft_thread->beam_width)
+    {
+        return beam_dequeue_position(soft_thread);
+    }
     /* This is a kind of prioritized round robin.  We make sweeps
     through the queues, starting at the highest priority and
     working downwards; each time through the sweeps get longer.
@@ -203,9 +432,19 @@ fcs_pats_position *fc_solve_pats__new_position(
     int cluster;
     unsigned char *p;
 
+    /* If we ran out of memory or pile numbers, the piles may not have
+    valid ids, so don't try to store the position. */
+    if (soft_thread->status == FCS_PATS__FAIL)
+    {
+        return NULL;
+    }
+
     /* Search the list of stored positions.  If this position is found,
     then ignore it and return (unless this position is better). */
-    const int depth = (parent ? (parent->depth + 1) : 0);
+    const int depth =
+        (parent ? (parent->depth +
+                      fc_solve_pats__move_len(soft_thread, m, parent))
+                : 0);
 
     fcs_pats__tree *node;
     const fcs_pats__insert_code verdict =
@@ -264,12 +503,79 @@ fcs_pats_position *fc_solve_pats__new_position(
     return pos;
 }
 
-// Hash the whole layout.  This is called once, at the start.
+/* Check the per-deal limits.  Reading the clocks is much more expensive
+than the rest of an iteration, so we only do it every so often.  Once a
+limit is exceeded, it stays exceeded. */
 static inline bool check_for_exceeded(fcs_pats_thread *const soft_thread)
 {
-    return ((soft_thread->status == FCS_PATS__NOSOL) &&
-            (soft_thread->num_checked_states >=
-                soft_thread->max_num_checked_states));
+    if (soft_thread->status != FCS_PATS__NOSOL)
+    {
+        return false;
+    }
+    if (soft_thread->is_limit_exceeded)
+    {
+        return true;
+    }
+    // Not sticky, so the search can go on once the flag is cleared.
+    if (soft_thread->interrupt_requested && *soft_thread->interrupt_requested)
+    {
+        soft_thread->fail_reason = FCS_PATS__FAIL_INTERRUPTED;
+        return true;
+    }
+    if (soft_thread->num_checked_states >=
+        soft_thread->step_end_checked_states)
+    {
+        return (soft_thread->is_step_done = true);
+    }
+    if (soft_thread->num_checked_states >=
+        soft_thread->max_num_checked_states)
+    {
+        soft_thread->fail_reason = FCS_PATS__FAIL_CHECKED_STATES;
+        return (soft_thread->is_limit_exceeded = true);
+    }
+    if (--soft_thread->clock_check_countdown > 0)
+    {
+        return false;
+    }
+    soft_thread->clock_check_countdown = FCS_PATS__CLOCK_CHECK_INTERVAL;
+    const long long wall_usecs =
+        ((soft_thread->step_end_usecs || soft_thread->max_wall_usecs)
+                ? fc_solve_pats__wall_usecs()
+                : 0);
+    // A step checks at least one position, so that it makes progress.
+    if (soft_thread->step_end_usecs &&
+        soft_thread->num_checked_states >
+            soft_thread->step_start_checked_states &&
+        wall_usecs >= soft_thread->step_end_usecs)
+    {
+        return (soft_thread->is_step_done = true);
+    }
+    if (soft_thread->max_wall_usecs &&
+        wall_usecs - soft_thread->wall_start_usecs >=
+            soft_thread->max_wall_usecs)
+    {
+        soft_thread->fail_reason = FCS_PATS__FAIL_WALL_TIME;
+        return (soft_thread->is_limit_exceeded = true);
+    }
+    if (soft_thread->max_cpu_usecs &&
+        fc_solve_pats__cpu_usecs() - soft_thread->cpu_start_usecs >=
+            soft_thread->max_cpu_usecs)
+    {
+        soft_thread->fail_reason = FCS_PATS__FAIL_CPU_TIME;
+        return (soft_thread->is_limit_exceeded = true);
+    }
+    return false;
+}
+
+/* Branch and bound: a position can only lead to a shorter solution than
+the best one so far if its depth plus a lower bound on the number of moves
+left is below the bound. */
+static inline bool exceeds_solution_len_bound(
+    fcs_pats_thread *const soft_thread, const int depth)
+{
+    return ((soft_thread->solution_len_bound != INT_MAX) &&
+            (depth + fc_solve_pats__min_moves_to_win(soft_thread) >=
+                soft_thread->solution_len_bound));
 }
 
 /* Generate all the successors to a position and either queue them or
@@ -282,6 +588,26 @@ static inline void wrap_up_solve(
     soft_thread->curr_solve_dir = mydir;
 }
 
+// Move the top num_cards cards of pile from onto pile to, keeping their order.
+static inline void move_sequence(fcs_pats_thread *const soft_thread,
+    const int from, const int to, const int num_cards)
+{
+    var_AUTO(from_col, fcs_state_get_col(soft_thread->current_pos.s, from));
+    var_AUTO(to_col, fcs_state_get_col(soft_thread->current_pos.s, to));
+    const int from_len = fcs_col_len(from_col) - num_cards;
+    int to_len = fcs_col_len(to_col);
+    for (int i = 0; i < num_cards; i++)
+    {
+        const fcs_card card = fcs_col_get_card(from_col, from_len + i);
+        fc_solve_pats__set_card_loc(soft_thread, card, to, to_len);
+        fcs_col_get_card(to_col, to_len++) = card;
+    }
+    fcs_col_len(from_col) = (fcs_card)from_len;
+    fcs_col_len(to_col) = (fcs_card)to_len;
+    fc_solve_pats__hashpile(soft_thread, from);
+    fc_solve_pats__hashpile(soft_thread, to);
+}
+
 static inline void freecell_solver_pats__make_move(
     fcs_pats_thread *const soft_thread, const fcs_pats__move *const m)
 {
@@ -289,6 +615,12 @@ static inline void freecell_solver_pats__make_move(
     const_SLOT(from, m);
     const_SLOT(to, m);
 
+    if (m->num_cards > 1)
+    {
+        move_sequence(soft_thread, from, to, m->num_cards);
+        return;
+    }
+
 #if MAX_NUM_FREECELLS > 0
     // Remove from pile.
     if (m->fromtype == FCS_PATS__TYPE_FREECELL)
@@ -312,13 +644,19 @@ static inline void freecell_solver_pats__make_move(
 #if MAX_NUM_FREECELLS > 0
         fcs_freecell_card(soft_thread->current_pos.s, to) = card;
 #endif
+        fc_solve_pats__set_card_loc(
+            soft_thread, card, FCS_PATS__NOT_IN_COLUMN, 0);
         break;
     case FCS_PATS__TYPE_WASTE:
+        fc_solve_pats__set_card_loc(soft_thread, card, to,
+            fcs_col_len(fcs_state_get_col(soft_thread->current_pos.s, to)));
         fcs_state_push(&soft_thread->current_pos.s, to, card);
         fc_solve_pats__hashpile(soft_thread, to);
         break;
     default:
         fcs_increment_foundation(soft_thread->current_pos.s, to);
+        fc_solve_pats__set_card_loc(
+            soft_thread, card, FCS_PATS__NOT_IN_COLUMN, 0);
         break;
     }
 }
@@ -328,6 +666,11 @@ static inline void fc_solve_pats__undo_move(
 {
     const_SLOT(from, m);
     const_SLOT(to, m);
+    if (m->num_cards > 1)
+    {
+        move_sequence(soft_thread, to, from, m->num_cards);
+        return;
+    }
     // Remove from 'to' pile.
     fcs_card card;
     switch (m->totype)
@@ -354,10 +697,14 @@ static inline void fc_solve_pats__undo_move(
     if (m->fromtype == FCS_PATS__TYPE_FREECELL)
     {
         fcs_freecell_card(soft_thread->current_pos.s, from) = card;
+        fc_solve_pats__set_card_loc(
+            soft_thread, card, FCS_PATS__NOT_IN_COLUMN, 0);
     }
     else
 #endif
     {
+        fc_solve_pats__set_card_loc(soft_thread, card, from,
+            fcs_col_len(fcs_state_get_col(soft_thread->current_pos.s, from)));
         fcs_state_push(&soft_thread->current_pos.s, from, card);
         fc_solve_pats__hashpile(soft_thread, from);
     }
@@ -398,6 +745,15 @@ static inline int solve(
         int num_moves;
         if (!LEVEL.moves_start)
         {
+            /* The bound may have dropped since this position was queued. */
+            if (exceeds_solution_len_bound(soft_thread, parent->depth))
+            {
+                LEVEL.q = false;
+                --DEPTH;
+                mydir = FC_SOLVE_PATS__DOWN;
+                continue;
+            }
+            fc_solve_pats__update_history(soft_thread);
             LEVEL.moves_start =
                 fc_solve_pats__get_moves(soft_thread, parent, &num_moves);
             if (!LEVEL.moves_start)
@@ -437,6 +793,12 @@ static inline int solve(
             fc_solve_pats__free_array(soft_thread, LEVEL.moves_start,
                 fcs_pats__move, (size_t)num_moves);
             LEVEL.moves_start = NULL;
+            /* The beam may have evicted the children that were queued, so
+            keep the position only if some are left. */
+            if (soft_thread->beam_width)
+            {
+                LEVEL.q = (parent->num_childs != 0);
+            }
             --DEPTH;
             mydir = FC_SOLVE_PATS__DOWN;
             continue;
@@ -445,6 +807,48 @@ static inline int solve(
         {
             freecell_solver_pats__make_move(soft_thread, LEVEL.move_ptr);
 
+            // Don't even store positions that can't improve on the bound.
+            if (exceeds_solution_len_bound(soft_thread,
+                    parent->depth + fc_solve_pats__move_len(
+                                        soft_thread, LEVEL.move_ptr, parent)))
+            {
+                parent->num_childs--;
+                fc_solve_pats__undo_move(soft_thread, LEVEL.move_ptr);
+                LEVEL.move_ptr++;
+                mydir = FC_SOLVE_PATS__UP;
+                continue;
+            }
+
+            // Nor positions that can't be won (-D).
+            if ((soft_thread->dead_rules &
+                    (FCS_PATS__DEAD_CYCLES | FCS_PATS__DEAD_BURIED)) &&
+                fc_solve_pats__is_dead_position(soft_thread))
+            {
+                parent->num_childs--;
+                fc_solve_pats__undo_move(soft_thread, LEVEL.move_ptr);
+                LEVEL.move_ptr++;
+                mydir = FC_SOLVE_PATS__UP;
+                continue;
+            }
+
+            /* Nor positions that would be queued, only for the beam to
+            discard them. */
+            if (soft_thread->beam_width &&
+                LEVEL.move_ptr->totype != FCS_PATS__TYPE_FOUNDATION &&
+                num_moves >= soft_thread->num_moves_to_cut_off &&
+                !beam_admits(soft_thread,
+                    parent->depth + fc_solve_pats__move_len(
+                                        soft_thread, LEVEL.move_ptr, parent),
+                    LEVEL.move_ptr->pri))
+            {
+                ++soft_thread->num_beam_discarded;
+                parent->num_childs--;
+                fc_solve_pats__undo_move(soft_thread, LEVEL.move_ptr);
+                LEVEL.move_ptr++;
+                mydir = FC_SOLVE_PATS__UP;
+                continue;
+            }
+
             // Calculate indices for the new piles.
             fc_solve_pats__sort_piles(soft_thread);
 
@@ -484,10 +888,17 @@ static inline int solve(
                 }
                 else
                 {
-                    fc_solve_pats__queue_position(
-                        soft_thread, LEVEL.pos, (LEVEL.move_ptr)->pri);
+                    if (fc_solve_pats__queue_position(
+                            soft_thread, LEVEL.pos, (LEVEL.move_ptr)->pri))
+                    {
+                        LEVEL.q = true;
+                    }
+                    else
+                    {
+                        // Discarded by the beam.
+                        free_position_non_recursive(soft_thread, LEVEL.pos);
+                    }
                     fc_solve_pats__undo_move(soft_thread, LEVEL.move_ptr);
-                    LEVEL.q = true;
                     LEVEL.move_ptr++;
                     mydir = FC_SOLVE_PATS__UP;
                 }
@@ -504,6 +915,14 @@ static inline int solve(
 
 DLLEXPORT void fc_solve_pats__do_it(fcs_pats_thread *const soft_thread)
 {
+#ifndef FCS_PATS__KERNEL
+    const_AUTO(kernel, fc_solve_pats__find_kernel(soft_thread));
+    if (kernel)
+    {
+        kernel->do_it(soft_thread);
+        return;
+    }
+#endif
     while (1)
     {
         if (!soft_thread->curr_solve_pos)
@@ -531,50 +950,68 @@ DLLEXPORT void fc_solve_pats__do_it(fcs_pats_thread *const soft_thread)
 
         if (check_for_exceeded(soft_thread))
         {
+            if (soft_thread->is_step_done)
+            {
+                soft_thread->is_step_done = false;
+                soft_thread->status = FCS_PATS__SUSPENDED;
+                break;
+            }
+            // check_for_exceeded() already recorded the fail reason.
             soft_thread->status = FCS_PATS__FAIL;
-#ifdef FCS_PATSOLVE__WITH_FAIL_REASON
-            soft_thread->fail_reason = FCS_PATS__FAIL_CHECKED_STATES;
-#endif
             break;
         }
     }
+    /* In -E mode, running out of positions means that the last solution
+    found is the shortest one. */
+    if (soft_thread->status == FCS_PATS__NOSOL && soft_thread->num_solutions)
+    {
+        soft_thread->status = FCS_PATS__WIN;
+    }
+}
+
+/* Like fc_solve_pats__do_it(), but return FCS_PATS__SUSPENDED once
+max_checked_states more positions were checked, or max_usecs microseconds
+of wall time have passed (0 means no limit for either).  The search can be
+continued by calling this (or fc_solve_pats__do_it()) again, so a single
+thread can take turns between several soft threads. */
+DLLEXPORT fc_solve_pats__status_code fc_solve_pats__do_it_bounded(
+    fcs_pats_thread *const soft_thread, const unsigned long max_checked_states,
+    const long long max_usecs)
+{
+    if (soft_thread->status == FCS_PATS__SUSPENDED)
+    {
+        soft_thread->status = FCS_PATS__NOSOL;
+    }
+    soft_thread->is_step_done = false;
+    const_AUTO(num_checked_states, soft_thread->num_checked_states);
+    soft_thread->step_start_checked_states = num_checked_states;
+    soft_thread->step_end_checked_states =
+        ((max_checked_states && max_checked_states < ULONG_MAX -
+                                                         num_checked_states)
+                ? (num_checked_states + max_checked_states)
+                : ULONG_MAX);
+    soft_thread->step_end_usecs =
+        (max_usecs > 0 ? (fc_solve_pats__wall_usecs() + max_usecs) : 0);
+
+    fc_solve_pats__do_it(soft_thread);
+
+    soft_thread->step_end_checked_states = ULONG_MAX;
+    soft_thread->step_end_usecs = 0;
+    return soft_thread->status;
 }
 
 /* Save positions for consideration later.  pri is the priority of the move
 that got us here.  The work queue is kept sorted by priority (simply by
-having separate queues). */
+having separate queues).  Returns false if the position was not queued
+(in beam mode), in which case the caller has to free it. */
 
-void fc_solve_pats__queue_position(
+bool fc_solve_pats__queue_position(
     fcs_pats_thread *const soft_thread, fcs_pats_position *const pos, int pri)
 {
-    /* In addition to the priority of a move, a position gets an
-    additional priority depending on the number of cards out.  We use a
-    "queue squashing function" to map num_cards_out to priority.  */
-    const int num_cards_out =
-        fcs_foundation_value(soft_thread->current_pos.s, 0) +
-        fcs_foundation_value(soft_thread->current_pos.s, 1) +
-        fcs_foundation_value(soft_thread->current_pos.s, 2) +
-        fcs_foundation_value(soft_thread->current_pos.s, 3);
-
-    /* y_param[0] * nout^2 + y_param[1] * nout + y_param[2] */
-    const_PTR(y_param, soft_thread->pats_solve_params.y);
-    const double x =
-        (y_param[0] * num_cards_out + y_param[1]) * num_cards_out + y_param[2];
-    /*
-     * GCC gives a warning with some flags if we cast the result
-     * of floor to an int directly. As a result, we need to use
-     * an intermediate variable.
-     * */
-    const double rounded_x = (floor(x + .5));
-    pri += (int)rounded_x;
-
-    if (pri < 0)
-    {
-        pri = 0;
-    }
-    else if (pri >= FC_SOLVE_PATS__NUM_QUEUES)
+    pri = queue_priority(soft_thread, pri);
+    if (soft_thread->beam_width)
     {
-        pri = FC_SOLVE_PATS__NUM_QUEUES - 1;
+        return beam_queue_position(soft_thread, pos, pri);
     }
     if (pri > soft_thread->max_queue_idx)
     {
@@ -608,4 +1045,5 @@ void fc_solve_pats__queue_position(
     ++soft_thread->num_positions_in_queue[pri];
     ++soft_thread->num_positions_in_clusters[pos->cluster];
 #endif
+    return true;
 }
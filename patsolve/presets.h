@@ -0,0 +1,327 @@
+// This file is part of patsolve. It is subject to the license terms in
+// the LICENSE file found in the top-level directory of this distribution
+// and at https://github.com/shlomif/patsolve/blob/master/LICENSE . No
+// part of patsolve, including this file, may be copied, modified, propagated,
+// or distributed except according to the terms contained in the COPYING file.
+//
+// presets.h : the parameter presets of -P, which may be read at run time
+// from a file in the format of param.dat (--params-file), and the rules that
+// choose a preset for each deal from its features (--preset-rules).
+//
+// A rules file is a list of rules, of which the first one that matches the
+// deal wins, and an optional default:
+//
+//     if buried_aces >= 14 then FreecellBest
+//     if disorder < 20 then FreecellBestA
+//     default FreecellSpeed
+//
+// With no default, a deal that no rule matches keeps the parameters of the
+// variant.  select_presets.py learns the rules from results databases.
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pat.h"
+#include "param.h"
+
+typedef struct
+{
+    const char *const *names;
+    const fcs_pats_xy_params *params;
+    int num_presets;
+    // Whether names and params were allocated by fc_solve_pats__presets_load.
+    bool is_loaded;
+} fcs_pats__presets;
+
+static inline int fc_solve_pats__presets_find(
+    const fcs_pats__presets *const presets, const char *const name)
+{
+    for (int i = 0; i < presets->num_presets; i++)
+    {
+        if (!strcmp(presets->names[i], name))
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static inline void fc_solve_pats__presets_free(
+    fcs_pats__presets *const presets)
+{
+    if (!presets->is_loaded)
+    {
+        return;
+    }
+    for (int i = 0; i < presets->num_presets; i++)
+    {
+        free((char *)presets->names[i]);
+    }
+    free((void *)presets->names);
+    free((void *)presets->params);
+}
+
+/* Read the presets from a file in the format of param.dat: a name, the
+FC_SOLVE_PATS__NUM_X_PARAM -X parameters and the FC_SOLVE_PATS__NUM_Y_PARAM
+-Y ones on each line, and comments that start with '#'.  Returns 0, or the
+number of the first bad line, or -1 if the file cannot be read. */
+static inline int fc_solve_pats__presets_load(
+    fcs_pats__presets *const presets, const char *const path)
+{
+    FILE *const fh = fopen(path, "r");
+    if (!fh)
+    {
+        return -1;
+    }
+    char **names = NULL;
+    fcs_pats_xy_params *params = NULL;
+    int num_presets = 0, line_num = 0, ret = 0;
+    char line[1024];
+    while (!ret && fgets(line, sizeof(line), fh))
+    {
+        ++line_num;
+        char name[256];
+        int pos;
+        if (line[0] == '#' || sscanf(line, " %255s%n", name, &pos) != 1)
+        {
+            continue;
+        }
+        fcs_pats_xy_params p;
+        for (int i = 0; !ret && i < FC_SOLVE_PATS__NUM_X_PARAM; i++)
+        {
+            int len;
+            ret = (sscanf(line + pos, "%d%n", &p.x[i], &len) == 1 ? 0
+                                                                   : line_num);
+            pos += len;
+        }
+        for (int i = 0; !ret && i < FC_SOLVE_PATS__NUM_Y_PARAM; i++)
+        {
+            int len;
+            ret = (sscanf(line + pos, "%lf%n", &p.y[i], &len) == 1 ? 0
+                                                                    : line_num);
+            pos += len;
+        }
+        if (ret)
+        {
+            break;
+        }
+        char **const new_names =
+            realloc(names, sizeof(*names) * (size_t)(num_presets + 1));
+        fcs_pats_xy_params *const new_params =
+            realloc(params, sizeof(*params) * (size_t)(num_presets + 1));
+        if (new_names)
+        {
+            names = new_names;
+        }
+        if (new_params)
+        {
+            params = new_params;
+        }
+        if (!new_names || !new_params ||
+            !(names[num_presets] = strdup(name)))
+        {
+            ret = line_num;
+            break;
+        }
+        params[num_presets++] = p;
+    }
+    fclose(fh);
+    if (!ret && num_presets == 0)
+    {
+        ret = line_num + 1;
+    }
+    *presets = (fcs_pats__presets){.names = (const char *const *)names,
+        .params = params,
+        .num_presets = num_presets,
+        .is_loaded = true};
+    if (ret)
+    {
+        fc_solve_pats__presets_free(presets);
+        presets->num_presets = 0;
+    }
+    return ret;
+}
+
+// The features of a deal, which the rules of --preset-rules test.
+typedef enum
+{
+    // The number of cards above the Aces.
+    FCS_PATS__FEATURE_BURIED_ACES,
+    // The number of cards that lie above a lower card of their suit.
+    FCS_PATS__FEATURE_DISORDER,
+    // The number of cards that lie on a card they may be moved onto.
+    FCS_PATS__FEATURE_IN_SEQUENCE,
+    // The number of Kings that are not at the bottom of their pile.
+    FCS_PATS__FEATURE_BURIED_KINGS,
+    FCS_PATS__NUM_FEATURES
+} fcs_pats__feature;
+
+static const char *const fc_solve_pats__feature_names[FCS_PATS__NUM_FEATURES] =
+    {"buried_aces", "disorder", "in_sequence", "buried_kings"};
+
+// Compute the features of the position of the soft thread.
+static inline void fc_solve_pats__deal_features(
+    fcs_pats_thread *const soft_thread, int features[FCS_PATS__NUM_FEATURES])
+{
+    DECLARE_STACKS();
+#ifndef FCS_FREECELL_ONLY
+    const fcs_instance *const instance = soft_thread->instance;
+    const fcs_card game_variant_suit_mask = FCS_PATS__SUIT_MASK(instance);
+    const fcs_card game_variant_desired_suit_value =
+        FCS_PATS__DESIRED_SUIT_VALUE(instance);
+#endif
+    memset(features, 0, sizeof(int) * FCS_PATS__NUM_FEATURES);
+    for (int w = 0; w < LOCAL_STACKS_NUM; w++)
+    {
+        const_AUTO(col, fcs_state_get_col(soft_thread->current_pos.s, w));
+        const int col_len = fcs_col_len(col);
+        int lowest[FCS_NUM_SUITS] = {FCS_PATS__KING + 1, FCS_PATS__KING + 1,
+            FCS_PATS__KING + 1, FCS_PATS__KING + 1};
+        for (int d = 0; d < col_len; d++)
+        {
+            const fcs_card card = fcs_col_get_card(col, d);
+            const int rank = fcs_card_rank(card);
+            const int suit = fcs_card_suit(card);
+            if (rank == 1)
+            {
+                features[FCS_PATS__FEATURE_BURIED_ACES] += col_len - 1 - d;
+            }
+            if (rank == FCS_PATS__KING && d > 0)
+            {
+                features[FCS_PATS__FEATURE_BURIED_KINGS]++;
+            }
+            if (rank > lowest[suit])
+            {
+                features[FCS_PATS__FEATURE_DISORDER]++;
+            }
+            lowest[suit] = min(lowest[suit], rank);
+            if (d > 0)
+            {
+                const fcs_card below = fcs_col_get_card(col, d - 1);
+                if (fcs_card_rank(below) == rank + 1 &&
+                    fcs_pats_is_suitable(card, below
+#ifndef FCS_FREECELL_ONLY
+                        ,
+                        game_variant_suit_mask, game_variant_desired_suit_value
+#endif
+                        ))
+                {
+                    features[FCS_PATS__FEATURE_IN_SEQUENCE]++;
+                }
+            }
+        }
+    }
+}
+
+typedef struct
+{
+    fcs_pats__feature feature;
+    // Match when the feature is below the threshold, or else when it is not.
+    bool is_below;
+    int threshold;
+    int preset;
+} fcs_pats__preset_rule;
+
+typedef struct
+{
+    fcs_pats__preset_rule *rules;
+    int num_rules;
+    // The preset when no rule matches, or -1 for the variant's parameters.
+    int default_preset;
+} fcs_pats__preset_selector;
+
+/* Read the rules of a selector, with the preset names of presets.  Returns
+0, or the number of the first bad line, or -1 if the file cannot be read. */
+static inline int fc_solve_pats__preset_rules_load(
+    fcs_pats__preset_selector *const selector,
+    const fcs_pats__presets *const presets, const char *const path)
+{
+    *selector = (fcs_pats__preset_selector){
+        .rules = NULL, .num_rules = 0, .default_preset = -1};
+    FILE *const fh = fopen(path, "r");
+    if (!fh)
+    {
+        return -1;
+    }
+    int line_num = 0, ret = 0;
+    char line[1024];
+    while (!ret && fgets(line, sizeof(line), fh))
+    {
+        ++line_num;
+        char feature[64], op[3], name[256];
+        int threshold;
+        if (line[0] == '#' || sscanf(line, " %1s", op) != 1)
+        {
+            continue;
+        }
+        if (sscanf(line, " default %255s", name) == 1)
+        {
+            selector->default_preset =
+                fc_solve_pats__presets_find(presets, name);
+            ret = (selector->default_preset < 0 ? line_num : 0);
+            continue;
+        }
+        fcs_pats__preset_rule rule = {.feature = FCS_PATS__NUM_FEATURES};
+        if (sscanf(line, " if %63s %2s %d then %255s", feature, op,
+                &threshold, name) != 4 ||
+            (strcmp(op, "<") && strcmp(op, ">=")))
+        {
+            ret = line_num;
+            break;
+        }
+        for (int i = 0; i < FCS_PATS__NUM_FEATURES; i++)
+        {
+            if (!strcmp(feature, fc_solve_pats__feature_names[i]))
+            {
+                rule.feature = (fcs_pats__feature)i;
+            }
+        }
+        rule.is_below = !strcmp(op, "<");
+        rule.threshold = threshold;
+        rule.preset = fc_solve_pats__presets_find(presets, name);
+        if (rule.feature == FCS_PATS__NUM_FEATURES || rule.preset < 0)
+        {
+            ret = line_num;
+            break;
+        }
+        // On failure, selector->rules is still the rules read so far.
+        fcs_pats__preset_rule *const rules = realloc(selector->rules,
+            sizeof(*rules) * (size_t)(selector->num_rules + 1));
+        if (!rules)
+        {
+            ret = line_num;
+            break;
+        }
+        selector->rules = rules;
+        selector->rules[selector->num_rules++] = rule;
+    }
+    fclose(fh);
+    return ret;
+}
+
+/* The preset of the first rule that matches the features, or the default
+one (-1 for the variant's parameters). */
+static inline int fc_solve_pats__preset_rules_select(
+    const fcs_pats__preset_selector *const selector,
+    const int features[FCS_PATS__NUM_FEATURES])
+{
+    for (int i = 0; i < selector->num_rules; i++)
+    {
+        const fcs_pats__preset_rule *const rule = &selector->rules[i];
+        if ((features[rule->feature] < rule->threshold) == rule->is_below)
+        {
+            return rule->preset;
+        }
+    }
+    return selector->default_preset;
+}
+
+static inline void fc_solve_pats__preset_rules_free(
+    fcs_pats__preset_selector *const selector)
+{
+    free(selector->rules);
+    selector->rules = NULL;
+    selector->num_rules = 0;
+}
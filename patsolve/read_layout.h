@@ -7,8 +7,72 @@
 // Copyright (c) 2002 Tom Holroyd
 #pragma once
 #include "pat.h"
+#include "msdeal.h"
 
-static inline void fc_solve_pats__read_layout(
+// Count the card in, unless it is not a card or was already seen.
+static inline bool fc_solve_pats__see_card(
+    bool *const seen, int *const num_cards, const fcs_card card)
+{
+    if (fcs_card_rank(card) < 1 || fcs_card_rank(card) > FCS_PATS__KING ||
+        seen[card])
+    {
+        return false;
+    }
+    seen[card] = true;
+    ++*num_cards;
+    return true;
+}
+
+/* Whether the position holds each of the 52 cards exactly once, in the
+piles, the free cells or the foundations. */
+static inline bool fc_solve_pats__is_full_deck(
+    fcs_pats_thread *const soft_thread, const fcs_state *const s)
+{
+#if !defined(HARD_CODED_NUM_STACKS)
+    const_SLOT(game_params, soft_thread->instance);
+#endif
+    bool seen[FCS_PATS__NUM_CARD_LOCS] = {false};
+    int num_cards = 0;
+    for (int suit = 0; suit < FCS_NUM_SUITS; suit++)
+    {
+        for (int r = 1; r <= fcs_foundation_value(*s, suit); r++)
+        {
+            if (!fc_solve_pats__see_card(
+                    seen, &num_cards, fcs_make_card(r, suit)))
+            {
+                return false;
+            }
+        }
+    }
+#if MAX_NUM_FREECELLS > 0
+    for (int t = 0; t < LOCAL_FREECELLS_NUM; t++)
+    {
+        if (!fcs_freecell_is_empty(*s, t) &&
+            !fc_solve_pats__see_card(
+                seen, &num_cards, fcs_freecell_card(*s, t)))
+        {
+            return false;
+        }
+    }
+#endif
+    for (int w = 0; w < LOCAL_STACKS_NUM; w++)
+    {
+        const_AUTO(col, fcs_state_get_col(*s, w));
+        for (int i = 0; i < fcs_col_len(col); i++)
+        {
+            if (!fc_solve_pats__see_card(
+                    seen, &num_cards, fcs_col_get_card(col, i)))
+            {
+                return false;
+            }
+        }
+    }
+    return (num_cards == FCS_NUM_SUITS * FCS_PATS__KING);
+}
+
+/* Read the layout into the position, and return whether it is a layout of
+the 52 cards. */
+static inline bool fc_solve_pats__read_layout(
     fcs_pats_thread *const soft_thread, const char *const input_s)
 {
 #if !defined(HARD_CODED_NUM_STACKS)
@@ -16,7 +80,48 @@ static inline void fc_solve_pats__read_layout(
 #endif
 
     fcs_state_keyval_pair kv;
-    fc_solve_initial_user_state_to_c(input_s, &kv, LOCAL_FREECELLS_NUM,
-        LOCAL_STACKS_NUM, 1, soft_thread->current_pos.indirect_stacks_buffer);
+    const bool is_read = fc_solve_initial_user_state_to_c(input_s, &kv,
+        LOCAL_FREECELLS_NUM, LOCAL_STACKS_NUM, 1,
+        soft_thread->current_pos.indirect_stacks_buffer);
     soft_thread->current_pos.s = kv.s;
+    return is_read && fc_solve_pats__is_full_deck(soft_thread, &kv.s);
+}
+
+/* Put the 52 cards of a deal, in the order that
+fc_solve_pats__msdeal_shuffle() deals them, straight into the position.
+The position is the same as fc_solve_pats__read_layout() of the deal that
+get_board_l__without_setup() (and pats-msdeal) prints: eight piles, of which
+the ones past the number of work piles are left out. */
+static inline void fc_solve_pats__read_dealt_cards(
+    fcs_pats_thread *const soft_thread,
+    const uint8_t cards[FCS_PATS__MSDEAL_NUM_CARDS])
+{
+#if !defined(HARD_CODED_NUM_STACKS)
+    const_SLOT(game_params, soft_thread->instance);
+#endif
+    // The suits of the deal are "CDHS", and those of fcs_card are "HCDS".
+    static const int fcs_suits[FCS_NUM_SUITS] = {1, 2, 0, 3};
+
+    // The positions of patsolve are compact states, so zero is empty.
+    fcs_state *const s = &soft_thread->current_pos.s;
+    memset(s, 0, sizeof(*s));
+    for (int i = 0; i < FCS_PATS__MSDEAL_NUM_CARDS; i++)
+    {
+        if (i % 8 < LOCAL_STACKS_NUM)
+        {
+            fcs_state_push(s, i % 8,
+                fcs_make_card(cards[i] / 4 + 1, fcs_suits[cards[i] % 4]));
+        }
+    }
+}
+
+/* Deal Microsoft Freecell / FreeCell Pro deal number deal_num straight into
+the position, without writing it out as text and reading it back. */
+static inline void fc_solve_pats__read_deal(
+    fcs_pats_thread *const soft_thread, const long long deal_num)
+{
+    uint8_t cards[FCS_PATS__MSDEAL_NUM_CARDS];
+    fc_solve_pats__msdeal_shuffle((unsigned long long)deal_num,
+        FCS_PATS__MSDEAL_NUM_CARDS, cards);
+    fc_solve_pats__read_dealt_cards(soft_thread, cards);
 }
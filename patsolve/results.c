@@ -0,0 +1,183 @@
+// This file is part of patsolve. It is subject to the license terms in
+// the LICENSE file found in the top-level directory of this distribution
+// and at https://github.com/shlomif/patsolve/blob/master/LICENSE . No
+// part of patsolve, including this file, may be copied, modified, propagated,
+// or distributed except according to the terms contained in the COPYING file.
+//
+// pats-results : query a results database that patsolve or threaded-pats
+// wrote with --results-db (see results_db.h).
+#include <stdlib.h>
+
+#include "pats__print_msg.h"
+#include "results_db.h"
+
+static const char Usage[] =
+    "usage: %s [--list|--missing] <file> [<start> [<end>]]\n"
+    "Report on the results of the deals from <start> (default 1) up to but\n"
+    "not including <end> (default: the end of <file>).\n"
+    "By default, count the deals of each status, and sum their numbers.\n"
+    "--list print the result of each deal, as\n"
+    "    #<n> - <status> <moves> <checked> <stored> <usecs>\n"
+    "--missing print the ranges of deals without a result, as\n"
+    "    <start> <end> (end excluded), to give to PATSOLVE_START/END\n";
+
+typedef enum
+{
+    SUMMARY,
+    LIST,
+    MISSING,
+} query_mode;
+
+static fcs_pats__results_db db;
+// The deals from here on are past the end of the file, so they are missing.
+static long long db_end_board_num;
+
+static const fcs_pats__result_record *get_record(const long long board_num)
+{
+    static const fcs_pats__result_record missing_record;
+    return (board_num < db_end_board_num)
+               ? fc_solve_pats__results_db_record(&db, board_num)
+               : &missing_record;
+}
+
+static void print_summary(
+    const long long start_board_num, const long long end_board_num)
+{
+    long long counts[FCS_PATS__NUM_RESULT_NAMES + 1] = {0};
+    unsigned long long num_won_moves = 0, num_checked_states = 0, usecs = 0;
+    for (long long board_num = start_board_num; board_num < end_board_num;
+        ++board_num)
+    {
+        const fcs_pats__result_record *const record = get_record(board_num);
+        if (record->status > FCS_PATS__NUM_RESULT_NAMES)
+        {
+            fatalerr("Deal %lld has an unknown status.", board_num);
+        }
+        ++counts[record->status];
+        if (record->status == 0)
+        {
+            continue;
+        }
+        if (record->status == 1)
+        {
+            num_won_moves += record->num_moves;
+        }
+        num_checked_states += record->num_checked_states;
+        usecs += record->usecs;
+    }
+    printf("Missing: %lld\n", counts[0]);
+    for (int i = 0; i < FCS_PATS__NUM_RESULT_NAMES; ++i)
+    {
+        if (counts[i + 1])
+        {
+            printf(
+                "%s: %lld\n", fc_solve_pats__result_names[i], counts[i + 1]);
+        }
+    }
+    if (counts[1])
+    {
+        printf("Average solution length: %.2f\n",
+            (double)num_won_moves / (double)counts[1]);
+    }
+    printf("Checked positions: %llu\n", num_checked_states);
+    printf("Time: %.3f seconds\n", (double)usecs / 1e6);
+}
+
+int main(int argc, char **argv)
+{
+    program_name = argv[0];
+    if (argc > 1 && ((!strcmp(argv[1], "-h")) || (!strcmp(argv[1], "--help"))))
+    {
+        USAGE();
+        exit(0);
+    }
+    query_mode mode = SUMMARY;
+    int arg_idx = 1;
+    if (arg_idx < argc && !strcmp(argv[arg_idx], "--list"))
+    {
+        mode = LIST;
+        ++arg_idx;
+    }
+    else if (arg_idx < argc && !strcmp(argv[arg_idx], "--missing"))
+    {
+        mode = MISSING;
+        ++arg_idx;
+    }
+    if (arg_idx >= argc || argc - arg_idx > 3 || argv[arg_idx][0] == '-')
+    {
+        USAGE();
+        exit(1);
+    }
+    const char *const path = argv[arg_idx];
+    struct stat st;
+    if (stat(path, &st) != 0)
+    {
+        fatalerr("Cannot open the results database '%s'.", path);
+    }
+    const long long start_board_num =
+        (arg_idx + 1 < argc) ? atoll(argv[arg_idx + 1]) : 1;
+    db_end_board_num =
+        (long long)((st.st_size - fc_solve_pats__result_offset(0)) /
+                    (off_t)sizeof(fcs_pats__result_record));
+    const long long end_board_num =
+        (arg_idx + 2 < argc) ? atoll(argv[arg_idx + 2]) : db_end_board_num;
+    if (start_board_num < 0)
+    {
+        fatalerr("The deal numbers start at 0.");
+    }
+    // Only map the records that are in the file.
+    if (db_end_board_num < start_board_num)
+    {
+        db_end_board_num = start_board_num;
+    }
+    if (db_end_board_num > end_board_num)
+    {
+        db_end_board_num =
+            (end_board_num > start_board_num ? end_board_num : start_board_num);
+    }
+    if (!fc_solve_pats__results_db_open(
+            &db, path, start_board_num, db_end_board_num, false))
+    {
+        fatalerr("'%s' is not a results database.", path);
+    }
+
+    if (mode == SUMMARY)
+    {
+        print_summary(start_board_num, end_board_num);
+    }
+    long long missing_start = -1;
+    for (long long board_num = start_board_num;
+        mode != SUMMARY && board_num < end_board_num; ++board_num)
+    {
+        const fcs_pats__result_record *const record = get_record(board_num);
+        if (mode == MISSING)
+        {
+            if (record->status == 0 && missing_start < 0)
+            {
+                missing_start = board_num;
+            }
+            else if (record->status != 0 && missing_start >= 0)
+            {
+                printf("%lld %lld\n", missing_start, board_num);
+                missing_start = -1;
+            }
+        }
+        else if (record->status != 0 &&
+                 record->status <= FCS_PATS__NUM_RESULT_NAMES)
+        {
+            printf("#%lld - %s %lu %llu %llu %llu\n", board_num,
+                fc_solve_pats__result_names[record->status - 1],
+                (unsigned long)record->num_moves,
+                (unsigned long long)record->num_checked_states,
+                (unsigned long long)record->num_states_in_collection,
+                (unsigned long long)record->usecs);
+        }
+    }
+    if (missing_start >= 0)
+    {
+        printf("%lld %lld\n", missing_start, end_board_num);
+    }
+    fc_solve_pats__results_db_close(&db);
+
+    return 0;
+}
@@ -0,0 +1,182 @@
+// This file is part of patsolve. It is subject to the license terms in
+// the LICENSE file found in the top-level directory of this distribution
+// and at https://github.com/shlomif/patsolve/blob/master/LICENSE . No
+// part of patsolve, including this file, may be copied, modified, propagated,
+// or distributed except according to the terms contained in the COPYING file.
+//
+// results_db.h : the results database of range runs (--results-db).  It is a
+// header and then one fixed-size record per board number, so the record of
+// board <n> is at a known offset.  The file is sparse: the runs only grow it
+// and write the records of their own boards, through a shared memory map, so
+// several runs can fill in different parts of one file at the same time.
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define FCS_PATS__RESULTS_DB_MAGIC "PATSRDB1"
+
+typedef struct
+{
+    char magic[8];
+    uint32_t header_size, record_size;
+    char reserved[48];
+} fcs_pats__results_db_header;
+
+typedef struct
+{
+    // 0 for a board without a result, or 1 + an index into the names below.
+    uint8_t status;
+    uint8_t reserved[3];
+    uint32_t num_moves;
+    uint64_t num_checked_states;
+    uint64_t num_states_in_collection;
+    uint64_t usecs;
+} fcs_pats__result_record;
+
+// The names of fc_solve_pats__status_name(), in the order of their codes.
+static const char *const fc_solve_pats__result_names[] = {"Won", "Impossible",
+    "Iterations", "WallTime", "CPUTime", "PileIds", "Interrupted", "OutOfMem",
+    "Suspended"};
+
+#define FCS_PATS__NUM_RESULT_NAMES                                             \
+    ((int)(sizeof(fc_solve_pats__result_names) /                               \
+           sizeof(fc_solve_pats__result_names[0])))
+
+static inline uint8_t fc_solve_pats__result_code(const char *const name)
+{
+    for (int i = 0; i < FCS_PATS__NUM_RESULT_NAMES; ++i)
+    {
+        if (!strcmp(name, fc_solve_pats__result_names[i]))
+        {
+            return (uint8_t)(i + 1);
+        }
+    }
+    return 0;
+}
+
+typedef struct
+{
+    int fd;
+    // The map starts at the page of the record of the first board opened.
+    void *map;
+    size_t map_len;
+    off_t map_offset;
+} fcs_pats__results_db;
+
+static inline off_t fc_solve_pats__result_offset(const long long board_num)
+{
+    return (off_t)sizeof(fcs_pats__results_db_header) +
+           (off_t)board_num * (off_t)sizeof(fcs_pats__result_record);
+}
+
+/* Open (or create) the database at the path, with room for the boards from
+start_board_num to end_board_num (excluded), and map their records.
+Returns false if it cannot, or if the file is not a results database. */
+static inline bool fc_solve_pats__results_db_open(
+    fcs_pats__results_db *const db, const char *const path,
+    const long long start_board_num, const long long end_board_num,
+    const bool is_writable)
+{
+    if (start_board_num < 0 || end_board_num < start_board_num)
+    {
+        return false;
+    }
+    db->fd = open(path, (is_writable ? (O_RDWR | O_CREAT) : O_RDONLY), 0666);
+    if (db->fd < 0)
+    {
+        return false;
+    }
+    // Check the header, and grow the file, one run at a time.
+    flock(db->fd, (is_writable ? LOCK_EX : LOCK_SH));
+    fcs_pats__results_db_header header;
+    struct stat st;
+    bool is_ok = (fstat(db->fd, &st) == 0);
+    if (is_ok && st.st_size == 0 && is_writable)
+    {
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, FCS_PATS__RESULTS_DB_MAGIC, sizeof(header.magic));
+        header.header_size = sizeof(header);
+        header.record_size = sizeof(fcs_pats__result_record);
+        is_ok = (pwrite(db->fd, &header, sizeof(header), 0) ==
+                 (ssize_t)sizeof(header));
+    }
+    is_ok = is_ok &&
+            (pread(db->fd, &header, sizeof(header), 0) ==
+                (ssize_t)sizeof(header)) &&
+            !memcmp(header.magic, FCS_PATS__RESULTS_DB_MAGIC,
+                sizeof(header.magic)) &&
+            header.header_size == sizeof(header) &&
+            header.record_size == sizeof(fcs_pats__result_record);
+    const off_t end_offset = fc_solve_pats__result_offset(end_board_num);
+    const bool is_empty = (end_board_num == start_board_num);
+    if (is_ok && !is_empty && fstat(db->fd, &st) == 0 &&
+        st.st_size < end_offset)
+    {
+        is_ok = is_writable && (ftruncate(db->fd, end_offset) == 0);
+    }
+    flock(db->fd, LOCK_UN);
+
+    const off_t page_size = (off_t)sysconf(_SC_PAGESIZE);
+    db->map_offset = fc_solve_pats__result_offset(start_board_num);
+    db->map_offset -= db->map_offset % page_size;
+    db->map_len = (size_t)(end_offset - db->map_offset);
+    db->map = NULL;
+    if (is_ok && !is_empty)
+    {
+        db->map = mmap(NULL, db->map_len,
+            (is_writable ? (PROT_READ | PROT_WRITE) : PROT_READ), MAP_SHARED,
+            db->fd, db->map_offset);
+        is_ok = (db->map != MAP_FAILED);
+    }
+    if (!is_ok)
+    {
+        close(db->fd);
+        return false;
+    }
+    return true;
+}
+
+// The record of a board in the range that the database was opened with.
+static inline fcs_pats__result_record *fc_solve_pats__results_db_record(
+    const fcs_pats__results_db *const db, const long long board_num)
+{
+    return (fcs_pats__result_record *)((char *)db->map +
+                                       (fc_solve_pats__result_offset(
+                                            board_num) -
+                                           db->map_offset));
+}
+
+/* Fill in the record of a board.  The status goes in last, so a reader never
+takes a half-written record for a result. */
+static inline void fc_solve_pats__results_db_set(
+    const fcs_pats__results_db *const db, const long long board_num,
+    const char *const status_name, const unsigned long num_moves,
+    const unsigned long num_checked_states,
+    const unsigned long num_states_in_collection, const long long usecs)
+{
+    fcs_pats__result_record *const record =
+        fc_solve_pats__results_db_record(db, board_num);
+    record->num_moves = (uint32_t)num_moves;
+    record->num_checked_states = num_checked_states;
+    record->num_states_in_collection = num_states_in_collection;
+    record->usecs = (uint64_t)usecs;
+    __atomic_store_n(&record->status, fc_solve_pats__result_code(status_name),
+        __ATOMIC_RELEASE);
+}
+
+static inline void fc_solve_pats__results_db_close(
+    fcs_pats__results_db *const db)
+{
+    if (db->map && db->map != MAP_FAILED)
+    {
+        munmap(db->map, db->map_len);
+    }
+    close(db->fd);
+}
@@ -0,0 +1,162 @@
+#! /usr/bin/env python3
+
+"""Learn the rules of --preset-rules from benchmark runs.
+
+Usage: select_presets.py [--cost=checked|usecs] [--max-rules=<n>]
+    [--min-deals=<n>] <features> <Preset>=<results.db> ...
+
+<features> is the output of "patsolve --features" over the deals, and each
+<results.db> is a --results-db of the same deals solved with <Preset> of
+param.dat (say, with -P<n>, or with the -X and -Y of the preset).  The cost of
+a deal is the positions that it checked, or its wall time with
+--cost=usecs, and double that if it was not won.
+
+The rules are a decision list: each one sends the deals that it matches, of
+those that no earlier rule matched, to a preset, and the default takes the
+rest.  They are grown greedily while a rule saves at least 1% of the total
+cost, and matches at least --min-deals deals (by default, 2% of them), so
+that they do not fit the noise of a small sample.  The rules go to stdout,
+and the cost of the deals with each preset alone and with the rules goes to
+stderr.
+"""
+
+import struct
+import sys
+
+# See results_db.h.
+HEADER = struct.Struct('<II')
+RECORD = struct.Struct('<B3xIQQQ')
+WON = 1
+
+
+def read_features(path):
+    with open(path) as fh:
+        lines = [line.split() for line in fh]
+    # Skip the variant that patsolve prints before the header.
+    start = next(i for i, words in enumerate(lines) if words[:1] == ['deal'])
+    names = lines[start][1:]
+    features = {}
+    for words in lines[start + 1:]:
+        if words:
+            features[int(words[0])] = [int(x) for x in words[1:]]
+    return names, features
+
+
+def read_costs(path, cost_field):
+    with open(path, 'rb') as fh:
+        data = fh.read()
+    if data[:8] != b'PATSRDB1':
+        sys.exit("'%s' is not a results database." % path)
+    header_size, record_size = HEADER.unpack_from(data, 8)
+    costs = {}
+    for board_num, offset in enumerate(
+            range(header_size, len(data) - record_size + 1, record_size)):
+        status, _, checked, _, usecs = RECORD.unpack_from(data, offset)
+        if status:
+            cost = (checked if cost_field == 'checked' else usecs)
+            costs[board_num] = cost * (1 if status == WON else 2)
+    return costs
+
+
+def best_preset(deals, costs, num_presets):
+    totals = [sum(costs[d][p] for d in deals) for p in range(num_presets)]
+    p = min(range(num_presets), key=lambda p: totals[p])
+    return p, totals[p]
+
+
+def best_rule(deals, features, costs, num_presets, min_deals):
+    """The rule that, with the best default for the deals that it does not
+    match, costs the least, and that cost."""
+    best = None
+    for f in range(len(features[deals[0]])):
+        ordered = sorted(deals, key=lambda d: features[d][f])
+        # below[i][p] is the cost of ordered[:i] with preset p.
+        below = [[0] * num_presets]
+        for d in ordered:
+            below.append([s + c for s, c in zip(below[-1], costs[d])])
+        total = below[-1]
+        for i in range(1, len(ordered)):
+            threshold = features[ordered[i]][f]
+            if threshold == features[ordered[i - 1]][f]:
+                continue
+            above = [t - b for t, b in zip(total, below[i])]
+            for is_below, matched, rest, n in (
+                    (True, below[i], above, i),
+                    (False, above, below[i], len(ordered) - i)):
+                if n < min_deals or len(ordered) - n < min_deals:
+                    continue
+                p = min(range(num_presets), key=lambda p: matched[p])
+                cost = matched[p] + min(rest)
+                if best is None or cost < best[0]:
+                    best = (cost, f, is_below, threshold, p)
+    return best
+
+
+def main(argv):
+    cost_field = 'checked'
+    max_rules = 8
+    min_deals = None
+    args = []
+    for arg in argv[1:]:
+        if arg.startswith('--cost='):
+            cost_field = arg[7:]
+            if cost_field not in ('checked', 'usecs'):
+                sys.exit('--cost is checked or usecs.')
+        elif arg.startswith('--max-rules='):
+            max_rules = int(arg[12:])
+        elif arg.startswith('--min-deals='):
+            min_deals = int(arg[12:])
+        else:
+            args.append(arg)
+    if len(args) < 3:
+        sys.exit(__doc__)
+
+    feature_names, features = read_features(args[0])
+    presets = []
+    preset_costs = []
+    for arg in args[1:]:
+        name, _, path = arg.partition('=')
+        presets.append(name)
+        preset_costs.append(read_costs(path, cost_field))
+    deals = sorted(d for d in features
+                   if all(d in c for c in preset_costs))
+    if not deals:
+        sys.exit('No deal has features and results for every preset.')
+    costs = {d: [c[d] for c in preset_costs] for d in deals}
+    if min_deals is None:
+        min_deals = max(1, len(deals) // 50)
+
+    rules = []
+    remaining = deals
+    # The cost of the deals that the rules so far match, and of all of them.
+    matched_cost = 0
+    default, cost = best_preset(remaining, costs, len(presets))
+    for _ in range(max_rules):
+        rule = best_rule(remaining, features, costs, len(presets),
+                         min_deals)
+        if rule is None or matched_cost + rule[0] > cost - 0.01 * cost:
+            break
+        _, f, is_below, threshold, p = rule
+        rules.append((f, is_below, threshold, p))
+        matched_cost += sum(costs[d][p] for d in remaining
+                            if (features[d][f] < threshold) == is_below)
+        remaining = [d for d in remaining
+                     if (features[d][f] < threshold) != is_below]
+        default, rest_cost = best_preset(remaining, costs, len(presets))
+        cost = matched_cost + rest_cost
+
+    for f, is_below, threshold, p in rules:
+        print('if %s %s %d then %s' % (feature_names[f],
+                                       '<' if is_below else '>=',
+                                       threshold, presets[p]))
+    print('default %s' % presets[default])
+
+    for p, name in enumerate(presets):
+        sys.stderr.write('%s: %.1f per deal\n' % (
+            name, sum(costs[d][p] for d in deals) / len(deals)))
+    sys.stderr.write('The rules: %.1f per deal, over %d deals\n' % (
+        cost / len(deals), len(deals)))
+
+
+if __name__ == '__main__':
+    main(sys.argv)
@@ -0,0 +1,146 @@
+// This file is part of patsolve. It is subject to the license terms in
+// the LICENSE file found in the top-level directory of this distribution
+// and at https://github.com/shlomif/patsolve/blob/master/LICENSE . No
+// part of patsolve, including this file, may be copied, modified, propagated,
+// or distributed except according to the terms contained in the COPYING file.
+//
+// pats-solutions : print the solutions that patsolve or threaded-pats wrote
+// with --solutions (see solutions.h).
+#include "pats__print_msg.h"
+#include "solutions.h"
+
+static const char Usage[] =
+    "usage: %s <file> [<deal>...]\n"
+    "Print the deals of <file> (\"-\" is stdin), with their status and the\n"
+    "moves of their solutions.  Given deals, print only the moves of the\n"
+    "solution of each one (the same as patsolve writes to 'win'), which\n"
+    "are found with <file>.idx.\n";
+
+static uint8_t *moves;
+static size_t moves_size;
+
+/* Read the record at the current position of the stream.  Returns false at
+the end of the stream. */
+static bool read_record(
+    FILE *const in, fcs_pats__solution_header *const header)
+{
+    if (fread(header, sizeof(*header), 1, in) != 1)
+    {
+        return false;
+    }
+    if (header->len > moves_size)
+    {
+        moves_size = header->len;
+        if (!(moves = realloc(moves, moves_size)))
+        {
+            fatalerr("Out of memory for the moves.");
+        }
+    }
+    if (fread(moves, 1, header->len, in) != header->len)
+    {
+        fatalerr("The solutions end in the middle of deal %lld.",
+            (long long)header->board_num);
+    }
+    return true;
+}
+
+static void print_moves(const fcs_pats__solution_header *const header)
+{
+    for (size_t pos = 0; pos < header->len;)
+    {
+        const size_t len =
+            fc_solve_pats__render_move(moves + pos, header->len - pos, stdout);
+        if (!len)
+        {
+            fatalerr("Deal %lld has a bad move.", (long long)header->board_num);
+        }
+        pos += len;
+    }
+}
+
+static const char *status_name(const fcs_pats__solution_header *const header)
+{
+    const int status = header->status;
+    return ((status >= 1 && status <= FCS_PATS__NUM_RESULT_NAMES)
+                ? fc_solve_pats__result_names[status - 1]
+                : "Unknown");
+}
+
+static FILE *open_stream(const char *const path, const char *const magic)
+{
+    FILE *const in = (strcmp(path, "-") ? fopen(path, "rb") : stdin);
+    char file_magic[8];
+    if (!in || fread(file_magic, sizeof(file_magic), 1, in) != 1 ||
+        memcmp(file_magic, magic, sizeof(file_magic)))
+    {
+        fatalerr("'%s' is not a stream of solutions, or its index.", path);
+    }
+    return in;
+}
+
+// Print the solution of a deal, found with the index.
+static void print_deal(FILE *const in, FILE *const index_fh,
+    const char *const path, const long long board_num)
+{
+    fseeko(index_fh, 8, SEEK_SET);
+    fcs_pats__solution_index_entry entry;
+    do
+    {
+        if (fread(&entry, sizeof(entry), 1, index_fh) != 1)
+        {
+            fatalerr("Deal %lld is not in '%s'.", board_num, path);
+        }
+    } while (entry.board_num != board_num);
+
+    fcs_pats__solution_header header;
+    if (fseeko(in, (off_t)entry.offset, SEEK_SET) != 0 ||
+        !read_record(in, &header) || header.board_num != board_num)
+    {
+        fatalerr("The index of '%s' does not match it.", path);
+    }
+    if (!header.num_moves)
+    {
+        fatalerr("Deal %lld has no solution (%s).", board_num,
+            status_name(&header));
+    }
+    print_moves(&header);
+}
+
+int main(int argc, char **argv)
+{
+    program_name = argv[0];
+    if (argc < 2 || !strcmp(argv[1], "-h") || !strcmp(argv[1], "--help"))
+    {
+        USAGE();
+        exit(argc < 2);
+    }
+    const char *const path = argv[1];
+    FILE *const in = open_stream(path, FCS_PATS__SOLUTIONS_MAGIC);
+    if (argc == 2)
+    {
+        fcs_pats__solution_header header;
+        while (read_record(in, &header))
+        {
+            printf("#%lld - %s\n", (long long)header.board_num,
+                status_name(&header));
+            print_moves(&header);
+        }
+    }
+    else
+    {
+        const size_t path_len = strlen(path);
+        char index_path[path_len + 5];
+        memcpy(index_path, path, path_len);
+        strcpy(index_path + path_len, ".idx");
+        FILE *const index_fh =
+            open_stream(index_path, FCS_PATS__SOLUTIONS_INDEX_MAGIC);
+        for (int arg_idx = 2; arg_idx < argc; ++arg_idx)
+        {
+            print_deal(in, index_fh, path, atoll(argv[arg_idx]));
+        }
+        fclose(index_fh);
+    }
+    free(moves);
+
+    return 0;
+}
@@ -0,0 +1,187 @@
+// This file is part of patsolve. It is subject to the license terms in
+// the LICENSE file found in the top-level directory of this distribution
+// and at https://github.com/shlomif/patsolve/blob/master/LICENSE . No
+// part of patsolve, including this file, may be copied, modified, propagated,
+// or distributed except according to the terms contained in the COPYING file.
+//
+// solutions.h : the binary solutions of range runs (--solutions), which
+// pats-solutions renders as text.
+//
+// A move is one byte: the kind of move in the top two bits, and the card in
+// the other six (rank * 4 + suit, with the suits in the order "HCDS").  A
+// move onto a card is followed by a second byte, with that card.
+//
+// The stream is FCS_PATS__SOLUTIONS_MAGIC and then a record for each deal: a
+// fcs_pats__solution_header and the moves of the solution (if one was
+// found).  The index, <file>.idx, is FCS_PATS__SOLUTIONS_INDEX_MAGIC and
+// then a fcs_pats__solution_index_entry for each record, in the same order.
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "results_db.h"
+
+#define FCS_PATS__SOLUTIONS_MAGIC "PATSSOL1"
+#define FCS_PATS__SOLUTIONS_INDEX_MAGIC "PATSSIX1"
+#define FCS_PATS__MAX_MOVE_LEN 2
+
+typedef enum
+{
+    FCS_PATS__MOVE_TO_FREECELL,
+    FCS_PATS__MOVE_TO_FOUNDATION,
+    FCS_PATS__MOVE_TO_EMPTY_PILE,
+    FCS_PATS__MOVE_TO_CARD,
+} fcs_pats__move_kind;
+
+typedef struct
+{
+    int64_t board_num;
+    // The length of the moves, in bytes.
+    uint32_t len;
+    uint32_t num_moves;
+    // The code of the status, as in fcs_pats__result_record.
+    uint8_t status;
+    uint8_t reserved[7];
+} fcs_pats__solution_header;
+
+typedef struct
+{
+    int64_t board_num;
+    uint64_t offset;
+} fcs_pats__solution_index_entry;
+
+// Encode a move, and return its length.  A card is rank * 4 + suit.
+static inline size_t fc_solve_pats__encode_move(uint8_t *const out,
+    const fcs_pats__move_kind kind, const int card, const int dest_card)
+{
+    out[0] = (uint8_t)((kind << 6) | card);
+    if (kind != FCS_PATS__MOVE_TO_CARD)
+    {
+        return 1;
+    }
+    out[1] = (uint8_t)dest_card;
+    return 2;
+}
+
+static inline void fc_solve_pats__render_card(const int card, FILE *const out)
+{
+    fprintf(out, "%c%c", " A23456789TJQK"[(card >> 2) % 14], "HCDS"[card & 3]);
+}
+
+/* Print the move at the start of the buffer, the same as the lines of the
+win file, and return its length, or 0 if it is not a move. */
+static inline size_t fc_solve_pats__render_move(
+    const uint8_t *const in, const size_t len, FILE *const out)
+{
+    if (len < 1 || (in[0] >> 6 == FCS_PATS__MOVE_TO_CARD && len < 2))
+    {
+        return 0;
+    }
+    fc_solve_pats__render_card(in[0] & 0x3f, out);
+    switch (in[0] >> 6)
+    {
+    case FCS_PATS__MOVE_TO_FREECELL:
+        fprintf(out, " to temp\n");
+        return 1;
+    case FCS_PATS__MOVE_TO_FOUNDATION:
+        fprintf(out, " out\n");
+        return 1;
+    case FCS_PATS__MOVE_TO_EMPTY_PILE:
+        fprintf(out, " to empty pile\n");
+        return 1;
+    default:
+        fprintf(out, " to ");
+        fc_solve_pats__render_card(in[1], out);
+        fputc('\n', out);
+        return 2;
+    }
+}
+
+typedef struct
+{
+    FILE *fh;
+    // NULL when the stream is stdout, which is not indexed.
+    FILE *index_fh;
+} fcs_pats__solutions_stream;
+
+/* Start the stream at the path (and its index), or on stdout for "-".
+Returns false if it cannot. */
+static inline bool fc_solve_pats__solutions_open(
+    fcs_pats__solutions_stream *const stream, const char *const path)
+{
+    stream->index_fh = NULL;
+    if (!strcmp(path, "-"))
+    {
+        stream->fh = stdout;
+    }
+    else
+    {
+        stream->fh = fopen(path, "wb");
+        const size_t path_len = strlen(path);
+        char index_path[path_len + 5];
+        memcpy(index_path, path, path_len);
+        strcpy(index_path + path_len, ".idx");
+        stream->index_fh = fopen(index_path, "wb");
+        if (!stream->fh || !stream->index_fh ||
+            !fwrite(FCS_PATS__SOLUTIONS_INDEX_MAGIC, 8, 1, stream->index_fh))
+        {
+            return false;
+        }
+    }
+    return (fwrite(FCS_PATS__SOLUTIONS_MAGIC, 8, 1, stream->fh) == 1);
+}
+
+/* Index the record of the board, which is about to be written at the
+current end of the stream. */
+static inline bool fc_solve_pats__solutions_index(
+    fcs_pats__solutions_stream *const stream, const long long board_num,
+    const off_t offset_from_end)
+{
+    if (!stream->index_fh)
+    {
+        return true;
+    }
+    const fcs_pats__solution_index_entry entry = {
+        .board_num = board_num,
+        .offset = (uint64_t)(ftello(stream->fh) + offset_from_end)};
+    return (fwrite(&entry, sizeof(entry), 1, stream->index_fh) == 1);
+}
+
+/* Append records that were written to a buffer, and index each one.
+Returns false on a write error. */
+static inline bool fc_solve_pats__solutions_append(
+    fcs_pats__solutions_stream *const stream, const uint8_t *const records,
+    const size_t len)
+{
+    for (size_t pos = 0; pos + sizeof(fcs_pats__solution_header) <= len;)
+    {
+        fcs_pats__solution_header header;
+        memcpy(&header, records + pos, sizeof(header));
+        if (!fc_solve_pats__solutions_index(
+                stream, header.board_num, (off_t)pos))
+        {
+            return false;
+        }
+        pos += sizeof(header) + header.len;
+    }
+    return (fwrite(records, 1, len, stream->fh) == len);
+}
+
+static inline bool fc_solve_pats__solutions_close(
+    fcs_pats__solutions_stream *const stream)
+{
+    bool is_ok = (fflush(stream->fh) == 0);
+    if (stream->fh != stdout)
+    {
+        is_ok = (fclose(stream->fh) == 0) && is_ok;
+    }
+    if (stream->index_fh)
+    {
+        is_ok = (fclose(stream->index_fh) == 0) && is_ok;
+    }
+    return is_ok;
+}
@@ -3,13 +3,15 @@
 use strict;
 use warnings;
 
-use Test::More tests => 20;
+use Test::More tests => 78;
 
 use Test::Trap
     qw( trap $trap :flow:stderr(systemsafe):stdout(systemsafe):warn );
 
 use Path::Tiny qw/ path /;
 use Socket     qw(:crlf);
+use IO::Select       ();
+use IO::Socket::UNIX ();
 
 sub _normalize_lf
 {
@@ -761,3 +763,1129 @@ EOF
         }
     );
 }
+
+{
+    # TEST*$pat_test
+    pat_test(
+        {
+            blurb    => '24 -B4 -W64',
+            cmd_line => [ '-f', "-B4", "-W64", $data_dir->child('24.board') ],
+            stdout   => <<'EOF',
+Freecell; any card may start a pile.
+8 work piles, 4 temp cells.
+Beam width 4 discarded 375 positions; retrying with 8.
+Beam width 8 discarded 556 positions; retrying with 16.
+A winner.
+97 moves.
+EOF
+            stderr => <<'EOF',
+Foundations: H-0 C-0 D-0 S-0
+Freecells:
+: 4C 2C 9C 8C QS 4S 2H
+: 5H QH 3C AC 3H 4H QD
+: QC 9S 6H 9H 3S KS 3D
+: 5D 2S JC 5C JH 6D AS
+: 2D KD TH TC TD 8D
+: 7H JS KH TS KC 7C
+: AH 5S 6S AD 8H JD
+: 7S 6C 7D 4D 8S 9D
+
+---
+EOF
+            win => <<'EOF',
+AS out
+7C to 8D
+QD to KC
+JD to temp
+8H to temp
+AD out
+3D to temp
+6S to temp
+6D to 7C
+5S to 6D
+AH out
+2H out
+4H to empty pile
+3H out
+AC out
+4H out
+4S to empty pile
+3D to 4S
+3C to temp
+QH to KS
+5H out
+QS to empty pile
+8C to 9D
+JD to QS
+9C to temp
+2C out
+3C out
+JD to temp
+JH to QS
+4C out
+5C out
+JC to QD
+2S out
+9C to empty pile
+QH to temp
+8H to 9C
+3D to temp
+4S to 5D
+KS to empty pile
+3S out
+4S out
+5S out
+6S out
+6D to temp
+7C to 8H
+QH to KS
+9H to temp
+6H out
+8D to 9S
+JC to QH
+TD to JC
+TC to JH
+9H to TC
+8C to 9H
+7C to 8D
+TH to temp
+6D to 7C
+KD to temp
+2D out
+3D out
+9D to empty pile
+8S to 9D
+4D out
+5D out
+6D out
+7D out
+6C out
+7C out
+8C out
+8D out
+7S out
+8S out
+9D out
+QD to empty pile
+KC to empty pile
+9S out
+TS out
+KH to empty pile
+JS out
+7H out
+TD out
+8H out
+9H out
+9C out
+TC out
+JC out
+TH out
+JH out
+QS out
+QH out
+KH out
+QC out
+JD out
+KC out
+KS out
+QD out
+KD out
+EOF
+        }
+    );
+}
+
+{
+    # TEST*$pat_test
+    pat_test(
+        {
+            blurb    => '3 -E -e',
+            cmd_line => [ '-f', "-E", "-e", $data_dir->child('3.board') ],
+            stdout   => <<'EOF',
+Freecell; any card may start a pile.
+8 work piles, 4 temp cells.
+No shorter solutions.
+A winner.
+73 moves.
+EOF
+            stderr => <<'EOF',
+Foundations: H-0 C-0 D-0 S-0
+Freecells:
+: KC 7D TC 4H 6C 9S 8C
+: 2D JH QH AS TD 2C 4S
+: QC 9D TS JD 2S 3H 5S
+: 7H JS 5D 8D 3C 4C 5C
+: 6S QS 6H AC 9H AH
+: 8H 8S KS 6D KD 2H
+: TH 9C 7C 3D 7S JC
+: 4D QD AD KH 3S 5H
+
+---
+EOF
+            win => <<'EOF',
+AH out
+2H out
+9H to temp
+AC out
+4S to temp
+2C out
+5C to 6H
+4C to temp
+3C out
+4C out
+5C out
+8C to temp
+9S to temp
+6C out
+5S to 6H
+3H out
+4H out
+9H to TC
+TD to temp
+AS out
+2S out
+5H out
+3S out
+4S out
+5S out
+6H out
+QS to KD
+6S out
+KH to empty pile
+AD out
+QH to temp
+QS to KH
+JH to QS
+2D out
+QD to empty pile
+JC to QD
+7S out
+3D out
+4D out
+7C out
+8D to 9C
+5D out
+KD to empty pile
+6D out
+8C out
+KS to temp
+8S out
+9S out
+JD to temp
+TS out
+JS out
+7H out
+8H out
+9H out
+TC to empty pile
+7D out
+8D out
+9C out
+TH out
+JH out
+9D out
+TC out
+JC out
+TD out
+QS out
+QC out
+QH out
+KH out
+JD out
+QD out
+KD out
+KC out
+KS out
+EOF
+        }
+    );
+}
+
+{
+    # TEST*$pat_test
+    pat_test(
+        {
+            blurb    => '3 -m',
+            cmd_line => [ '-f', "-m", $data_dir->child('3.board') ],
+            stdout   => <<'EOF',
+Freecell; any card may start a pile.
+8 work piles, 4 temp cells.
+A winner.
+80 moves.
+EOF
+            stderr => <<'EOF',
+Foundations: H-0 C-0 D-0 S-0
+Freecells:
+: KC 7D TC 4H 6C 9S 8C
+: 2D JH QH AS TD 2C 4S
+: QC 9D TS JD 2S 3H 5S
+: 7H JS 5D 8D 3C 4C 5C
+: 6S QS 6H AC 9H AH
+: 8H 8S KS 6D KD 2H
+: TH 9C 7C 3D 7S JC
+: 4D QD AD KH 3S 5H
+
+---
+EOF
+            win => <<'EOF',
+AH out
+2H out
+9H to temp
+AC out
+4S to temp
+2C out
+TD to JC
+AS out
+5S to temp
+3H out
+2S out
+5C to 6H
+4C to temp
+3C out
+4C out
+5H to temp
+3S out
+4S out
+KH to temp
+AD out
+5S out
+TD to temp
+JC to QD
+TD to JC
+8C to temp
+5C out
+9S to TD
+6C out
+4H out
+5H out
+6H out
+7S to 8D
+3D to temp
+7C out
+8C out
+9C out
+QH to temp
+JH to QS
+2D out
+3D out
+JH to temp
+QS to empty pile
+JH to QS
+6S out
+7S out
+TC out
+9S to TH
+TD to temp
+JC out
+QD to empty pile
+4D out
+8D to empty pile
+5D out
+JS to QD
+7H out
+KD to empty pile
+6D out
+7D out
+8D out
+KS to empty pile
+8S out
+8H out
+9S out
+9H out
+TH out
+JH out
+JD to QS
+TS out
+9D out
+JS out
+QH out
+TD out
+JD out
+QS out
+KS out
+QD out
+KD out
+QC out
+KC out
+KH out
+EOF
+        }
+    );
+}
+
+{
+    my $board    = $data_dir->child('24.board');
+    my $ckpt     = "24.ckpt";
+    my $run_pats = sub {
+        my @args = @_;
+        trap
+        {
+            system( "./patsolve", "-f", "-q", @args, $board );
+        };
+        return;
+    };
+
+    unlink( "win", $ckpt );
+    $run_pats->();
+    my $expected_win = _slurp_win();
+    unlink("win");
+
+    $run_pats->( "-K$ckpt", "-I1000" );
+
+    # TEST
+    ok( ( -f $ckpt ), "-K saved a checkpoint when -I stopped the search" );
+
+    $run_pats->("-R$ckpt");
+
+    # TEST
+    is( _slurp_win(), $expected_win,
+        "Resuming from the checkpoint finds the same solution" );
+
+    # Suspend the search every microsecond, so after every clock check.
+    unlink( "win", $ckpt );
+    trap
+    {
+        system( "./patsolve", "-f", "-K$ckpt", "-J0.000001", $board );
+    };
+    my @saves = ( $trap->stdout() =~ /^Saved a checkpoint to /mg );
+
+    # TEST
+    ok( ( @saves > 1 and _slurp_win() eq $expected_win ),
+        "-J saves a checkpoint after each slice, and finds the same solution"
+    );
+
+    unlink($ckpt);
+}
+
+{
+    local $ENV{PATSOLVE_START} = 12;
+    local $ENV{PATSOLVE_END}   = 13;
+    trap
+    {
+        system( "./patsolve", "-f", "-k", "-S", "-D4" );
+    };
+    my $stdout = _normalize_lf( $trap->stdout() );
+
+    # TEST
+    like(
+        $stdout,
+        qr/^Cut moves to dead positions: .*, [1-9][0-9]* buried cards\.$/ms,
+        "-D4 reports the positions that the buried cards rule cut"
+    );
+
+    # TEST
+    like( $stdout, qr/^#12 - Won$/ms, "-D4 still wins deal 12 with -k" );
+}
+
+{
+    my $board    = $data_dir->child('24.board');
+    my $ckpt     = "24-H.ckpt";
+    my $run_pats = sub {
+        my @args = @_;
+        trap
+        {
+            system( "./patsolve", "-f", "-q", "-H4", @args, $board );
+        };
+        return;
+    };
+
+    unlink( "win", $ckpt );
+    $run_pats->();
+
+    # TEST
+    like( _slurp_win(), qr/ out\n\z/ms, "-H4 solves deal 24" );
+
+    my $expected_win = _slurp_win();
+    unlink("win");
+    $run_pats->( "-K$ckpt", "-I1000" );
+    $run_pats->("-R$ckpt");
+
+    # TEST
+    is( _slurp_win(), $expected_win,
+        "-H4 finds the same solution when resumed from a checkpoint" );
+
+    unlink($ckpt);
+}
+
+{
+    local $ENV{PATSOLVE_START} = 14;
+    local $ENV{PATSOLVE_END}   = 17;
+    trap
+    {
+        system( "./patsolve", "-s", "-k", "-S", "-O2" );
+    };
+    my $stdout = _normalize_lf( $trap->stdout() );
+
+    # TEST
+    like(
+        $stdout,
+        qr/^Skipped reordered moves: [1-9][0-9]*\.$/ms,
+        "-O reports the moves that it skipped"
+    );
+
+    # TEST
+    unlike( $stdout, qr/lost the solution/,
+        "-O2 finds that no solutions were lost" );
+
+    # TEST
+    like( $stdout, qr/^#16 - Impossible$/ms,
+        "-O2 still finds that deal 16 is impossible" );
+}
+
+{
+    local $ENV{PATSOLVE_START} = 1;
+    local $ENV{PATSOLVE_END}   = 11;
+    my $run_range = sub {
+        trap
+        {
+            system( "./patsolve", "-q", @_ );
+        };
+        return _normalize_lf( $trap->stdout() );
+    };
+
+    # TEST
+    is(
+        $run_range->( "-G", "-f", "-S" ),
+        $run_range->( "-f", "-S" ),
+        "The generic solver gives the same Freecell results as the kernel"
+    );
+
+    # TEST
+    is(
+        $run_range->( "-G", "-s", "-k", "-S" ),
+        $run_range->( "-s", "-k", "-S" ),
+        "The generic solver gives the same Seahaven results as the kernel"
+    );
+}
+
+{
+    local $ENV{PATSOLVE_START}       = 1;
+    local $ENV{PATSOLVE_END}         = 40;
+    local $ENV{PATSOLVE_NUM_WORKERS} = 3;
+    my $run = sub {
+        trap
+        {
+            system(@_);
+        };
+        return _normalize_lf( $trap->stdout() );
+    };
+    my $expected = $run->( "./patsolve", "-f", "-S", "-I2000" );
+
+    # TEST
+    is(
+        $run->( "./threaded-pats", "--pin", "-f", "-S", "-I2000" ),
+        $expected,
+        "threaded-pats prints the same as patsolve, in the same order"
+    );
+
+    my $sorted_lines = sub {
+        return [ sort split /^/, shift ];
+    };
+
+    # TEST
+    is_deeply(
+        $sorted_lines->(
+            $run->(
+                "./threaded-pats", "--unordered", "-f", "-S", "-I2000"
+            )
+        ),
+        $sorted_lines->($expected),
+        "threaded-pats --unordered prints the same lines as patsolve"
+    );
+}
+
+{
+    local $ENV{PATSOLVE_START} = 1;
+    local $ENV{PATSOLVE_END}   = 60;
+    my $sock = "pats-coordinator-test.sock";
+    my @solve_args = ( "-q", "-f", "-S" );
+    trap
+    {
+        system( "./patsolve", @solve_args );
+    };
+    my $expected = _normalize_lf( $trap->stdout() );
+
+    trap
+    {
+        system( "./pats-coordinator", "--listen=unix:$sock", "--chunk=7",
+            "--spawn=2", "--workers=2", @solve_args );
+    };
+
+    # TEST
+    is( _normalize_lf( $trap->stdout() ),
+        $expected, "pats-coordinator merges the output of its workers" );
+
+    # A worker that takes a range and dies before it sends the result.
+    open my $coordinator, "-|", "./pats-coordinator", "--listen=unix:$sock",
+        "--chunk=7"
+        or die "Cannot run pats-coordinator: $!";
+    my $worker;
+    foreach my $attempt ( 1 .. 100 )
+    {
+        last
+            if $worker = IO::Socket::UNIX->new( Peer => $sock );
+        select( undef, undef, undef, 0.05 );
+    }
+    die "Cannot connect to pats-coordinator" if !$worker;
+    $worker->print("HELLO 0\nGET\n");
+    my $range = <$worker>;
+    close($worker);
+    system( "./threaded-pats", "--coordinator=unix:$sock", @solve_args );
+    my $got = do { local $/; <$coordinator> };
+    close($coordinator);
+
+    # TEST
+    is( _normalize_lf($got), $expected,
+        "pats-coordinator hands the range of a dead worker out again" );
+
+    # A worker that sends the result of a range that it wasn't handed.
+    open $coordinator, "-|", "./pats-coordinator", "--listen=unix:$sock",
+        "--chunk=7"
+        or die "Cannot run pats-coordinator: $!";
+    undef $worker;
+    foreach my $attempt ( 1 .. 100 )
+    {
+        last
+            if $worker = IO::Socket::UNIX->new( Peer => $sock );
+        select( undef, undef, undef, 0.05 );
+    }
+    die "Cannot connect to pats-coordinator" if !$worker;
+    $worker->print("HELLO 0\nGET\n");
+    my ( $start, $end ) = <$worker> =~ /\ARANGE ([0-9]+) ([0-9]+)\n\z/;
+    $worker->print( "RESULT $start " . ( $end + 7 ) . " 0\n" );
+    # The coordinator closes the connection, rather than waiting for it.
+    my $reply =
+        IO::Select->new($worker)->can_read(30) ? <$worker> : "No reply\n";
+    close($worker);
+    system( "./threaded-pats", "--coordinator=unix:$sock", @solve_args );
+    $got = do { local $/; <$coordinator> };
+    close($coordinator);
+
+    # TEST
+    is_deeply(
+        [ $reply, _normalize_lf($got) ],
+        [ undef, $expected ],
+        "pats-coordinator drops a worker that sends a range it wasn't handed"
+    );
+
+    {
+        local $ENV{PATSOLVE_START} = 5;
+        local $ENV{PATSOLVE_END}   = 5;
+        my @outputs = map {
+            trap
+            {
+                system( @$_, "-f", "-S" );
+            };
+            _normalize_lf( $trap->stdout() )
+        } ( ["./patsolve"],
+            [ "./pats-coordinator", "--listen=unix:$sock", "--spawn=1" ] );
+
+        # TEST
+        is( $outputs[1], $outputs[0],
+            "pats-coordinator prints the banner of patsolve for no deals" );
+    }
+
+    trap
+    {
+        system( "./threaded-pats", "--coordinator=unix:$sock",
+            "--solutions=pats-coordinator-test.sol", @solve_args );
+    };
+
+    # TEST
+    like(
+        $trap->stderr(),
+        qr/--solutions doesn't work with --coordinator\./,
+        "threaded-pats --coordinator rejects --solutions"
+    );
+}
+
+{
+    my $board = $data_dir->child('24.board')->slurp_utf8;
+    unlink("win");
+    trap
+    {
+        system( "./patsolve", "-f", "-S", "-q", $data_dir->child('24.board') );
+    };
+    my $win = _slurp_win();
+    unlink("win");
+
+    my $requests = "pats-server-requests.txt";
+    path($requests)
+        ->spew_utf8( "SOLVE " . length($board) . "\n" . $board,
+        "NOT A REQUEST\n", "DEAL 24\n", "QUIT\n" );
+    trap
+    {
+        system("./patsolve --server -f -S < $requests");
+    };
+    # The answers, without the positions and the times.
+    my @answers =
+        map { s/\A(RESULT \S+ \d+) \d+ \d+/$1/r }
+        split /^(?=RESULT|ERROR)/m, _normalize_lf( $trap->stdout() );
+    unlink($requests);
+
+    # TEST
+    is_deeply(
+        [ @answers[ 0, 1 ] ],
+        [
+            "RESULT Won "
+                . scalar( () = $win =~ /\n/g ) . " "
+                . length($win) . "\n"
+                . $win,
+            "ERROR Unknown request.\n",
+        ],
+        "--server answers a layout with the solution, and rejects a bad request"
+    );
+
+    # TEST
+    is( $answers[2], $answers[0],
+        "--server solves deal 24 the same from its number" );
+}
+
+{
+    my $board = $data_dir->child('24.board')->slurp_utf8;
+    # The 9D left out, and the 9D in place of the 8S.
+    my $short = $board =~ s/ 9D//r;
+    my $twice = $board =~ s/8S/9D/r;
+
+    my $requests = "pats-server-requests.txt";
+    path($requests)->spew_utf8(
+        ( map { "SOLVE " . length($_) . "\n" . $_ } $short, $twice ),
+        "DEAL " . ( "0" x 200 ) . "24\n",
+        "DEAL 24\n", "QUIT\n"
+    );
+    trap
+    {
+        system("./patsolve --server -f -S < $requests");
+    };
+    my @answers = split /^(?=RESULT|ERROR)/m, _normalize_lf( $trap->stdout() );
+    unlink($requests);
+
+    # TEST
+    is_deeply(
+        [ @answers[ 0 .. 2 ], scalar(@answers) ],
+        [
+            ( "ERROR Not a layout of the 52 cards.\n" ) x 2,
+            "ERROR The request is too long.\n", 4,
+        ],
+        "--server rejects a layout without the 52 cards, and a long request"
+    );
+
+    my $short_board = "pats-short.board";
+    path($short_board)->spew_utf8($short);
+    trap
+    {
+        system( "./patsolve", "-f", "-q", $short_board );
+    };
+    unlink($short_board);
+
+    # TEST
+    like(
+        $trap->stderr(),
+        qr/not a layout of the 52 cards/,
+        "patsolve rejects an input without the 52 cards"
+    );
+}
+
+{
+    my $db         = "pats-results-test.db";
+    my @solve_args = ( "-q", "-f", "-S", "-I2000" );
+    unlink($db);
+    my $run = sub {
+        my ( $start, $end, @cmd ) = @_;
+        local $ENV{PATSOLVE_START} = $start;
+        local $ENV{PATSOLVE_END}   = $end;
+        trap
+        {
+            system(@cmd);
+        };
+        return _normalize_lf( $trap->stdout() );
+    };
+    my $expected = join "", grep { / - / }
+        split /^/, $run->( 1, 30, "./patsolve", @solve_args );
+
+    # Two runs fill in two parts of the same database.
+    $run->( 1, 15, "./threaded-pats", "--results-db=$db", @solve_args );
+    $run->( 15, 30, "./patsolve", "--results-db=$db", @solve_args );
+
+    # TEST
+    is( $run->( -1, -1, "./pats-results", "--list", $db, 1, 30 ) =~
+            s/^(#\d+ - \S+) .*$/$1/gmr,
+        $expected, "--results-db records the status of each deal" );
+
+    # TEST
+    is( $run->( -1, -1, "./pats-results", "--missing", $db, 1, 40 ),
+        "30 40\n", "pats-results lists the deals without a result" );
+    unlink($db);
+}
+
+{
+    my @deals = ( 24, 2147483650, 4294967300 );
+    my $requests = "pats-deal-requests.txt";
+    path($requests)->spew_utf8(
+        map {
+            my $board = `./pats-msdeal $_`;
+            "SOLVE " . length($board) . "\n" . $board, "DEAL $_\n"
+        } @deals
+    );
+    trap
+    {
+        system("./patsolve --server -f -S < $requests");
+    };
+    unlink($requests);
+    # The answers, without the times.
+    my @answers =
+        map { s/\A(RESULT \S+ \d+ \d+) \d+/$1/r }
+        split /^(?=RESULT|ERROR)/m, _normalize_lf( $trap->stdout() );
+
+    # TEST
+    is_deeply(
+        [ @answers[ map { 2 * $_ + 1 } keys @deals ] ],
+        [ @answers[ map { 2 * $_ } keys @deals ] ],
+        "Deals are dealt the same as the layouts of pats-msdeal"
+    );
+}
+
+{
+    my $corpus     = "pats-deals-test.bin";
+    my @solve_args = ( "-q", "-f", "-S", "-I2000" );
+    system( "./pats-msdeal", "--corpus=$corpus", "--threads=3", 1, 40 );
+    my $run = sub {
+        trap
+        {
+            system(@_);
+        };
+        return _normalize_lf( $trap->stdout() );
+    };
+    my $expected = do
+    {
+        local $ENV{PATSOLVE_START} = 1;
+        local $ENV{PATSOLVE_END}   = 40;
+        $run->( "./patsolve", @solve_args );
+    };
+
+    # TEST
+    is( $run->( "./patsolve", "--corpus=$corpus", @solve_args ),
+        $expected, "patsolve solves the deals of a corpus" );
+
+    # TEST
+    is( $run->( "./threaded-pats", "--corpus=$corpus", @solve_args ),
+        $expected, "threaded-pats solves the deals of a corpus" );
+    unlink($corpus);
+}
+
+{
+    my @solve_args = ( "-q", "-f", "-S" );
+    unlink("win");
+    trap
+    {
+        system( "./patsolve", @solve_args, $data_dir->child('24.board') );
+    };
+    my $win = _slurp_win();
+    unlink("win");
+
+    local $ENV{PATSOLVE_START} = 20;
+    local $ENV{PATSOLVE_END}   = 30;
+    trap
+    {
+        system( "./patsolve", "--solutions=pats-sol-test.bin", @solve_args );
+        system( "./threaded-pats", "--solutions=pats-sol-test2.bin",
+            "--workers=3", @solve_args );
+    };
+    trap
+    {
+        system( "./pats-solutions", "pats-sol-test.bin", 24 );
+    };
+
+    # TEST
+    is( _normalize_lf( $trap->stdout() ),
+        $win, "pats-solutions prints the same solution as the win file" );
+
+    # TEST
+    is_deeply(
+        [
+            map { path($_)->slurp_raw }
+                qw/pats-sol-test2.bin pats-sol-test2.bin.idx/
+        ],
+        [
+            map { path($_)->slurp_raw }
+                qw/pats-sol-test.bin pats-sol-test.bin.idx/
+        ],
+        "threaded-pats writes the same solutions as patsolve"
+    );
+
+    # Make the first move of deal 20 "KS out", which cannot be legal there.
+    my $bad = path("pats-sol-test.bin")->slurp_raw;
+    substr( $bad, 8 + 24, 1, chr( ( 1 << 6 ) | ( 13 << 2 ) | 3 ) );
+    path("pats-sol-test2.bin")->spew_raw($bad);
+    my @verified = map {
+        trap
+        {
+            system( "./pats-verify", "-f", $_ );
+        };
+        _normalize_lf( $trap->stdout() )
+    } qw/pats-sol-test.bin pats-sol-test2.bin/;
+
+    # TEST
+    is_deeply(
+        \@verified,
+        [
+            "Verified 10 solutions: 0 wrong.  0 deals had no solution.\n",
+            "#20: move 1 is illegal: KS out\n"
+                . "Verified 10 solutions: 1 wrong.  0 deals had no solution.\n"
+        ],
+        "pats-verify accepts the solutions, and finds the illegal move"
+    );
+    unlink(
+        qw/pats-sol-test.bin pats-sol-test.bin.idx pats-sol-test2.bin
+            pats-sol-test2.bin.idx/
+    );
+}
+
+{
+    my @tuned = map {
+        trap
+        {
+            system( "./pats-tune", "-f", "-S", "--generations=2",
+                "--population=4", "--seed=1", "--threads=$_", 1, 6 );
+        };
+        _normalize_lf( $trap->stdout() )
+    } ( 1, 3 );
+
+    # TEST
+    ok(
+        (
+                    $tuned[0] eq $tuned[1]
+                and $tuned[0] =~ /\nTuned(?: -?[0-9]+){11}(?: \S+){3}\n\z/
+        ),
+        "pats-tune prints the same param.dat line with any number of threads"
+    );
+}
+
+{
+    local $ENV{PATSOLVE_START} = 1;
+    local $ENV{PATSOLVE_END}   = 11;
+    path("pats-rules-test.txt")
+        ->spew_utf8( "# Every deal, the same.\n", "default FreecellBest\n" );
+    my @outputs = map {
+        trap
+        {
+            system( "./patsolve", "-f", "-S", "-q", @$_ );
+        };
+        _normalize_lf( $trap->stdout() )
+    } (
+        [],
+        [ "--params-file=" . $base_dir->parent->child('param.dat') ],
+        ["-P1"],
+        ["--preset-rules=pats-rules-test.txt"],
+    );
+    unlink("pats-rules-test.txt");
+
+    # TEST
+    is( $outputs[1], $outputs[0],
+        "--params-file=param.dat solves like the compiled presets" );
+
+    # TEST
+    is( $outputs[3], $outputs[2],
+        "A --preset-rules default is the same as -P of that preset" );
+}
+
+{
+    local $ENV{PATSOLVE_START} = 1;
+    local $ENV{PATSOLVE_END}   = 11;
+    my @solve_args = ( "-q", "-f", "-S" );
+    trap
+    {
+        system( "./pats-tune", "-f", "-S", "--move-weights",
+            "--generations=0", 1, 2 );
+    };
+    my $weights = _normalize_lf( $trap->stdout() );
+
+    # TEST
+    like(
+        $weights,
+        qr/\A#[^\n]*\n(?:[a-z_]+ -?[0-9]+\.[0-9]+\n){18}\z/,
+        "pats-tune --move-weights prints a --move-weights file"
+    );
+    path("pats-weights-test.txt")->spew_utf8($weights);
+    trap
+    {
+        system( "./patsolve", @solve_args,
+            "--move-weights=pats-weights-test.txt" );
+    };
+
+    # TEST
+    like(
+        _normalize_lf( $trap->stdout() ),
+        qr/\A(?:#([0-9]+)\n#\1 - [A-Za-z]+\n){10}\z/,
+        "patsolve --move-weights gives a result for each deal"
+    );
+
+    trap
+    {
+        system( "./patsolve", "--solutions=pats-learn-test.bin",
+            @solve_args );
+    };
+    trap
+    {
+        system( "./pats-learn", "-f", "-S", "pats-learn-test.bin" );
+    };
+
+    # TEST
+    like(
+        _normalize_lf( $trap->stdout() ),
+        qr/\A\# [ ]pats-learn (?:[^\n]*\n\#)* [^\n]*\n
+            (?:[a-z_]+ [ ] -?[0-9]+\.[0-9]+\n){18}\z/x,
+        "pats-learn learns the weights from the solutions"
+    );
+    unlink(
+        qw/pats-weights-test.txt pats-learn-test.bin
+            pats-learn-test.bin.idx/
+    );
+}
+
+{
+    local $ENV{PATSOLVE_START} = 1;
+    local $ENV{PATSOLVE_END}   = 41;
+    my $db = "pats-beam-test.db";
+    unlink($db);
+    trap
+    {
+        system( "./patsolve", "-f", "-S", "-q", "-B4", "--results-db=$db" );
+    };
+    trap
+    {
+        system( "./pats-results", "--list", $db );
+    };
+    unlink($db);
+
+    # The positions that each deal stored.
+    my @stored =
+        map { (split)[5] } split( /\n/, _normalize_lf( $trap->stdout() ) );
+
+    # TEST
+    ok( ( @stored == 40 and !grep { $_ > 4 * 1000 } @stored ),
+        "-B4 stores at most 1000 positions per position of beam width" );
+}
+
+{
+    local $ENV{PATSOLVE_START} = 1;
+    local $ENV{PATSOLVE_END}   = 4;
+    my $run = sub {
+        my @args = @_;
+        trap
+        {
+            system( "./patsolve", "-f", "-S", "-q", @args );
+        };
+        return _normalize_lf( $trap->stdout() );
+    };
+
+    # TEST
+    is(
+        $run->("-I100"),
+        "#1\n#1 - Iterations\n#2\n#2 - Iterations\n#3\n#3 - Iterations\n",
+        "-I gives up on every deal, with the Iterations status"
+    );
+
+    local $ENV{PATSOLVE_END} = 2;
+
+    # Deal 1 checks thousands of positions, so the clocks are read in time.
+    # TEST
+    is( $run->("-T0.000001"), "#1\n#1 - WallTime\n",
+        "-T gives up with the WallTime status" );
+
+    # TEST
+    is( $run->("-C0.000001"), "#1\n#1 - CPUTime\n",
+        "-C gives up with the CPUTime status" );
+}
+
+{
+    local $ENV{PATSOLVE_START} = 1;
+    local $ENV{PATSOLVE_END}   = 2;
+    my $db = "pats-len-test.db";
+    unlink($db);
+    trap
+    {
+        system( "./patsolve", "-f", "-m", "-q", "-L110", "--results-db=$db" );
+    };
+    trap
+    {
+        system( "./pats-results", "--list", $db );
+    };
+    unlink($db);
+
+    # A sequence move counts as several moves against the bound, so the
+    # children that it takes past the bound are never stored.  (Counting it
+    # as one move stored 60214 positions.)
+    # TEST
+    like(
+        _normalize_lf( $trap->stdout() ),
+        qr/\A#1 - Won 108 40774 58425 [0-9]+\n\z/,
+        "-m -L110 prunes the sequence moves past the bound before storing"
+    );
+}
+
+{
+    my $run = sub {
+        my @args = @_;
+        trap
+        {
+            system( "./patsolve", "-s", "-k", @args,
+                $data_dir->child("1.seahaven.board") );
+        };
+        return _normalize_lf( $trap->stdout() );
+    };
+    my $stdout = $run->();
+
+    # TEST
+    is(
+        $stdout,
+        "Seahaven; only Kings are allowed to start a pile.\n"
+            . "10 work piles, 4 temp cells.\nA winner.\n75 moves.\n",
+        "Without -D, the Seahaven runs rule cuts moves, but is not reported"
+    );
+
+    my $report = "Cut moves to dead positions: 183 Seahaven runs, "
+        . "0 cyclic blockers, 0 buried cards.\n";
+
+    # TEST
+    is(
+        $run->("-D1"),
+        $stdout =~ s/^(?=A winner)/$report/mr,
+        "-D1 reports the moves that the Seahaven runs rule cut"
+    );
+}
+
+{
+    local $ENV{PATSOLVE_START} = 1;
+    local $ENV{PATSOLVE_END}   = 7;
+    my $db = "pats-por-test.db";
+    my $run = sub {
+        my @args = @_;
+        unlink($db);
+        trap
+        {
+            system( "./patsolve", "-f", "-k", "-t1", "-S", "-q", @args,
+                "--results-db=$db" );
+        };
+        trap
+        {
+            system( "./pats-results", "--list", $db );
+        };
+        unlink($db);
+
+        # Leave out the times.
+        return _normalize_lf( $trap->stdout() ) =~ s/ [0-9]+$//mgr;
+    };
+
+    # TEST
+    is( $run->("-O2"), $run->("-O1"),
+        "-O2 records the run with -O, not the one that checks it" );
+
+    trap
+    {
+        system( "./patsolve", "-f", "-O3", $data_dir->child('24.board') );
+    };
+
+    # TEST
+    like( $trap->stderr(), qr/-O must be 0, 1 or 2\./, "-O3 is rejected" );
+}
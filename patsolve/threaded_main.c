@@ -5,50 +5,293 @@
 // or distributed except according to the terms contained in the COPYING file.
 //
 // Copyright (c) 2002 Tom Holroyd
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
 #include <stdarg.h>
 #include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <unistd.h>
 
 #include "rinutils/portable_time.h"
 
 #include "pat.h"
-#include "range_solvers_gen_ms_boards.h"
 
 #include "print_layout.h"
 #include "read_layout.h"
 #include "pats__play.h"
 #include "pats__print_msg.h"
+#include "deal_corpus.h"
+#include "pats_clock.h"
+#include "pats_socket.h"
+#include "results_db.h"
 #include "print_time.h"
 
 static const char Usage[] =
     "SYNOPSIS:\n"
     "\n"
-    "    PATSOLVE_START=1 PATSOLVE_END=32000 threaded-pats -f -S\n"
+    "    PATSOLVE_START=1 PATSOLVE_END=32001 threaded-pats -f -S\n"
     "\n"
-    "Usage: %s [-s|f] [-k|a] [-w<n>] [-t<n>] [-E] [-S] [-q|v] [layout]\n"
+    "Usage: %s [-s|f] [-k|a] [-w<n>] [-t<n>] [-E] [-S] [-B<n>] [-W<n>]\n"
+    "    [-e] [-L<n>] [-m] [-G] [-D<n>] [-H<n>] [-O<n>] [-I<n>] [-T<secs>]\n"
+    "    [-C<secs>] [-q|v] [--workers=<n>] [--pin] [--unordered] [--progress]\n"
+    "    [--coordinator=<address>] [--results-db=<file>] [--corpus=<file>]\n"
+    "    [--solutions=<file>] [--params-file=<file>] [--preset-rules=<file>]\n"
+    "    [--move-weights=<file>]\n"
     "-s Seahaven (same suit), -f Freecell (red/black)\n"
     "-k only Kings start a pile, -a any card starts a pile\n"
     "-w<n> number of work piles, -t<n> number of free cells\n"
     "-E don't exit after one solution; continue looking for better ones\n"
+    "-e with -E, start from the length of a quick -S solution\n"
+    "-L<n> only look for solutions shorter than <n> moves\n"
     "-S speed mode; find a solution quickly, rather than a good solution\n"
+    "-m also move whole sequences at once (the solution has single moves)\n"
+    "-G use the generic solver, not the one compiled for the variant\n"
+    "-D<n> cut dead positions by the rules in the bit mask <n>: 1 Seahaven\n"
+    "    runs, 2 cyclic blockers, 4 buried cards (default 1), and report it\n"
+    "-H<n> prune moves that undo one of the last <n> moves (default 1)\n"
+    "-O<n> 1 skips moves that only reorder independent moves, 2 also checks\n"
+    "    that this did not lose the solution, by solving again without it\n"
+    "-B<n> beam search; keep only the best <n> positions at each depth\n"
+    "-W<n> on failure, retry with a wider beam, up to <n> positions\n"
+    "-I<n> give up on a deal after checking <n> positions\n"
+    "-T<secs> give up on a deal after <secs> seconds of wall time\n"
+    "-C<secs> give up on a deal after <secs> seconds of CPU time\n"
     "-q quiet, -v verbose\n"
-    "-s implies -aw10 -t4, -f implies -aw8 -t4\n";
+    "-s implies -aw10 -t4, -f implies -aw8 -t4\n"
+    "--workers=<n> solve with <n> threads (default $PATSOLVE_NUM_WORKERS,\n"
+    "    or else the number of CPUs that the process may run on)\n"
+    "--pin pin each thread to its own CPU, so its memory stays local\n"
+    "--unordered print the deals as they are done, not in order\n"
+    "--progress also print the start and end times, and every 100 deals\n"
+    "--coordinator=<address> solve the deals that pats-coordinator hands\n"
+    "    out, at unix:<path> or <host>:<port>, rather than a range\n"
+    "--results-db=<file> also record the result of each deal in <file>,\n"
+    "    which pats-results reads (several runs may share one file)\n"
+    "--corpus=<file> take the deals from <file>, which pats-msdeal --corpus\n"
+    "    wrote (by default, all of them)\n"
+    "--solutions=<file> also write the solution of each deal to <file>\n"
+    "    (indexed in <file>.idx), which pats-solutions prints; \"-\" is\n"
+    "    stdout, and then the reports go to stderr\n"
+    "--params-file=<file> read the presets of -P and of the variants from\n"
+    "    <file>, in the format of param.dat\n"
+    "--preset-rules=<file> choose the preset of each deal by its features,\n"
+    "    with the rules in <file> (see presets.h and select_presets.py)\n"
+    "--move-weights=<file> order the moves by the weights of their features\n"
+    "    in <file> (see move_model.h and pats-learn), not by the -X ones\n"
+    "The deals are PATSOLVE_START up to but not including PATSOLVE_END, and\n"
+    "the output is the same as that of patsolve for the same range.\n";
 
-static const pthread_mutex_t initial_mutex_constant = PTHREAD_MUTEX_INITIALIZER;
+static atomic_llong next_board_num;
+static long long past_end_board;
 
-static long long next_board_num;
-long long end_board_idx, past_end_board;
-static pthread_mutex_t next_board_num_lock;
-
-long long total_num_iters = 0;
-static pthread_mutex_t total_num_iters_lock;
-static fcs_int_limit_t update_total_num_iters_threshold = 1000000;
 const long long board_num_step = 32;
 const long long stop_at = 100;
 int context_argc;
 char **context_argv;
+static bool show_progress;
+static const char *results_db_path;
+static fcs_pats__results_db results_db;
+static const char *corpus_path;
+static fcs_pats__corpus corpus;
+static const char *solutions_path;
+static fcs_pats__solutions_stream solutions;
+static const char *preset_rules_path;
+static fcs_pats__preset_selector preset_selector;
+static const double *move_weights;
+
+#ifdef CPU_SET
+static cpu_set_t allowed_cpus;
+#endif
+
+static int get_num_cpus(void)
+{
+#ifdef CPU_SET
+    if (sched_getaffinity(0, sizeof(allowed_cpus), &allowed_cpus) == 0)
+    {
+        return CPU_COUNT(&allowed_cpus);
+    }
+    CPU_ZERO(&allowed_cpus);
+#endif
+    const long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return (num_cpus > 0) ? (int)num_cpus : 1;
+}
+
+/* Pin the calling thread to the worker_idx-th CPU of the ones it may run
+on.  The worker's positions and blocks are allocated and first written by
+the worker itself, so once it is pinned, Linux places them on the memory
+node of its CPU. */
+static void pin_worker(const int worker_idx)
+{
+#ifdef CPU_SET
+    const int num_cpus = CPU_COUNT(&allowed_cpus);
+    if (num_cpus == 0)
+    {
+        return;
+    }
+    int remaining = worker_idx % num_cpus;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+    {
+        if (CPU_ISSET(cpu, &allowed_cpus) && (remaining-- == 0))
+        {
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            CPU_SET(cpu, &cpus);
+            const int check =
+                pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+            if (check)
+            {
+                fprintf(stderr,
+                    "Worker Thread No. %d could not be pinned to CPU %d "
+                    "(error %d).\n",
+                    worker_idx, cpu, check);
+            }
+            return;
+        }
+    }
+#endif
+}
+
+typedef struct
+{
+    /* Each worker counts its own iterations, in its own cache line, and
+    the counts are only added up for reporting. */
+    _Alignas(64) atomic_llong num_iters;
+    int idx;
+    bool pin;
+} worker_context;
+
+static worker_context *contexts;
+static int num_workers;
+
+static long long get_total_num_iters(void)
+{
+    long long total = 0;
+    for (int idx = 0; idx < num_workers; ++idx)
+    {
+        total += atomic_load_explicit(
+            &contexts[idx].num_iters, memory_order_relaxed);
+    }
+    return total;
+}
+
+/* Claim the next boards to play, and return how many there are, or 0 once
+the range is done.  The chunks shrink with the number of boards that are
+left (guided scheduling), from board_num_step down to single boards near
+the end, so a slow board doesn't keep other boards waiting behind it. */
+static long long claim_boards(long long *const board_num)
+{
+    long long start =
+        atomic_load_explicit(&next_board_num, memory_order_relaxed);
+    long long chunk;
+    do
+    {
+        const long long remaining = past_end_board - start;
+        if (remaining <= 0)
+        {
+            return 0;
+        }
+        chunk = min(board_num_step, remaining / (2 * num_workers));
+        if (chunk < 1)
+        {
+            chunk = 1;
+        }
+    } while (!atomic_compare_exchange_weak_explicit(&next_board_num, &start,
+        start + chunk, memory_order_relaxed, memory_order_relaxed));
+    *board_num = start;
+    return chunk;
+}
+
+/* The output of the boards from board_num to end_board_num (excluded), kept
+until the boards before them were written.  The records of their solutions
+(--solutions) follow the text. */
+typedef struct pending_output
+{
+    long long board_num, end_board_num;
+    struct pending_output *next;
+    size_t len, solutions_len;
+    char text[];
+} pending_output;
+
+static pthread_mutex_t output_lock = PTHREAD_MUTEX_INITIALIZER;
+static bool is_unordered;
+/* Where write_output() writes to: stdout (or stderr, when the solutions go
+to stdout), or a buffer for the coordinator. */
+static FILE *output_fh;
+static long long next_board_to_write;
+// Sorted by board_num.
+static pending_output *pending_outputs;
 
-static void *worker_thread(void *context)
+static void write_chunk(const char *const text, const size_t len,
+    const char *const solutions_records, const size_t solutions_len)
 {
+    fwrite(text, 1, len, output_fh);
+    if (solutions_path &&
+        !fc_solve_pats__solutions_append(&solutions,
+            (const uint8_t *)solutions_records, solutions_len))
+    {
+        fatalerr("Cannot write the solutions to '%s'.", solutions_path);
+    }
+}
+
+/* Write the output of a chunk of boards, in board order unless
+--unordered.  A chunk that is done before the ones before it waits in
+pending_outputs, and is written by the worker that fills the gap. */
+static void write_output(const long long board_num,
+    const long long end_board_num, const char *const text, const size_t len,
+    const char *const solutions_records, const size_t solutions_len)
+{
+    pthread_mutex_lock(&output_lock);
+    if (is_unordered || board_num == next_board_to_write)
+    {
+        write_chunk(text, len, solutions_records, solutions_len);
+        next_board_to_write = end_board_num;
+        while (pending_outputs &&
+               pending_outputs->board_num == next_board_to_write)
+        {
+            pending_output *const next = pending_outputs;
+            pending_outputs = next->next;
+            write_chunk(next->text, next->len, next->text + next->len,
+                next->solutions_len);
+            next_board_to_write = next->end_board_num;
+            free(next);
+        }
+        fflush(output_fh);
+    }
+    else
+    {
+        pending_output *const new_output =
+            malloc(sizeof(*new_output) + len + solutions_len);
+        if (!new_output)
+        {
+            fatalerr("Out of memory for the output.");
+        }
+        new_output->board_num = board_num;
+        new_output->end_board_num = end_board_num;
+        new_output->len = len;
+        new_output->solutions_len = solutions_len;
+        memcpy(new_output->text, text, len);
+        memcpy(new_output->text + len, solutions_records, solutions_len);
+        pending_output **prev = &pending_outputs;
+        while (*prev && (*prev)->board_num < board_num)
+        {
+            prev = &(*prev)->next;
+        }
+        new_output->next = *prev;
+        *prev = new_output;
+    }
+    pthread_mutex_unlock(&output_lock);
+}
+
+static void *worker_thread(void *void_context)
+{
+    worker_context *const context = void_context;
+    if (context->pin)
+    {
+        pin_worker(context->idx);
+    }
     fcs_pats_thread soft_thread_struct__dont_use_directly;
     fcs_pats_thread *const soft_thread = &soft_thread_struct__dont_use_directly;
 
@@ -59,82 +302,127 @@ static void *worker_thread(void *context)
     bool is_quiet = false;
     fc_solve_pats__configure_soft_thread(soft_thread, &(instance_struct), &argc,
         (const char ***)(&argv), &is_quiet);
-
-    long long board_num;
-    fcs_int_limit_t total_num_iters_temp = 0;
-    fcs_state_string state_string;
-    get_board__setup_string(state_string);
-    do
+    const fcs_pats_xy_params variant_params = soft_thread->pats_solve_params;
+    soft_thread->move_weights = move_weights;
+    // Print each chunk of boards to memory, and write it all at once.
+    char *text = NULL;
+    size_t text_size = 0;
+    FILE *const out = open_memstream(&text, &text_size);
+    if (!out)
     {
-        pthread_mutex_lock(&next_board_num_lock);
-        board_num = next_board_num;
-        const long long proposed_quota_end = (next_board_num += board_num_step);
-        pthread_mutex_unlock(&next_board_num_lock);
-
-        const long long quota_end = min(proposed_quota_end, past_end_board);
+        fatalerr("Cannot open the output buffer.");
+    }
+    soft_thread->out = out;
+    char *solutions_records = NULL;
+    size_t solutions_size = 0;
+    FILE *const solutions_out =
+        open_memstream(&solutions_records, &solutions_size);
+    if (!solutions_out)
+    {
+        fatalerr("Cannot open the output buffer.");
+    }
 
+    long long board_num, num_boards;
+    while ((num_boards = claim_boards(&board_num)))
+    {
+        const long long chunk_start = board_num;
+        const long long quota_end = board_num + num_boards;
+        fseeko(out, 0, SEEK_SET);
+        fseeko(solutions_out, 0, SEEK_SET);
         for (; board_num < quota_end; ++board_num)
         {
-            get_board_l__without_setup(board_num, state_string);
-
-            fc_solve_pats__read_layout(soft_thread, state_string);
+            // The same output as the range mode of patsolve.
+            fprintf(out, "#%lld\n", board_num);
+            const long long start_usecs = fc_solve_pats__wall_usecs();
+            if (corpus_path)
+            {
+                const uint8_t *const cards =
+                    fc_solve_pats__corpus_deal(&corpus, board_num);
+                if (!cards)
+                {
+                    fatalerr("Deal %lld of the corpus is not a deal.",
+                        board_num);
+                }
+                fc_solve_pats__read_dealt_cards(soft_thread, cards);
+            }
+            else
+            {
+                fc_solve_pats__read_deal(soft_thread, board_num);
+            }
+            if (preset_rules_path)
+            {
+                fc_solve_pats__select_preset(
+                    soft_thread, &preset_selector, &variant_params);
+            }
             fc_solve_pats__play(soft_thread, is_quiet);
-            fflush(stdout);
-
-            total_num_iters_temp += soft_thread->num_checked_states;
-            if (total_num_iters_temp >= update_total_num_iters_threshold)
+            fprintf(out, "#%lld - %s\n", board_num,
+                fc_solve_pats__status_name(soft_thread));
+            if (results_db_path)
             {
-                pthread_mutex_lock(&total_num_iters_lock);
-                total_num_iters += total_num_iters_temp;
-                pthread_mutex_unlock(&total_num_iters_lock);
-                total_num_iters_temp = 0;
+                fc_solve_pats__results_db_set(&results_db, board_num,
+                    fc_solve_pats__status_name(soft_thread),
+                    soft_thread->num_moves_to_win,
+                    soft_thread->num_checked_states,
+                    soft_thread->num_states_in_collection,
+                    fc_solve_pats__wall_usecs() - start_usecs);
             }
-
-            if (board_num % stop_at == 0)
+            if (solutions_path)
             {
-                long long total_num_iters_copy;
+                fc_solve_pats__write_solution(
+                    soft_thread, board_num, solutions_out);
+            }
 
-                pthread_mutex_lock(&total_num_iters_lock);
-                total_num_iters_copy =
-                    (total_num_iters += total_num_iters_temp);
-                pthread_mutex_unlock(&total_num_iters_lock);
-                total_num_iters_temp = 0;
+            atomic_fetch_add_explicit(&context->num_iters,
+                soft_thread->num_checked_states, memory_order_relaxed);
 
-                fc_solve_print_reached(board_num, total_num_iters_copy);
+            if (show_progress && board_num % stop_at == 0)
+            {
+                fc_solve_print_reached(board_num, get_total_num_iters());
             }
 
             fc_solve_pats__recycle_soft_thread(soft_thread);
         }
-    } while (board_num <= end_board_idx);
-
-    pthread_mutex_lock(&total_num_iters_lock);
-    total_num_iters += total_num_iters_temp;
-    pthread_mutex_unlock(&total_num_iters_lock);
+        fflush(out);
+        fflush(solutions_out);
+        write_output(chunk_start, quota_end, text, (size_t)ftello(out),
+            solutions_records, (size_t)ftello(solutions_out));
+    }
+    fclose(out);
+    free(text);
+    fclose(solutions_out);
+    free(solutions_records);
+    fc_solve_pats__destroy_soft_thread(soft_thread);
 
     return NULL;
 }
 
-int main(int argc, char **argv)
+static pthread_t *workers;
+
+/* Solve the boards from start_board_num to end_board_num (excluded) with
+all the workers, and write their output to output_fh (and their results to
+the results database). */
+static void solve_range(
+    const long long start_board_num, const long long end_board_num)
 {
-    if (argc > 1 && ((!strcmp(argv[1], "-h")) || (!strcmp(argv[1], "--help"))))
+    if (corpus_path && (start_board_num < corpus.start_deal_num ||
+                           end_board_num > corpus.end_deal_num))
     {
-        USAGE();
-        exit(0);
+        fatalerr("The corpus '%s' has deals %lld to %lld only.", corpus_path,
+            corpus.start_deal_num, corpus.end_deal_num - 1);
     }
-    next_board_num_lock = initial_mutex_constant;
-    total_num_iters_lock = initial_mutex_constant;
-    next_board_num = get_idx_from_env("PATSOLVE_START");
-    past_end_board = (end_board_idx = get_idx_from_env("PATSOLVE_END")) + 1;
-
-    int num_workers = 4;
-    fc_solve_print_started_at();
-    context_argc = argc;
-    context_argv = argv;
-    pthread_t workers[num_workers];
+    if (results_db_path &&
+        !fc_solve_pats__results_db_open(&results_db, results_db_path,
+            start_board_num, end_board_num, true))
+    {
+        fatalerr("Cannot open the results database '%s'.", results_db_path);
+    }
+    next_board_to_write = start_board_num;
+    atomic_store(&next_board_num, start_board_num);
+    past_end_board = end_board_num;
     for (int idx = 0; idx < num_workers; idx++)
     {
         const int check =
-            pthread_create(&workers[idx], NULL, worker_thread, NULL);
+            pthread_create(&workers[idx], NULL, worker_thread, &contexts[idx]);
         if (check)
         {
             fprintf(stderr,
@@ -150,7 +438,271 @@ int main(int argc, char **argv)
     {
         pthread_join(workers[idx], NULL);
     }
-    fc_solve_print_finished(total_num_iters);
+    if (results_db_path)
+    {
+        fc_solve_pats__results_db_close(&results_db);
+    }
+}
+
+/* Ask pats-coordinator for ranges of boards until it has none left, and
+send it the output of each one.  The protocol is in coordinator.c. */
+static void solve_for_coordinator(
+    const char *const address, const char *const banner, const size_t len)
+{
+    const int fd = fc_solve_pats__open_socket(address, false);
+    if (fd < 0)
+    {
+        fatalerr("Cannot connect to the coordinator at '%s'.", address);
+    }
+    signal(SIGPIPE, SIG_IGN);
+    FILE *const from_coordinator = fdopen(fd, "r");
+    char header[100];
+    snprintf(header, sizeof(header), "HELLO %zu\n", len);
+    if (!fc_solve_pats__write_all(fd, header, strlen(header)) ||
+        !fc_solve_pats__write_all(fd, banner, len))
+    {
+        fatalerr("Cannot write to the coordinator.");
+    }
+
+    char *text = NULL;
+    size_t text_size = 0;
+    output_fh = open_memstream(&text, &text_size);
+    if (!output_fh)
+    {
+        fatalerr("Cannot open the output buffer.");
+    }
+    while (true)
+    {
+        char reply[100];
+        long long start_board_num, end_board_num;
+        if (!fc_solve_pats__write_all(fd, "GET\n", 4) ||
+            !fgets(reply, sizeof(reply), from_coordinator))
+        {
+            fatalerr("Lost the connection to the coordinator.");
+        }
+        if (!strcmp(reply, "DONE\n"))
+        {
+            break;
+        }
+        if (sscanf(reply, "RANGE %lld %lld", &start_board_num,
+                &end_board_num) != 2)
+        {
+            fatalerr("Unknown reply from the coordinator: %s", reply);
+        }
+        fseeko(output_fh, 0, SEEK_SET);
+        solve_range(start_board_num, end_board_num);
+        fflush(output_fh);
+        const size_t text_len = (size_t)ftello(output_fh);
+        snprintf(header, sizeof(header), "RESULT %lld %lld %zu\n",
+            start_board_num, end_board_num, text_len);
+        if (!fc_solve_pats__write_all(fd, header, strlen(header)) ||
+            !fc_solve_pats__write_all(fd, text, text_len))
+        {
+            fatalerr("Lost the connection to the coordinator.");
+        }
+    }
+    fclose(output_fh);
+    free(text);
+    fclose(from_coordinator);
+}
+
+int main(int argc, char **argv)
+{
+    program_name = argv[0];
+    if (argc > 1 && ((!strcmp(argv[1], "-h")) || (!strcmp(argv[1], "--help"))))
+    {
+        USAGE();
+        exit(0);
+    }
+    const long long num_workers_from_env =
+        get_idx_from_env("PATSOLVE_NUM_WORKERS");
+    num_workers = get_num_cpus();
+    if (num_workers_from_env > 0)
+    {
+        num_workers = (int)num_workers_from_env;
+    }
+    bool pin = false;
+    const char *coordinator_address = NULL;
+    /* Take our own long options out, and leave the rest for
+    fc_solve_pats__configure_soft_thread(). */
+    int new_argc = 1;
+    for (int arg_idx = 1; arg_idx < argc; ++arg_idx)
+    {
+        const char *const arg = argv[arg_idx];
+        if (!strncmp(arg, "--workers=", 10))
+        {
+            num_workers = atoi(arg + 10);
+            if (num_workers < 1)
+            {
+                fatalerr("--workers needs a positive number.");
+            }
+        }
+        else if (!strcmp(arg, "--pin"))
+        {
+            pin = true;
+        }
+        else if (!strcmp(arg, "--unordered"))
+        {
+            is_unordered = true;
+        }
+        else if (!strcmp(arg, "--progress"))
+        {
+            show_progress = true;
+        }
+        else if (!strncmp(arg, "--coordinator=", 14))
+        {
+            coordinator_address = arg + 14;
+        }
+        else if (!strncmp(arg, "--results-db=", 13))
+        {
+            results_db_path = arg + 13;
+        }
+        else if (!strncmp(arg, "--corpus=", 9))
+        {
+            corpus_path = arg + 9;
+        }
+        else if (!strncmp(arg, "--solutions=", 12))
+        {
+            solutions_path = arg + 12;
+        }
+        else if (!strncmp(arg, "--params-file=", 14))
+        {
+            fc_solve_pats__load_params_file(arg + 14);
+        }
+        else if (!strncmp(arg, "--move-weights=", 15))
+        {
+            static double weights[FCS_PATS__NUM_MOVE_FEATURES];
+            fc_solve_pats__load_move_weights(weights, arg + 15);
+            move_weights = weights;
+        }
+        else if (!strncmp(arg, "--preset-rules=", 15))
+        {
+            preset_rules_path = arg + 15;
+        }
+        else
+        {
+            argv[new_argc++] = argv[arg_idx];
+        }
+    }
+    argc = new_argc;
+    argv[argc] = NULL;
+    context_argc = argc;
+    context_argv = argv;
+
+    const bool are_solutions_on_stdout =
+        (solutions_path && !strcmp(solutions_path, "-"));
+    if (are_solutions_on_stdout && show_progress)
+    {
+        fatalerr("--progress doesn't work with --solutions=-.");
+    }
+    if (solutions_path && coordinator_address)
+    {
+        // Every worker would write its own solutions over the same file.
+        fatalerr("--solutions doesn't work with --coordinator.");
+    }
+    if (solutions_path &&
+        !fc_solve_pats__solutions_open(&solutions, solutions_path))
+    {
+        fatalerr("Cannot write the solutions to '%s'.", solutions_path);
+    }
+
+    /* Check the options and print the variant once, here, rather than in
+    every worker.  A coordinator prints it instead, before the results. */
+    char *banner = NULL;
+    size_t banner_size = 0;
+    {
+        fcs_pats_thread soft_thread_struct__dont_use_directly;
+        fcs_pats_thread *const soft_thread =
+            &soft_thread_struct__dont_use_directly;
+        fcs_instance instance_struct;
+        bool is_quiet = false;
+        fc_solve_pats__configure_soft_thread(soft_thread, &instance_struct,
+            &argc, (const char ***)(&argv), &is_quiet);
+        if (soft_thread->checkpoint_filename || soft_thread->resume_filename)
+        {
+            fatalerr("-K and -R only work on a single deal.");
+        }
+        if (preset_rules_path)
+        {
+            fc_solve_pats__load_preset_rules(
+                &preset_selector, preset_rules_path);
+        }
+        if (coordinator_address)
+        {
+            soft_thread->out = open_memstream(&banner, &banner_size);
+            if (!soft_thread->out)
+            {
+                fatalerr("Cannot open the output buffer.");
+            }
+        }
+        else if (are_solutions_on_stdout)
+        {
+            soft_thread->out = stderr;
+        }
+        fc_solve_pats__announce_variation(
+            soft_thread, &instance_struct, &is_quiet);
+        if (coordinator_address)
+        {
+            fclose(soft_thread->out);
+        }
+        fc_solve_pats__destroy_soft_thread(soft_thread);
+    }
+
+    if (corpus_path && !fc_solve_pats__corpus_open(&corpus, corpus_path))
+    {
+        fatalerr("Cannot read the corpus '%s'.", corpus_path);
+    }
+    if (show_progress)
+    {
+        fc_solve_print_started_at();
+    }
+    workers = malloc(sizeof(workers[0]) * (size_t)num_workers);
+    contexts = aligned_alloc(
+        _Alignof(worker_context), sizeof(contexts[0]) * (size_t)num_workers);
+    if (!workers || !contexts)
+    {
+        fatalerr("Out of memory for %d workers.", num_workers);
+    }
+    for (int idx = 0; idx < num_workers; idx++)
+    {
+        atomic_init(&contexts[idx].num_iters, 0);
+        contexts[idx].idx = idx;
+        contexts[idx].pin = pin;
+    }
+    if (coordinator_address)
+    {
+        solve_for_coordinator(coordinator_address, banner, banner_size);
+        free(banner);
+    }
+    else
+    {
+        output_fh = (are_solutions_on_stdout ? stderr : stdout);
+        // By default, solve all of the corpus.
+        if (corpus_path && get_idx_from_env("PATSOLVE_START") < 0)
+        {
+            solve_range(corpus.start_deal_num, corpus.end_deal_num);
+        }
+        else
+        {
+            solve_range(get_idx_from_env("PATSOLVE_START"),
+                get_idx_from_env("PATSOLVE_END"));
+        }
+    }
+    if (solutions_path && !fc_solve_pats__solutions_close(&solutions))
+    {
+        fatalerr("Cannot write the solutions to '%s'.", solutions_path);
+    }
+    if (show_progress)
+    {
+        fc_solve_print_finished(get_total_num_iters());
+    }
+    if (preset_rules_path)
+    {
+        fc_solve_pats__preset_rules_free(&preset_selector);
+    }
+    fc_solve_pats__presets_free(&fc_solve_pats__presets);
+    free(contexts);
+    free(workers);
 
     return 0;
 }
@@ -0,0 +1,772 @@
+// This file is part of patsolve. It is subject to the license terms in
+// the LICENSE file found in the top-level directory of this distribution
+// and at https://github.com/shlomif/patsolve/blob/master/LICENSE . No
+// part of patsolve, including this file, may be copied, modified, propagated,
+// or distributed except according to the terms contained in the COPYING file.
+//
+// pats-tune : tune the -X/-Y parameters (fcs_pats_xy_params) of a variant,
+// or the weights of --move-weights (see move_model.h), on a set of deals,
+// with the genetic algorithm of ga/ga.py or with CMA-ES, solving the deals in
+// this process on all the CPUs.
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "pat.h"
+#include "read_layout.h"
+#include "pats__play.h"
+#include "pats__print_msg.h"
+#include "deal_corpus.h"
+
+static const char Usage[] =
+    "usage: %s [-s|f] [-k|a] [-w<n>] [-t<n>] [-S] [-I<n>] [-M<n>] [-P<n>]\n"
+    "    [-X<n> ...] [-Y ...] [--method=ga|cmaes] [--generations=<n>]\n"
+    "    [--population=<n>] [--threads=<n>] [--seed=<n>] [--name=<name>]\n"
+    "    [--move-weights[=<file>]] (--corpus=<file> | <start> <end>)\n"
+    "Tune the parameters of the variant (the ones that -P, -X and -Y set)\n"
+    "on the deals from <start> to <end> (excluded), or on the corpus.  The\n"
+    "fitness is the number of positions checked per deal, counting a deal\n"
+    "that hits -I (100000 by default) or -M twice.  The search starts from\n"
+    "the parameters of the variant, and the best parameters are printed\n"
+    "as a line of param.dat, named <name> (Tuned by default).\n"
+    "--method=ga the genetic algorithm of ga/ga.py (the default)\n"
+    "--method=cmaes the Covariance Matrix Adaptation Evolution Strategy\n"
+    "--generations=<n> the number of generations (20 by default), or 0 to\n"
+    "    only count the positions of the start\n"
+    "--population=<n> the candidates in a generation (20 by default)\n"
+    "--move-weights tune the weights of --move-weights instead, with the\n"
+    "    other parameters fixed, from the weights of the -X parameters or\n"
+    "    of <file>, and print them as a --move-weights file\n";
+
+#define FCS_PATS__TUNE_DEFAULT_MAX_CHECKED_STATES 100000
+
+/* The genes of a candidate, in the order of ga/ga.py: the first ten -X
+parameters, the "queue squashing" function (see patsolve.c) as its values at
+0, 25 and 50 cards out, and the -c cut off minus one. */
+#define NUM_GENES (FC_SOLVE_PATS__NUM_X_PARAM + FC_SOLVE_PATS__NUM_Y_PARAM)
+#define GENE_SQUASH (FC_SOLVE_PATS__NUM_X_PARAM - 1)
+#define GENE_CUT_OFF (NUM_GENES - 1)
+/* With --move-weights, the genes are the weights of the features of a move
+instead. */
+#define MAX_GENES                                                            \
+    (NUM_GENES > FCS_PATS__NUM_MOVE_FEATURES ? NUM_GENES                     \
+                                             : FCS_PATS__NUM_MOVE_FEATURES)
+
+typedef struct
+{
+    double genes[MAX_GENES];
+    double fitness;
+    unsigned long num_failed;
+} candidate;
+
+static int context_argc;
+static char **context_argv;
+static int num_threads;
+static fcs_pats_thread *soft_threads;
+static fcs_instance *instances;
+
+static uint8_t (*deals)[FCS_PATS__MSDEAL_NUM_CARDS];
+static size_t num_deals;
+
+// The generation that the workers evaluate.
+static fcs_pats_xy_params *generation_params;
+static size_t generation_size;
+static atomic_ullong *num_checked_states;
+static atomic_ulong *num_failed;
+static atomic_size_t next_item;
+static bool is_tuning_moves;
+static int num_genes = NUM_GENES;
+static double (*generation_weights)[FCS_PATS__NUM_MOVE_FEATURES];
+
+static uint64_t rng_state;
+
+// splitmix64, so that a --seed gives the same run everywhere.
+static uint64_t rng_next(void)
+{
+    uint64_t z = (rng_state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static double rng_uniform(void)
+{
+    return (double)(rng_next() >> 11) * 0x1.0p-53;
+}
+
+static double rng_normal(void)
+{
+    const double u = 1.0 - rng_uniform();
+    return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * rng_uniform());
+}
+
+static void genes_to_params(
+    const double *const genes, fcs_pats_xy_params *const params)
+{
+    for (int i = 0; i < GENE_SQUASH; i++)
+    {
+        // The priorities are signed chars.
+        params->x[i] = (int)fmax(-127.0, fmin(127.0, round(genes[i])));
+    }
+    // Only the sign of x[9] matters (see pat.c).
+    params->x[GENE_SQUASH - 1] = (params->x[GENE_SQUASH - 1] < 0 ? -1 : 1);
+    params->x[FC_SOLVE_PATS__NUM_X_PARAM - 1] =
+        (int)fmin(127.0, fabs(round(genes[GENE_CUT_OFF]))) + 1;
+
+    // The quadratic through the values at 0, 25 and 50.
+    const double v0 = round(genes[GENE_SQUASH]);
+    const double v1 = round(genes[GENE_SQUASH + 1]);
+    const double v2 = round(genes[GENE_SQUASH + 2]);
+    params->y[0] = (v2 - 2 * v1 + v0) / (2 * 25 * 25);
+    params->y[1] = (v1 - v0) / 25 - 25 * params->y[0];
+    params->y[2] = v0;
+}
+
+static void params_to_genes(
+    const fcs_pats_xy_params *const params, double *const genes)
+{
+    for (int i = 0; i < GENE_SQUASH; i++)
+    {
+        genes[i] = params->x[i];
+    }
+    for (int i = 0; i < 3; i++)
+    {
+        const double n = 25 * i;
+        genes[GENE_SQUASH + i] =
+            (params->y[0] * n + params->y[1]) * n + params->y[2];
+    }
+    genes[GENE_CUT_OFF] = params->x[FC_SOLVE_PATS__NUM_X_PARAM - 1] - 1;
+}
+
+static void *worker_thread(void *const arg)
+{
+    fcs_pats_thread *const soft_thread = arg;
+    const size_t num_items = generation_size * num_deals;
+    size_t item;
+    while ((item = atomic_fetch_add(&next_item, 1)) < num_items)
+    {
+        const size_t idx = item % generation_size;
+        if (is_tuning_moves)
+        {
+            soft_thread->move_weights = generation_weights[idx];
+        }
+        else
+        {
+            soft_thread->pats_solve_params = generation_params[idx];
+            fc_solve_pats__set_cut_off(soft_thread);
+        }
+        fc_solve_pats__read_dealt_cards(
+            soft_thread, deals[item / generation_size]);
+        fc_solve_pats__play(soft_thread, true);
+        unsigned long long num_checked = soft_thread->num_checked_states;
+        if (soft_thread->status == FCS_PATS__FAIL)
+        {
+            num_checked += soft_thread->max_num_checked_states;
+            atomic_fetch_add(&num_failed[idx], 1);
+        }
+        atomic_fetch_add(&num_checked_states[idx], num_checked);
+        fc_solve_pats__recycle_soft_thread(soft_thread);
+    }
+    return NULL;
+}
+
+// Solve all the deals with every candidate, and set their fitness.
+static void evaluate(candidate *const candidates, const size_t num_candidates)
+{
+    fcs_pats_xy_params params[num_candidates];
+    double weights[num_candidates][FCS_PATS__NUM_MOVE_FEATURES];
+    atomic_ullong checked[num_candidates];
+    atomic_ulong failed[num_candidates];
+    for (size_t i = 0; i < num_candidates; i++)
+    {
+        if (is_tuning_moves)
+        {
+            memcpy(weights[i], candidates[i].genes, sizeof(weights[i]));
+        }
+        else
+        {
+            genes_to_params(candidates[i].genes, &params[i]);
+        }
+        atomic_init(&checked[i], 0);
+        atomic_init(&failed[i], 0);
+    }
+    generation_params = params;
+    generation_weights = weights;
+    generation_size = num_candidates;
+    num_checked_states = checked;
+    num_failed = failed;
+    atomic_store(&next_item, 0);
+
+    pthread_t threads[num_threads];
+    for (int i = 0; i < num_threads; i++)
+    {
+        if (pthread_create(&threads[i], NULL, worker_thread, &soft_threads[i]))
+        {
+            fatalerr("Cannot start thread %d.", i);
+        }
+    }
+    for (int i = 0; i < num_threads; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    for (size_t i = 0; i < num_candidates; i++)
+    {
+        candidates[i].fitness =
+            (double)atomic_load(&checked[i]) / (double)num_deals;
+        candidates[i].num_failed = atomic_load(&failed[i]);
+    }
+}
+
+static int compare_fitness(const void *const a, const void *const b)
+{
+    const double fa = ((const candidate *)a)->fitness;
+    const double fb = ((const candidate *)b)->fitness;
+    return (fa > fb) - (fa < fb);
+}
+
+/* Add or subtract a small number from some of the genes, with the
+distribution of the steps in mutate() of ga/ga.py. */
+static void mutate(double *const genes, const double probability)
+{
+    static const int steps[] = {1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+        1, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 3, 3,
+        3, 3, 3, 3, 4, 4, 4, 5, 5, 6};
+    for (int i = 0; i < num_genes; i++)
+    {
+        if (rng_uniform() < probability)
+        {
+            const int step = steps[rng_next() % COUNT(steps)];
+            genes[i] += ((rng_next() & 1) ? step : -step);
+        }
+    }
+}
+
+/* Take the genes of one parent until a crossover, then of the other, and so
+on, as in cross() of ga/ga.py, and mutate the child. */
+static void breed(const double *const a, const double *const b,
+    double *const child, const double cross_probability,
+    const double mutate_probability)
+{
+    const double *parents[2] = {a, b};
+    int which = (int)(rng_next() & 1);
+    for (int i = 0; i < num_genes; i++)
+    {
+        if (rng_uniform() < cross_probability)
+        {
+            which = 1 - which;
+        }
+        child[i] = parents[which][i];
+    }
+    mutate(child, mutate_probability);
+}
+
+static bool same_params(const candidate *const a, const candidate *const b)
+{
+    if (is_tuning_moves)
+    {
+        return !memcmp(a->genes, b->genes, sizeof(a->genes));
+    }
+    fcs_pats_xy_params pa, pb;
+    genes_to_params(a->genes, &pa);
+    genes_to_params(b->genes, &pb);
+    return !memcmp(&pa, &pb, sizeof(pa));
+}
+
+static void report_generation(const int gen, const candidate *const best)
+{
+    fprintf(stderr, "Generation %d: %.1f positions per deal (%lu failed).\n",
+        gen, best->fitness, best->num_failed);
+}
+
+/* The genetic algorithm of ga/ga.py: replace the worse half of the
+population with children of the better half, and the children that
+repeat a member with more children.  Unlike ga.py, it solves the same deals
+in every generation, so only the children need to be solved. */
+static void tune_ga(candidate *const pop, const int num_pop,
+    const int num_generations, candidate *const best)
+{
+    const int num_kept = max(num_pop / 2, 1);
+    for (int i = 1; i < num_pop; i++)
+    {
+        pop[i] = pop[0];
+        mutate(pop[i].genes, 0.5);
+    }
+    for (int gen = 0; gen < num_generations; gen++)
+    {
+        /* The fitness of the kept half is known, so only the new members
+        are bred again when they repeat another member, and solved. */
+        const int first_new = (gen ? num_kept : 0);
+        for (int i = max(first_new, 1); i < num_pop; i++)
+        {
+            for (int j = 0; j < i; j++)
+            {
+                if (same_params(&pop[i], &pop[j]))
+                {
+                    breed(pop[rng_next() % (uint64_t)i].genes,
+                        pop[rng_next() % (uint64_t)i].genes, pop[i].genes,
+                        0.1, 0.1);
+                    j = -1;
+                }
+            }
+        }
+        evaluate(pop + first_new, (size_t)(num_pop - first_new));
+        qsort(pop, (size_t)num_pop, sizeof(*pop), compare_fitness);
+        if (pop[0].fitness < best->fitness)
+        {
+            *best = pop[0];
+        }
+        report_generation(gen, &pop[0]);
+        for (int i = num_kept; i < num_pop; i++)
+        {
+            breed(pop[rng_next() % (uint64_t)num_kept].genes,
+                pop[rng_next() % (uint64_t)num_kept].genes, pop[i].genes, 0.1,
+                0.1);
+        }
+    }
+}
+
+/* The eigenvalues and eigenvectors (the columns of vecs) of the symmetric
+matrix a, which is destroyed, by Jacobi rotations. */
+static void eigen(double a[MAX_GENES][MAX_GENES], double *const vals,
+    double vecs[MAX_GENES][MAX_GENES])
+{
+    for (int i = 0; i < num_genes; i++)
+    {
+        for (int j = 0; j < num_genes; j++)
+        {
+            vecs[i][j] = (i == j);
+        }
+    }
+    for (int sweep = 0; sweep < 50; sweep++)
+    {
+        double off = 0;
+        for (int p = 0; p < num_genes; p++)
+        {
+            for (int q = p + 1; q < num_genes; q++)
+            {
+                off += a[p][q] * a[p][q];
+            }
+        }
+        if (off < 1e-30)
+        {
+            break;
+        }
+        for (int p = 0; p < num_genes; p++)
+        {
+            for (int q = p + 1; q < num_genes; q++)
+            {
+                if (fabs(a[p][q]) < 1e-300)
+                {
+                    continue;
+                }
+                const double theta = (a[q][q] - a[p][p]) / (2 * a[p][q]);
+                const double t = (theta >= 0 ? 1 : -1) /
+                                 (fabs(theta) + sqrt(theta * theta + 1));
+                const double c = 1 / sqrt(t * t + 1), s = t * c;
+                for (int k = 0; k < num_genes; k++)
+                {
+                    const double akp = a[k][p], akq = a[k][q];
+                    a[k][p] = c * akp - s * akq;
+                    a[k][q] = s * akp + c * akq;
+                }
+                for (int k = 0; k < num_genes; k++)
+                {
+                    const double apk = a[p][k], aqk = a[q][k];
+                    a[p][k] = c * apk - s * aqk;
+                    a[q][k] = s * apk + c * aqk;
+                }
+                for (int k = 0; k < num_genes; k++)
+                {
+                    const double vkp = vecs[k][p], vkq = vecs[k][q];
+                    vecs[k][p] = c * vkp - s * vkq;
+                    vecs[k][q] = s * vkp + c * vkq;
+                }
+            }
+        }
+    }
+    for (int i = 0; i < num_genes; i++)
+    {
+        vals[i] = a[i][i];
+    }
+}
+
+/* (mu/mu_w, lambda)-CMA-ES, with the default settings of Hansen's "The CMA
+Evolution Strategy: A Tutorial".  The genes are searched as real numbers,
+and rounded for the solver. */
+static void tune_cmaes(candidate *const pop, const int num_pop,
+    const int num_generations, candidate *const best)
+{
+    const int n = num_genes;
+    const int mu = max(num_pop / 2, 1);
+    double weights[mu], sum_weights = 0, sum_squares = 0;
+    for (int i = 0; i < mu; i++)
+    {
+        weights[i] = log(mu + 0.5) - log(i + 1);
+        sum_weights += weights[i];
+    }
+    for (int i = 0; i < mu; i++)
+    {
+        weights[i] /= sum_weights;
+        sum_squares += weights[i] * weights[i];
+    }
+    const double mueff = 1 / sum_squares;
+    const double cc = (4 + mueff / n) / (n + 4 + 2 * mueff / n);
+    const double cs = (mueff + 2) / (n + mueff + 5);
+    const double c1 = 2 / ((n + 1.3) * (n + 1.3) + mueff);
+    const double cmu = fmin(
+        1 - c1, 2 * (mueff - 2 + 1 / mueff) / ((n + 2) * (n + 2) + mueff));
+    const double damps =
+        1 + 2 * fmax(0, sqrt((mueff - 1) / (n + 1)) - 1) + cs;
+    const double chi_n = sqrt(n) * (1 - 1.0 / (4 * n) + 1.0 / (21 * n * n));
+
+    double mean[MAX_GENES], pc[MAX_GENES] = {0}, ps[MAX_GENES] = {0};
+    double cov[MAX_GENES][MAX_GENES], b[MAX_GENES][MAX_GENES], d[MAX_GENES];
+    // The steps of the candidates, in units of sigma.
+    double steps[num_pop][MAX_GENES];
+    double sigma = 2;
+    memcpy(mean, pop[0].genes, sizeof(mean));
+    for (int i = 0; i < n; i++)
+    {
+        d[i] = 1;
+        for (int j = 0; j < n; j++)
+        {
+            cov[i][j] = b[i][j] = (i == j);
+        }
+    }
+
+    for (int gen = 0; gen < num_generations; gen++)
+    {
+        for (int k = 0; k < num_pop; k++)
+        {
+            double z[MAX_GENES];
+            for (int i = 0; i < n; i++)
+            {
+                z[i] = d[i] * rng_normal();
+            }
+            for (int i = 0; i < n; i++)
+            {
+                steps[k][i] = 0;
+                for (int j = 0; j < n; j++)
+                {
+                    steps[k][i] += b[i][j] * z[j];
+                }
+                pop[k].genes[i] = mean[i] + sigma * steps[k][i];
+            }
+        }
+        evaluate(pop, (size_t)num_pop);
+        int order[num_pop];
+        for (int k = 0; k < num_pop; k++)
+        {
+            order[k] = k;
+            for (int j = k; j > 0 &&
+                            pop[order[j]].fitness < pop[order[j - 1]].fitness;
+                 j--)
+            {
+                const int tmp = order[j];
+                order[j] = order[j - 1];
+                order[j - 1] = tmp;
+            }
+        }
+        if (pop[order[0]].fitness < best->fitness)
+        {
+            *best = pop[order[0]];
+        }
+        report_generation(gen, &pop[order[0]]);
+
+        // Move the mean, and update the evolution paths.
+        double step_w[MAX_GENES] = {0}, bt_step[MAX_GENES] = {0};
+        for (int i = 0; i < n; i++)
+        {
+            for (int k = 0; k < mu; k++)
+            {
+                step_w[i] += weights[k] * steps[order[k]][i];
+            }
+            mean[i] += sigma * step_w[i];
+        }
+        for (int j = 0; j < n; j++)
+        {
+            for (int i = 0; i < n; i++)
+            {
+                bt_step[j] += b[i][j] * step_w[i];
+            }
+            bt_step[j] /= d[j];
+        }
+        double ps_norm = 0;
+        for (int i = 0; i < n; i++)
+        {
+            double inv_sqrt_c_step = 0;
+            for (int j = 0; j < n; j++)
+            {
+                inv_sqrt_c_step += b[i][j] * bt_step[j];
+            }
+            ps[i] = (1 - cs) * ps[i] +
+                    sqrt(cs * (2 - cs) * mueff) * inv_sqrt_c_step;
+            ps_norm += ps[i] * ps[i];
+        }
+        ps_norm = sqrt(ps_norm);
+        const bool hsig = (ps_norm / sqrt(1 - pow(1 - cs, 2 * (gen + 1))) /
+                              chi_n <
+                          1.4 + 2.0 / (n + 1));
+        for (int i = 0; i < n; i++)
+        {
+            pc[i] = (1 - cc) * pc[i] +
+                    (hsig ? sqrt(cc * (2 - cc) * mueff) * step_w[i] : 0);
+        }
+
+        // Adapt the covariance matrix and the step size.
+        for (int i = 0; i < n; i++)
+        {
+            for (int j = 0; j <= i; j++)
+            {
+                double rank_mu = 0;
+                for (int k = 0; k < mu; k++)
+                {
+                    rank_mu +=
+                        weights[k] * steps[order[k]][i] * steps[order[k]][j];
+                }
+                cov[i][j] = cov[j][i] =
+                    (1 - c1 - cmu) * cov[i][j] +
+                    c1 * (pc[i] * pc[j] +
+                             (hsig ? 0 : cc * (2 - cc) * cov[i][j])) +
+                    cmu * rank_mu;
+            }
+        }
+        sigma *= exp((cs / damps) * (ps_norm / chi_n - 1));
+
+        double a[MAX_GENES][MAX_GENES];
+        memcpy(a, cov, sizeof(a));
+        eigen(a, d, b);
+        for (int i = 0; i < n; i++)
+        {
+            d[i] = sqrt(fmax(d[i], 1e-20));
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    program_name = argv[0];
+    const char *corpus_path = NULL;
+    const char *move_weights_path = NULL;
+    const char *name = "Tuned";
+    bool is_cmaes = false;
+    int num_generations = 20, num_pop = 20;
+    /* Take our own long options out, and leave the rest for
+    fc_solve_pats__configure_soft_thread(). */
+    int new_argc = 1;
+    for (int arg_idx = 1; arg_idx < argc; ++arg_idx)
+    {
+        const char *const arg = argv[arg_idx];
+        if (!strcmp(arg, "-h") || !strcmp(arg, "--help"))
+        {
+            USAGE();
+            exit(0);
+        }
+        else if (!strncmp(arg, "--corpus=", 9))
+        {
+            corpus_path = arg + 9;
+        }
+        else if (!strcmp(arg, "--method=ga") || !strcmp(arg, "--method=cmaes"))
+        {
+            is_cmaes = !strcmp(arg, "--method=cmaes");
+        }
+        else if (!strncmp(arg, "--generations=", 14))
+        {
+            num_generations = atoi(arg + 14);
+        }
+        else if (!strncmp(arg, "--population=", 13))
+        {
+            num_pop = atoi(arg + 13);
+        }
+        else if (!strncmp(arg, "--threads=", 10))
+        {
+            num_threads = atoi(arg + 10);
+        }
+        else if (!strncmp(arg, "--seed=", 7))
+        {
+            rng_state = strtoull(arg + 7, NULL, 10);
+        }
+        else if (!strncmp(arg, "--name=", 7))
+        {
+            name = arg + 7;
+        }
+        else if (!strcmp(arg, "--move-weights"))
+        {
+            is_tuning_moves = true;
+        }
+        else if (!strncmp(arg, "--move-weights=", 15))
+        {
+            is_tuning_moves = true;
+            move_weights_path = arg + 15;
+        }
+        else if (!strncmp(arg, "--", 2))
+        {
+            fatalerr("Unknown option '%s'.", arg);
+        }
+        else
+        {
+            argv[new_argc++] = argv[arg_idx];
+        }
+    }
+    argc = new_argc;
+    argv[argc] = NULL;
+    context_argc = argc;
+    context_argv = argv;
+    if (num_generations < 0 || num_pop < 2)
+    {
+        fatalerr("--generations must not be negative, and --population at "
+                 "least 2.");
+    }
+    if (!num_threads)
+    {
+        const long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        num_threads = (num_cpus > 0 ? (int)num_cpus : 1);
+    }
+    if (num_threads < 1)
+    {
+        fatalerr("--threads needs a positive number.");
+    }
+
+    // Configure a soft thread for every worker, to use for all the deals.
+    soft_threads = calloc((size_t)num_threads, sizeof(*soft_threads));
+    instances = calloc((size_t)num_threads, sizeof(*instances));
+    if (!soft_threads || !instances)
+    {
+        fatalerr("Out of memory for the soft threads.");
+    }
+    for (int i = 0; i < num_threads; i++)
+    {
+        argc = context_argc;
+        argv = context_argv;
+        bool is_quiet = true;
+        fc_solve_pats__configure_soft_thread(&soft_threads[i], &instances[i],
+            &argc, (const char ***)(&argv), &is_quiet);
+        if (soft_threads[i].max_num_checked_states == ULONG_MAX)
+        {
+            soft_threads[i].max_num_checked_states =
+                FCS_PATS__TUNE_DEFAULT_MAX_CHECKED_STATES;
+        }
+        soft_threads[i].out = stderr;
+    }
+
+    // Deal the deals once.
+    long long start_deal_num = 0, end_deal_num = 0;
+    fcs_pats__corpus corpus = {.map = NULL};
+    if (corpus_path)
+    {
+        if (argc != 0)
+        {
+            USAGE();
+            exit(1);
+        }
+        if (!fc_solve_pats__corpus_open(&corpus, corpus_path))
+        {
+            fatalerr("Cannot read the corpus '%s'.", corpus_path);
+        }
+        start_deal_num = corpus.start_deal_num;
+        end_deal_num = corpus.end_deal_num;
+    }
+    else if (argc == 2)
+    {
+        start_deal_num = atoll(argv[0]);
+        end_deal_num = atoll(argv[1]);
+    }
+    else
+    {
+        USAGE();
+        exit(1);
+    }
+    if (start_deal_num < 0 || end_deal_num <= start_deal_num)
+    {
+        fatalerr("There are no deals to tune on.");
+    }
+    num_deals = (size_t)(end_deal_num - start_deal_num);
+    if (!(deals = malloc(num_deals * sizeof(*deals))))
+    {
+        fatalerr("Out of memory for the deals.");
+    }
+    for (size_t i = 0; i < num_deals; i++)
+    {
+        const long long deal_num = start_deal_num + (long long)i;
+        if (corpus_path)
+        {
+            const uint8_t *const cards =
+                fc_solve_pats__corpus_deal(&corpus, deal_num);
+            if (!cards)
+            {
+                fatalerr("Deal %lld of the corpus is not a deal.", deal_num);
+            }
+            memcpy(deals[i], cards, sizeof(deals[i]));
+        }
+        else
+        {
+            fc_solve_pats__msdeal_shuffle((unsigned long long)deal_num,
+                FCS_PATS__MSDEAL_NUM_CARDS, deals[i]);
+        }
+    }
+    if (corpus_path)
+    {
+        fc_solve_pats__corpus_close(&corpus);
+    }
+
+    // Start from the parameters of the variant, and see how well they do.
+    candidate pop[num_pop];
+    memset(pop[0].genes, 0, sizeof(pop[0].genes));
+    if (move_weights_path)
+    {
+        fc_solve_pats__load_move_weights(pop[0].genes, move_weights_path);
+    }
+    else if (is_tuning_moves)
+    {
+        fc_solve_pats__move_weights_from_params(
+            &soft_threads[0].pats_solve_params, pop[0].genes);
+    }
+    else
+    {
+        params_to_genes(&soft_threads[0].pats_solve_params, pop[0].genes);
+    }
+    if (is_tuning_moves)
+    {
+        num_genes = FCS_PATS__NUM_MOVE_FEATURES;
+    }
+    candidate initial = pop[0];
+    evaluate(&initial, 1);
+    fprintf(stderr, "Start: %.1f positions per deal (%lu failed).\n",
+        initial.fitness, initial.num_failed);
+    candidate best = initial;
+    (is_cmaes ? tune_cmaes : tune_ga)(pop, num_pop, num_generations, &best);
+
+    printf("# %s, %d generations of %d, on deals %lld to %lld: %.1f "
+           "positions per deal (%lu failed), from %.1f\n",
+        (is_cmaes ? "CMA-ES" : "GA"), num_generations, num_pop,
+        start_deal_num, end_deal_num - 1, best.fitness, best.num_failed,
+        initial.fitness);
+    if (is_tuning_moves)
+    {
+        fc_solve_pats__move_weights_print(best.genes, stdout);
+    }
+    else
+    {
+        fcs_pats_xy_params params;
+        genes_to_params(best.genes, &params);
+        printf("%s", name);
+        for (int i = 0; i < FC_SOLVE_PATS__NUM_X_PARAM; i++)
+        {
+            printf(" %d", params.x[i]);
+        }
+        for (int i = 0; i < FC_SOLVE_PATS__NUM_Y_PARAM; i++)
+        {
+            printf(" %g", params.y[i]);
+        }
+        printf("\n");
+    }
+
+    for (int i = 0; i < num_threads; i++)
+    {
+        fc_solve_pats__destroy_soft_thread(&soft_threads[i]);
+    }
+    free(soft_threads);
+    free(instances);
+    free(deals);
+    return 0;
+}
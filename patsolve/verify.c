@@ -0,0 +1,314 @@
+// This file is part of patsolve. It is subject to the license terms in
+// the LICENSE file found in the top-level directory of this distribution
+// and at https://github.com/shlomif/patsolve/blob/master/LICENSE . No
+// part of patsolve, including this file, may be copied, modified, propagated,
+// or distributed except according to the terms contained in the COPYING file.
+//
+// pats-verify : replay the solutions that patsolve or threaded-pats wrote
+// with --solutions against their deals, and report the ones that are wrong.
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "pat.h"
+#include "read_layout.h"
+#include "pats__play.h"
+#include "pats__print_msg.h"
+#include "deal_corpus.h"
+#include "verify.h"
+
+static const char Usage[] =
+    "usage: %s [-s|f] [-k|a] [-w<n>] [-t<n>] [--corpus=<file>]\n"
+    "    [--threads=<n>] <file>\n"
+    "Replay the solutions in <file> (written with --solutions) against their\n"
+    "deals, by the rules of the variant (-s, -f, -k, -a, -w and -t as for\n"
+    "patsolve), and report the first illegal move of each wrong one.  The\n"
+    "deals are dealt, or read from the corpus of pats-msdeal --corpus.\n"
+    "The exit status is 1 if any solution is wrong.\n";
+
+// The records that a worker takes at a time.
+#define FCS_PATS__VERIFY_CHUNK 1024
+
+typedef enum
+{
+    // Verified to win.
+    VERDICT_WON,
+    // No solution was found, so there is nothing to verify.
+    VERDICT_NO_SOLUTION,
+    VERDICT_ILLEGAL_MOVE,
+    VERDICT_NOT_WON,
+    VERDICT_WRONG_NUM_MOVES,
+    VERDICT_NO_DEAL,
+} verdict_code;
+
+typedef struct
+{
+    fcs_pats__solution_header header;
+    const uint8_t *moves;
+    fcs_pats__verify_result result;
+    verdict_code verdict;
+} record;
+
+static int context_argc;
+static char **context_argv;
+static fcs_pats__corpus corpus = {.map = NULL};
+static record *records;
+static size_t num_records;
+static atomic_size_t next_record;
+
+static void verify_record(fcs_pats_thread *const soft_thread, record *const rec)
+{
+    const fcs_pats__solution_header *const header = &rec->header;
+    if (!header->len && header->status != fc_solve_pats__result_code("Won"))
+    {
+        rec->verdict = VERDICT_NO_SOLUTION;
+        return;
+    }
+    if (corpus.map)
+    {
+        const uint8_t *const cards =
+            fc_solve_pats__corpus_deal(&corpus, header->board_num);
+        if (!cards)
+        {
+            rec->verdict = VERDICT_NO_DEAL;
+            return;
+        }
+        fc_solve_pats__read_dealt_cards(soft_thread, cards);
+    }
+    else
+    {
+        fc_solve_pats__read_deal(soft_thread, header->board_num);
+    }
+    rec->result =
+        fc_solve_pats__verify_solution(soft_thread, rec->moves, header->len);
+    switch (rec->result.code)
+    {
+    case FCS_PATS__VERIFY_WON:
+        rec->verdict = (rec->result.num_moves == header->num_moves)
+                           ? VERDICT_WON
+                           : VERDICT_WRONG_NUM_MOVES;
+        break;
+    case FCS_PATS__VERIFY_ILLEGAL_MOVE:
+        rec->verdict = VERDICT_ILLEGAL_MOVE;
+        break;
+    default:
+        rec->verdict = VERDICT_NOT_WON;
+        break;
+    }
+}
+
+static void *worker_thread(void *const arg)
+{
+    fcs_pats_thread soft_thread_struct__dont_use_directly;
+    fcs_pats_thread *const soft_thread = &soft_thread_struct__dont_use_directly;
+    int argc = context_argc;
+    char **argv = context_argv;
+    fcs_instance instance_struct;
+    bool is_quiet = true;
+    fc_solve_pats__configure_soft_thread(soft_thread, &instance_struct, &argc,
+        (const char ***)(&argv), &is_quiet);
+
+    size_t start;
+    while ((start = atomic_fetch_add(&next_record, FCS_PATS__VERIFY_CHUNK)) <
+           num_records)
+    {
+        const size_t end = min(start + FCS_PATS__VERIFY_CHUNK, num_records);
+        for (size_t i = start; i < end; i++)
+        {
+            verify_record(soft_thread, &records[i]);
+        }
+    }
+    fc_solve_pats__destroy_soft_thread(soft_thread);
+    return arg;
+}
+
+// Find the records of the stream, which is mapped at map.
+static void find_records(const uint8_t *const map, const size_t map_len,
+    const char *const path)
+{
+    if (map_len < 8 || memcmp(map, FCS_PATS__SOLUTIONS_MAGIC, 8))
+    {
+        fatalerr("'%s' is not a stream of solutions.", path);
+    }
+    size_t max_num_records = 0;
+    for (size_t pos = 8; pos < map_len;)
+    {
+        fcs_pats__solution_header header;
+        if (map_len - pos < sizeof(header))
+        {
+            fatalerr("The solutions end in the middle of a record.");
+        }
+        memcpy(&header, map + pos, sizeof(header));
+        if (header.len > map_len - pos - sizeof(header))
+        {
+            fatalerr("The solutions end in the middle of deal %lld.",
+                (long long)header.board_num);
+        }
+        if (num_records == max_num_records)
+        {
+            max_num_records = max_num_records * 2 + FCS_PATS__VERIFY_CHUNK;
+            if (!(records =
+                        realloc(records, max_num_records * sizeof(*records))))
+            {
+                fatalerr("Out of memory for the records.");
+            }
+        }
+        records[num_records++] = (record){
+            .header = header, .moves = map + pos + sizeof(header)};
+        pos += sizeof(header) + header.len;
+    }
+}
+
+static void report_illegal_move(const record *const rec)
+{
+    printf("#%lld: move %u is illegal: ", (long long)rec->header.board_num,
+        rec->result.num_moves + 1);
+    if (!fc_solve_pats__render_move(rec->moves + rec->result.offset,
+            rec->header.len - rec->result.offset, stdout))
+    {
+        printf("not a move\n");
+    }
+}
+
+int main(int argc, char **argv)
+{
+    program_name = argv[0];
+    const char *corpus_path = NULL;
+    long long num_threads = 0;
+    /* Take our own long options out, and leave the rest for
+    fc_solve_pats__configure_soft_thread(). */
+    int new_argc = 1;
+    for (int arg_idx = 1; arg_idx < argc; ++arg_idx)
+    {
+        const char *const arg = argv[arg_idx];
+        if (!strcmp(arg, "-h") || !strcmp(arg, "--help"))
+        {
+            USAGE();
+            exit(0);
+        }
+        else if (!strncmp(arg, "--corpus=", 9))
+        {
+            corpus_path = arg + 9;
+        }
+        else if (!strncmp(arg, "--threads=", 10))
+        {
+            num_threads = atoll(arg + 10);
+            if (num_threads < 1)
+            {
+                fatalerr("--threads needs a positive number.");
+            }
+        }
+        else
+        {
+            argv[new_argc++] = argv[arg_idx];
+        }
+    }
+    argc = new_argc;
+    argv[argc] = NULL;
+    context_argc = argc;
+    context_argv = argv;
+
+    const char *path;
+    {
+        fcs_pats_thread soft_thread_struct__dont_use_directly;
+        fcs_pats_thread *const soft_thread =
+            &soft_thread_struct__dont_use_directly;
+        fcs_instance instance_struct;
+        bool is_quiet = true;
+        fc_solve_pats__configure_soft_thread(soft_thread, &instance_struct,
+            &argc, (const char ***)(&argv), &is_quiet);
+        fc_solve_pats__destroy_soft_thread(soft_thread);
+        if (argc != 1)
+        {
+            USAGE();
+            exit(1);
+        }
+        path = *argv;
+    }
+    if (corpus_path && !fc_solve_pats__corpus_open(&corpus, corpus_path))
+    {
+        fatalerr("Cannot read the corpus '%s'.", corpus_path);
+    }
+
+    const int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0)
+    {
+        fatalerr("Cannot read the solutions '%s'.", path);
+    }
+    const size_t map_len = (size_t)st.st_size;
+    const uint8_t *const map =
+        (map_len ? mmap(NULL, map_len, PROT_READ, MAP_SHARED, fd, 0) : NULL);
+    if (map == MAP_FAILED)
+    {
+        fatalerr("Cannot map the solutions '%s'.", path);
+    }
+    close(fd);
+    find_records(map, map_len, path);
+
+    if (!num_threads)
+    {
+        const long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        num_threads =
+            min((num_cpus > 0 ? num_cpus : 1),
+                (long long)(num_records / (16 * FCS_PATS__VERIFY_CHUNK) + 1));
+    }
+    pthread_t threads[num_threads];
+    for (long long i = 0; i < num_threads; i++)
+    {
+        if (pthread_create(&threads[i], NULL, worker_thread, NULL))
+        {
+            fatalerr("Cannot start thread %lld.", i);
+        }
+    }
+    for (long long i = 0; i < num_threads; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+
+    unsigned long num_verdicts[VERDICT_NO_DEAL + 1] = {0};
+    for (size_t i = 0; i < num_records; i++)
+    {
+        const record *const rec = &records[i];
+        const long long board_num = (long long)rec->header.board_num;
+        num_verdicts[rec->verdict]++;
+        switch (rec->verdict)
+        {
+        case VERDICT_ILLEGAL_MOVE:
+            report_illegal_move(rec);
+            break;
+        case VERDICT_NOT_WON:
+            printf("#%lld: the %u moves do not win.\n", board_num,
+                rec->result.num_moves);
+            break;
+        case VERDICT_WRONG_NUM_MOVES:
+            printf("#%lld: the solution has %u moves, not %u.\n", board_num,
+                rec->result.num_moves, (unsigned)rec->header.num_moves);
+            break;
+        case VERDICT_NO_DEAL:
+            printf("#%lld: the deal is not in the corpus.\n", board_num);
+            break;
+        default:
+            break;
+        }
+    }
+    const unsigned long num_wrong = num_verdicts[VERDICT_ILLEGAL_MOVE] +
+                                    num_verdicts[VERDICT_NOT_WON] +
+                                    num_verdicts[VERDICT_WRONG_NUM_MOVES] +
+                                    num_verdicts[VERDICT_NO_DEAL];
+    printf("Verified %lu solutions: %lu wrong.  %lu deals had no solution.\n",
+        num_verdicts[VERDICT_WON] + num_wrong, num_wrong,
+        num_verdicts[VERDICT_NO_SOLUTION]);
+
+    free(records);
+    if (map)
+    {
+        munmap((void *)map, map_len);
+    }
+    if (corpus.map)
+    {
+        fc_solve_pats__corpus_close(&corpus);
+    }
+    return (num_wrong ? 1 : 0);
+}
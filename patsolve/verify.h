@@ -0,0 +1,270 @@
+// This file is part of patsolve. It is subject to the license terms in
+// the LICENSE file found in the top-level directory of this distribution
+// and at https://github.com/shlomif/patsolve/blob/master/LICENSE . No
+// part of patsolve, including this file, may be copied, modified, propagated,
+// or distributed except according to the terms contained in the COPYING file.
+//
+// verify.h : replay the moves of a solution (as written by --solutions, see
+// solutions.h) from a position, by the rules of the variant of the soft
+// thread, without searching anything.
+#pragma once
+
+#include "pat.h"
+#include "solutions.h"
+
+typedef enum
+{
+    FCS_PATS__VERIFY_WON,
+    // A move is illegal, or is not a move.
+    FCS_PATS__VERIFY_ILLEGAL_MOVE,
+    // All the moves are legal, but they do not win.
+    FCS_PATS__VERIFY_NOT_WON,
+} fcs_pats__verify_code;
+
+typedef struct
+{
+    fcs_pats__verify_code code;
+    // The number of legal moves, and the offset of the move after them.
+    uint32_t num_moves;
+    uint32_t offset;
+} fcs_pats__verify_result;
+
+// The card of a card code (rank * 4 + suit), or the empty card.
+static inline fcs_card fc_solve_pats__verify__card(const int code)
+{
+    const int rank = code >> 2;
+    return ((rank >= 1 && rank <= FCS_PATS__KING)
+                ? fcs_make_card(rank, code & 3)
+                : fc_solve_empty_card);
+}
+
+/* Find a card in the free cells or the piles.  Returns the pile and sets
+*depth to its index in it, returns -1 - the index of the free cell, or
+returns INT_MIN if it is not there. */
+static inline int fc_solve_pats__verify__find_card(
+    fcs_pats_thread *const soft_thread, const fcs_card card, int *const depth)
+{
+    DECLARE_STACKS();
+    fcs_state *const s = &soft_thread->current_pos.s;
+#if MAX_NUM_FREECELLS > 0
+    for (int i = 0; i < LOCAL_FREECELLS_NUM; i++)
+    {
+        if (fcs_freecell_card(*s, i) == card)
+        {
+            return -1 - i;
+        }
+    }
+#endif
+    for (int w = 0; w < LOCAL_STACKS_NUM; w++)
+    {
+        const_AUTO(col, fcs_state_get_col(*s, w));
+        const int col_len = fcs_col_len(col);
+        for (int d = 0; d < col_len; d++)
+        {
+            if (fcs_col_get_card(col, d) == card)
+            {
+                *depth = d;
+                return w;
+            }
+        }
+    }
+    return INT_MIN;
+}
+
+/* Check the move at the start of the buffer and make it.  Returns its
+length, or 0 if it is illegal (and then the position is unchanged). */
+static inline size_t fc_solve_pats__verify__move(
+    fcs_pats_thread *const soft_thread, const uint8_t *const in,
+    const size_t len)
+{
+    DECLARE_STACKS();
+#ifndef FCS_FREECELL_ONLY
+    const fcs_instance *const instance = soft_thread->instance;
+    const fcs_card game_variant_suit_mask = FCS_PATS__SUIT_MASK(instance);
+    const fcs_card game_variant_desired_suit_value =
+        FCS_PATS__DESIRED_SUIT_VALUE(instance);
+    const bool not_King_only =
+        (INSTANCE_EMPTY_STACKS_FILL != FCS_ES_FILLED_BY_KINGS_ONLY);
+#else
+    const bool not_King_only = true;
+#endif
+    fcs_state *const s = &soft_thread->current_pos.s;
+    const fcs_pats__move_kind kind = (fcs_pats__move_kind)(in[0] >> 6);
+    const size_t move_len = (kind == FCS_PATS__MOVE_TO_CARD ? 2 : 1);
+    const fcs_card card = fc_solve_pats__verify__card(in[0] & 0x3f);
+    if (len < move_len || fcs_card_is_empty(card))
+    {
+        return 0;
+    }
+    int depth = 0;
+    const int from =
+        fc_solve_pats__verify__find_card(soft_thread, card, &depth);
+    if (from == INT_MIN)
+    {
+        return 0;
+    }
+
+    /* A card in a pile takes the cards above it along, which must be a
+    sequence. */
+    const_AUTO(from_col, fcs_state_get_col(*s, (from >= 0 ? from : 0)));
+    const int num_cards = (from >= 0 ? fcs_col_len(from_col) - depth : 1);
+    for (int d = depth + 1; from >= 0 && d < depth + num_cards; d++)
+    {
+        const fcs_card above = fcs_col_get_card(from_col, d);
+        const fcs_card below = fcs_col_get_card(from_col, d - 1);
+        if (fcs_card_rank(below) != fcs_card_rank(above) + 1 ||
+            !fcs_pats_is_suitable(above, below
+#ifndef FCS_FREECELL_ONLY
+                ,
+                game_variant_suit_mask, game_variant_desired_suit_value
+#endif
+                ))
+        {
+            return 0;
+        }
+    }
+
+    int num_free = 0, empty_freecell = -1;
+#if MAX_NUM_FREECELLS > 0
+    for (int i = LOCAL_FREECELLS_NUM - 1; i >= 0; i--)
+    {
+        if (fcs_freecell_is_empty(*s, i))
+        {
+            num_free++;
+            empty_freecell = i;
+        }
+    }
+#endif
+    int num_empty = 0, empty_pile = -1;
+    for (int w = LOCAL_STACKS_NUM - 1; w >= 0; w--)
+    {
+        if (fcs_col_len(fcs_state_get_col(*s, w)) == 0)
+        {
+            num_empty++;
+            empty_pile = w;
+        }
+    }
+
+    int to = -1;
+    switch (kind)
+    {
+    case FCS_PATS__MOVE_TO_FREECELL:
+        if (from < 0 || num_cards > 1 || empty_freecell < 0)
+        {
+            return 0;
+        }
+        break;
+
+    case FCS_PATS__MOVE_TO_FOUNDATION:
+        if (num_cards > 1 || fcs_foundation_value(*s, fcs_card_suit(card)) !=
+                                 fcs_card_rank(card) - 1)
+        {
+            return 0;
+        }
+        break;
+
+    case FCS_PATS__MOVE_TO_EMPTY_PILE:
+        /* A sequence goes through the free cells and the other empty piles,
+        which only Kings may start with -k. */
+        if (empty_pile < 0 || !fcs_pats_is_king_only(not_King_only, card) ||
+            num_cards > fc_solve_pats__seq_capacity(
+                            num_free, (not_King_only ? num_empty - 1 : 0)))
+        {
+            return 0;
+        }
+        to = empty_pile;
+        break;
+
+    default: {
+        const fcs_card dest = fc_solve_pats__verify__card(in[1] & 0x3f);
+        int dest_depth = 0;
+        to = (fcs_card_is_empty(dest)
+                  ? INT_MIN
+                  : fc_solve_pats__verify__find_card(
+                        soft_thread, dest, &dest_depth));
+        if (to < 0 || to == from ||
+            dest_depth != fcs_col_len(fcs_state_get_col(*s, to)) - 1 ||
+            fcs_card_rank(dest) != fcs_card_rank(card) + 1 ||
+            !fcs_pats_is_suitable(card, dest
+#ifndef FCS_FREECELL_ONLY
+                ,
+                game_variant_suit_mask, game_variant_desired_suit_value
+#endif
+                ) ||
+            num_cards > fc_solve_pats__seq_capacity(
+                            num_free, (not_King_only ? num_empty : 0)))
+        {
+            return 0;
+        }
+    }
+    break;
+    }
+
+    // The move is legal, so make it.
+    fcs_card cards[FCS_PATS__KING];
+    if (from >= 0)
+    {
+        for (int i = num_cards - 1; i >= 0; i--)
+        {
+            cards[i] = fcs_state_pop_col_card(s, from);
+        }
+    }
+#if MAX_NUM_FREECELLS > 0
+    else
+    {
+        cards[0] = card;
+        fcs_empty_freecell(*s, -1 - from);
+    }
+#endif
+    switch (kind)
+    {
+    case FCS_PATS__MOVE_TO_FREECELL:
+#if MAX_NUM_FREECELLS > 0
+        fcs_freecell_card(*s, empty_freecell) = card;
+#endif
+        break;
+    case FCS_PATS__MOVE_TO_FOUNDATION:
+        fcs_increment_foundation(*s, fcs_card_suit(card));
+        break;
+    default:
+        for (int i = 0; i < num_cards; i++)
+        {
+            fcs_state_push(s, to, cards[i]);
+        }
+        break;
+    }
+    return move_len;
+}
+
+/* Replay the moves of a solution from soft_thread->current_pos, which is
+left at the position after the last legal move.  Only the rules of the game
+are checked: a solution need not be one that the search could find (with
+-m, say). */
+static inline fcs_pats__verify_result fc_solve_pats__verify_solution(
+    fcs_pats_thread *const soft_thread, const uint8_t *const moves,
+    const size_t len)
+{
+    fcs_pats__verify_result result = {.code = FCS_PATS__VERIFY_NOT_WON};
+    while (result.offset < len)
+    {
+        const size_t move_len = fc_solve_pats__verify__move(
+            soft_thread, moves + result.offset, len - result.offset);
+        if (!move_len)
+        {
+            result.code = FCS_PATS__VERIFY_ILLEGAL_MOVE;
+            return result;
+        }
+        result.offset += (uint32_t)move_len;
+        result.num_moves++;
+    }
+    result.code = FCS_PATS__VERIFY_WON;
+    for (int suit = 0; suit < FCS_NUM_SUITS; suit++)
+    {
+        if (fcs_foundation_value(soft_thread->current_pos.s, suit) !=
+            FCS_PATS__KING)
+        {
+            result.code = FCS_PATS__VERIFY_NOT_WON;
+        }
+    }
+    return result;
+}